@@ -11,6 +11,11 @@ void VBO::BufferData(GLfloat* vertices, GLsizeiptr size) {
 	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 }
 
+void VBO::BufferSubData(const GLfloat* vertices, GLintptr offset, GLsizeiptr size) {
+	Bind();
+	glBufferSubData(GL_ARRAY_BUFFER, offset, size, vertices);
+}
+
 void VBO::Bind() const {
 	glBindBuffer(GL_ARRAY_BUFFER, ID);
 }
@@ -35,6 +40,11 @@ void EBO::BufferData(GLuint* indices, GLsizeiptr size) {
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 }
 
+void EBO::BufferSubData(const GLuint* indices, GLintptr offset, GLsizeiptr size) {
+	Bind();
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, indices);
+}
+
 void EBO::Bind() const {
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
 }
@@ -54,6 +54,7 @@ public:
 	void Create();
 	void Bind() const;
 	void BufferData(GLfloat* vertices, GLsizeiptr size);
+	void BufferSubData(const GLfloat* vertices, GLintptr offset, GLsizeiptr size);
 	void Unbind() const;
 	void Delete();
 };
@@ -65,6 +66,7 @@ public:
 	void Create();
 	void Bind() const;
 	void BufferData(GLuint* indices, GLsizeiptr size);
+	void BufferSubData(const GLuint* indices, GLintptr offset, GLsizeiptr size);
 	void Unbind() const;
 	void Delete();
 };
@@ -0,0 +1,172 @@
+#include "batching.h"
+#include <algorithm>
+
+//-------- RangeAllocator
+
+RangeAllocator::RangeAllocator(size_t cap) {
+	Grow(cap);
+}
+
+bool RangeAllocator::Allocate(size_t size, OUT size_t& offset) {
+	for (size_t n = 0; n < freeRanges.size(); ++n) {
+		Range& r = freeRanges[n];
+		if (r.size < size) continue;
+		offset = r.offset;
+		r.offset += size;
+		r.size -= size;
+		if (r.size == 0) freeRanges.erase(freeRanges.begin() + n);
+		used += size;
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::Free(size_t offset, size_t size) {
+	if (size == 0) return;
+	auto it = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+		[](const Range& r, size_t off) { return r.offset < off; });
+	it = freeRanges.insert(it, { offset, size });
+	used -= size;
+
+	// merge with the following range, then with the preceding one
+	auto next = it + 1;
+	if (next != freeRanges.end() && it->offset + it->size == next->offset) {
+		it->size += next->size;
+		freeRanges.erase(next);
+	}
+	if (it != freeRanges.begin()) {
+		auto prev = it - 1;
+		if (prev->offset + prev->size == it->offset) {
+			prev->size += it->size;
+			freeRanges.erase(it);
+		}
+	}
+}
+
+void RangeAllocator::Grow(size_t newCapacity) {
+	if (newCapacity <= capacity) return;
+	size_t added = newCapacity - capacity, start = capacity;
+	capacity = newCapacity;
+	used += added; //Free() takes it back out
+	Free(start, added);
+}
+
+//-------- DrawCommandList
+
+void DrawCommandList::Clear() {
+	counts.clear();
+	offsets.clear();
+	baseVertices.clear();
+}
+
+void DrawCommandList::Add(GLsizei count, size_t firstIndex, GLint baseVertex) {
+	if (count == 0) return;
+	counts.push_back(count);
+	offsets.push_back(reinterpret_cast<const void*>(firstIndex * sizeof(GLuint)));
+	baseVertices.push_back(baseVertex);
+}
+
+//-------- MeshArena
+
+void MeshArena::create() {
+	vao.Create();
+	vbo_pos.Create();
+	vbo_uv.Create();
+	ebo.Create();
+	vbo_pos.BufferData(nullptr, sizeof(GLfloat) * 3 * INITIAL_VERTICES);
+	vbo_uv.BufferData(nullptr, sizeof(GLfloat) * 3 * INITIAL_VERTICES);
+	vertices.Grow(INITIAL_VERTICES);
+	indices.Grow(INITIAL_INDICES);
+
+	vao.Bind();
+	ebo.BufferData(nullptr, sizeof(GLuint) * INITIAL_INDICES);
+	linkAttribs();
+	vao.Unbind();
+	created = true;
+}
+
+void MeshArena::linkAttribs() {
+	// same layout as RenderObject::Build
+	vao.LinkAttrib(vbo_pos, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
+	vao.LinkAttrib(vbo_uv, 1, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
+	ebo.Bind();
+}
+
+// replaces buffer with a larger one holding the same first oldBytes
+template<class BufferTy>
+static void resizeBuffer(BufferTy& buffer, size_t oldBytes, size_t newBytes) {
+	BufferTy larger;
+	larger.Create();
+	larger.BufferData(nullptr, newBytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer.ID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, larger.ID);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	buffer.Delete();
+	buffer = larger;
+}
+
+void MeshArena::growVertices(size_t minCapacity) {
+	size_t cap = vertices.Capacity();
+	while (cap < minCapacity) cap *= 2;
+	resizeBuffer(vbo_pos, sizeof(GLfloat) * 3 * vertices.Capacity(), sizeof(GLfloat) * 3 * cap);
+	resizeBuffer(vbo_uv, sizeof(GLfloat) * 3 * vertices.Capacity(), sizeof(GLfloat) * 3 * cap);
+	vertices.Grow(cap);
+	vao.Bind();
+	linkAttribs();
+	vao.Unbind();
+}
+
+void MeshArena::growIndices(size_t minCapacity) {
+	size_t cap = indices.Capacity();
+	while (cap < minCapacity) cap *= 2;
+	// the element buffer binding belongs to the VAO, so nothing else may be bound while it is replaced
+	vao.Bind();
+	resizeBuffer(ebo, sizeof(GLuint) * indices.Capacity(), sizeof(GLuint) * cap);
+	indices.Grow(cap);
+	linkAttribs();
+	vao.Unbind();
+}
+
+void MeshArena::Upload(const std::vector<GLfloat>& vtxdata, const std::vector<GLfloat>& uvdata, const std::vector<GLuint>& idxdata, OUT MeshAllocation& alloc) {
+	alloc = MeshAllocation();
+	if (idxdata.empty()) return;
+	if (!created) create();
+
+	alloc.vertexCnt = vtxdata.size() / 3;
+	alloc.indexCnt = idxdata.size();
+	// a free range of the size may not exist even after growing once, when free space is fragmented
+	while (!vertices.Allocate(alloc.vertexCnt, OUT alloc.firstVertex)) growVertices(vertices.Capacity() + alloc.vertexCnt);
+	while (!indices.Allocate(alloc.indexCnt, OUT alloc.firstIndex)) growIndices(indices.Capacity() + alloc.indexCnt);
+
+	vbo_pos.BufferSubData(vtxdata.data(), sizeof(GLfloat) * 3 * alloc.firstVertex, sizeof(GLfloat) * vtxdata.size());
+	vbo_uv.BufferSubData(uvdata.data(), sizeof(GLfloat) * 3 * alloc.firstVertex, sizeof(GLfloat) * uvdata.size());
+	vbo_uv.Unbind();
+	vao.Bind();
+	ebo.BufferSubData(idxdata.data(), sizeof(GLuint) * alloc.firstIndex, sizeof(GLuint) * idxdata.size());
+	vao.Unbind();
+}
+
+void MeshArena::Free(MeshAllocation& alloc) {
+	vertices.Free(alloc.firstVertex, alloc.vertexCnt);
+	indices.Free(alloc.firstIndex, alloc.indexCnt);
+	alloc = MeshAllocation();
+}
+
+void MeshArena::Draw(const DrawCommandList& cmds) {
+	if (cmds.empty()) return;
+	vao.Bind();
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, cmds.counts.data(), GL_UNSIGNED_INT, cmds.offsets.data(), (GLsizei)cmds.size(), const_cast<GLint*>(cmds.baseVertices.data()));
+	current.drawCalls++;
+	current.commands += cmds.size();
+}
+
+void MeshArena::EndFrame() {
+	current.frames = 1;
+	lastFrame = current;
+	total.frames++;
+	total.drawCalls += current.drawCalls;
+	total.commands += current.commands;
+	current = Stats();
+}
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef BATCHING_H
+#define BATCHING_H
+
+#include <vector>
+#include <cstddef>
+#include <glad/glad.h>
+#include "GLObjects.h"
+#include "blocks.hpp" //OUT
+
+/*
+first fit allocator of ranges of units(vertices, indices) inside a buffer of fixed capacity.
+freed ranges are merged with their neighbours. it only does the bookkeeping, without touching GL.
+*/
+class RangeAllocator {
+public:
+	struct Range {
+		size_t offset, size;
+	};
+
+	explicit RangeAllocator(size_t capacity = 0);
+
+	// false if there is no free range of that size. size must not be 0.
+	bool Allocate(size_t size, OUT size_t& offset);
+	void Free(size_t offset, size_t size);
+	// appends free space at the end of the buffer.
+	void Grow(size_t newCapacity);
+
+	size_t Capacity() const { return capacity; }
+	size_t Used() const { return used; }
+	const std::vector<Range>& FreeRanges() const { return freeRanges; }
+
+private:
+	std::vector<Range> freeRanges; //sorted by offset, never adjacent
+	size_t capacity = 0, used = 0;
+};
+
+// where a mesh lives inside a MeshArena. an empty mesh has no allocation.
+struct MeshAllocation {
+	size_t firstVertex = 0, vertexCnt = 0;
+	size_t firstIndex = 0, indexCnt = 0;
+};
+
+/*
+the draws of a single glMultiDrawElementsBaseVertex call, kept in the three arrays the call takes.
+it only collects commands and makes no GL calls.
+*/
+class DrawCommandList {
+public:
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets; //byte offsets into the element buffer
+	std::vector<GLint> baseVertices;
+
+	void Clear();
+	void Add(GLsizei count, size_t firstIndex, GLint baseVertex);
+	void Add(const MeshAllocation& alloc) { Add((GLsizei)alloc.indexCnt, alloc.firstIndex, (GLint)alloc.firstVertex); }
+	size_t size() const { return counts.size(); }
+	bool empty() const { return counts.empty(); }
+};
+
+/*
+shared GL buffers for every mesh of the chunk vertex format(position, uv + texture layer), behind one VAO.
+meshes are ranges of these buffers, and a whole pass is drawn with one multi draw call instead of
+binding a VAO and drawing once per mesh. indices of a mesh stay relative to its first vertex,
+the base vertex of its draw command offsets them.
+buffers double in size when full, their contents are copied over on the GPU.
+*/
+class MeshArena {
+public:
+	static constexpr size_t INITIAL_VERTICES = 1 << 20, INITIAL_INDICES = 3 << 19;
+
+	struct Stats {
+		size_t frames = 0;
+		size_t drawCalls = 0; //multi draw calls issued
+		size_t commands = 0; //meshes drawn by those calls
+	};
+
+	static MeshArena& GetInstance() {
+		static MeshArena instance;
+		return instance;
+	}
+
+	// copies a mesh into the buffers. 3 floats per vertex position and uv, indices start at 0.
+	void Upload(const std::vector<GLfloat>& vtxdata, const std::vector<GLfloat>& uvdata, const std::vector<GLuint>& idxdata, OUT MeshAllocation& alloc);
+	void Free(MeshAllocation& alloc);
+
+	// binds the arena's VAO and draws every command of the list. empty lists draw nothing.
+	void Draw(const DrawCommandList& cmds);
+
+	// frame statistics. call once per frame after the last draw.
+	void EndFrame();
+	const Stats& LastFrameStats() const { return lastFrame; }
+	const Stats& TotalStats() const { return total; }
+
+	size_t VertexCapacity() const { return vertices.Capacity(); }
+	size_t IndexCapacity() const { return indices.Capacity(); }
+
+private:
+	MeshArena() = default;
+	MeshArena(MeshArena const& other) = delete;
+	MeshArena& operator=(MeshArena const& other) = delete;
+
+	void create();
+	void growVertices(size_t minCapacity);
+	void growIndices(size_t minCapacity);
+	void linkAttribs();
+
+	bool created = false;
+	VAO vao;
+	VBO vbo_pos, vbo_uv;
+	EBO ebo;
+	RangeAllocator vertices, indices;
+	Stats current, lastFrame, total;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include "GLObjects.h"
 
 #define INOUT
@@ -8,6 +9,7 @@
 // forward declarations
 class Block;
 class BlockDB;
+class Simulation;
 
 struct BlockMeshData {
 	std::vector<std::vector<float>> faceVerticesData;
@@ -36,11 +38,19 @@ public:
 		CUBE, FLOWER
 	};
 
+	// block behaviour, run by the Simulation(see BlockTicks). blockIdx is the block's world index.
+	using TickHandler = void (*)(Simulation& sim, const glm::ivec3& blockIdx);
+
 	struct BlockDataRow {
 		BlockType type;
 		std::vector<BlockTextures> faceTextures;		//which Texture to put on each face
 		RenderType renderType;
 		MeshType meshType;
+		bool collides = true; //blocks movement. flowers, water and air don't
+		uint8_t lightOpacity = 0; //light lost passing through, on top of the 1 every step costs. opaque cubes stop light regardless
+		TickHandler onScheduledTick = nullptr; //runs tickDelay ticks after the block or a neighbour changed
+		TickHandler onRandomTick = nullptr; //runs when the block is picked by the random ticks
+		int tickDelay = 1;
 
 		int numFaces() {
 			return faceTextures.size();
@@ -54,6 +64,14 @@ public:
 
 	std::vector<BlockDataRow> tbl;
 	bool isSolidCube(BlockType ty);
+	bool isOpaqueCube(BlockType ty); //solid cubes that cannot be seen through, unlike water
+	bool collides(BlockType ty) const { return tbl[ty].collides; }
+	// light levels are 0(dark) to MAX_LIGHT(open sky)
+	static constexpr int MAX_LIGHT = 15;
+	int lightOpacity(BlockType ty); //MAX_LIGHT for opaque cubes
+	// handlers are registered once, before the simulation starts ticking
+	void SetScheduledTick(BlockType ty, TickHandler handler, int delay) { tbl[ty].onScheduledTick = handler, tbl[ty].tickDelay = delay; }
+	void SetRandomTick(BlockType ty, TickHandler handler) { tbl[ty].onRandomTick = handler; }
 	BlockMeshData& GetMeshData(MeshType ty);
 
 private:
@@ -62,6 +80,11 @@ private:
 	BlockDB& operator=(BlockDB const& other) = delete;
 };
 
+//a change to one block, for World::ApplyEdits
+struct BlockEdit {
+	glm::ivec3 block; //world block index
+	BlockDB::BlockType type; //what the block becomes
+};
 
 class Block {
 public:
@@ -0,0 +1,41 @@
+#include "blockticks.h"
+#include "world.h"
+#include "chunkindex.h"
+
+void BlockTicks::Schedule(const glm::ivec3& blockIdx, uint64_t tick, Action action) {
+	// a block's delay doesn't change, so the tick already pending is due no later than this one
+	if (action == BLOCK_TICK && !pendingBlockTicks.insert(ChunkIndex::PackKey(blockIdx.x, blockIdx.y, blockIdx.z)).second) return;
+	heap.push({ tick, nextOrder++, blockIdx, action });
+}
+
+bool BlockTicks::PopDue(uint64_t tick, Event& event) {
+	if (heap.empty() || heap.top().tick > tick) return false;
+	event = heap.top();
+	heap.pop();
+	if (event.action == BLOCK_TICK) pendingBlockTicks.erase(ChunkIndex::PackKey(event.block.x, event.block.y, event.block.z));
+	return true;
+}
+
+void BlockTicks::SampleRandomTicks(World& world, std::vector<glm::ivec3>& blocks) {
+	static_assert(Chunk::HEIGHT % SECTION_HEIGHT == 0, "sections must split a chunk evenly");
+	blocks.clear();
+	BlockDB& blockDB = BlockDB::GetInstance();
+	static_assert(Chunk::SZ == 32 && SECTION_HEIGHT == 8, "a sample takes 5 + 3 + 5 bits of one random number");
+	for (auto& [cidx, chunk] : world.visChunks) {
+		if (!chunk->initialized) continue;
+		for (int section = 0; section < Chunk::HEIGHT; section += SECTION_HEIGHT) {
+			for (int n = 0; n < RANDOM_TICKS_PER_SECTION; ++n) {
+				uint32_t bits = rng();
+				int i = bits & 31, j = section + ((bits >> 5) & 7), k = (bits >> 8) & 31;
+				if (blockDB.tbl[chunk->grid[i][j][k]].onRandomTick) blocks.push_back(chunk->basepos + glm::ivec3(i, j, k));
+			}
+		}
+	}
+}
+
+void BlockTicks::Clear() {
+	heap = {};
+	pendingBlockTicks.clear();
+	nextOrder = 0;
+	rng.seed(1);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#ifndef BLOCKTICKS_H
+#define BLOCKTICKS_H
+
+#include <vector>
+#include <queue>
+#include <unordered_set>
+#include <random>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+class World;
+
+/*
+when block behaviour runs, so that it only runs for the blocks that need it:
+	- scheduled ticks: events (tick, block, action) in a min-heap by tick. a block's BlockDB onScheduledTick is
+	  scheduled tickDelay ticks after the block or a neighbour changed, which is how sand notices that what held it
+	  is gone. the dig timer is an event too. a block tick is only scheduled once while it is pending.
+	- random ticks: RANDOM_TICKS_PER_SECTION blocks picked at random in every SECTION_HEIGHT high section of the
+	  decorated chunks in the view window, every RANDOM_TICK_INTERVAL ticks, for slow changes like grass spreading
+	  and foliage decaying. only blocks with an onRandomTick are reported.
+the cost follows the events and the samples. nothing walks whole chunks.
+the owner(Simulation) pops the due events and runs them.
+*/
+class BlockTicks {
+public:
+	enum Action : uint8_t {
+		BLOCK_TICK, //the block's BlockDB onScheduledTick
+		DIG, //the block being dug breaks, if the player is still at it
+	};
+
+	struct Event {
+		uint64_t tick;
+		uint64_t order; //events due at the same tick run in the order they were scheduled
+		glm::ivec3 block;
+		Action action;
+	};
+
+	static constexpr int SECTION_HEIGHT = 8;
+	static constexpr int RANDOM_TICKS_PER_SECTION = 3;
+	static constexpr int RANDOM_TICK_INTERVAL = 3; //ticks between random ticks. a block is picked about every two minutes.
+	// events due in one tick past this wait for the next one
+	static constexpr size_t MAX_EVENTS_PER_TICK = 4096;
+
+	void Schedule(const glm::ivec3& blockIdx, uint64_t tick, Action action);
+	// removes the earliest event due at tick. false if there is none.
+	bool PopDue(uint64_t tick, Event& event);
+	// the blocks picked for this tick's random ticks that have a handler, by world index. blocks is cleared first.
+	void SampleRandomTicks(World& world, std::vector<glm::ivec3>& blocks);
+	size_t Size() const { return heap.size(); }
+	// drops the events, and restarts the random ticks from the seed
+	void Clear();
+
+private:
+	struct Later {
+		bool operator()(const Event& a, const Event& b) const { return a.tick != b.tick ? a.tick > b.tick : a.order > b.order; }
+	};
+
+	std::priority_queue<Event, std::vector<Event>, Later> heap;
+	std::unordered_set<uint64_t> pendingBlockTicks; //keys of the blocks with a BLOCK_TICK in heap
+	uint64_t nextOrder = 0;
+	std::mt19937 rng{ 1 }; //seeded, so replays pick the same blocks
+};
+
+#endif
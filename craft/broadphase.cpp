@@ -0,0 +1,220 @@
+#include "broadphase.h"
+#include "chunkindex.h"
+#include <cmath>
+#include <algorithm>
+
+SpatialHash::SpatialHash() {
+	Clear();
+}
+
+glm::ivec3 SpatialHash::cellOf(const glm::vec3& p) {
+	// block i spans [i - 0.5, i + 0.5), and cell c holds blocks [c * CELL_SIZE, (c + 1) * CELL_SIZE)
+	return glm::ivec3(glm::floor((p + 0.5f) / (float)CELL_SIZE));
+}
+
+bool SpatialHash::overlaps(const Body& a, const Body& b) {
+	return a.min.x < b.max.x && b.min.x < a.max.x
+		&& a.min.y < b.max.y && b.min.y < a.max.y
+		&& a.min.z < b.max.z && b.min.z < a.max.z;
+}
+
+void SpatialHash::Insert(Id id, const glm::vec3& min, const glm::vec3& size) {
+	if (Contains(id)) {
+		Update(id, min, size);
+		return;
+	}
+	if (id >= bodies.size()) bodies.resize(id + 1);
+	Body& body = bodies[id];
+	body.min = min;
+	body.max = min + size;
+	body.lo = cellOf(body.min);
+	body.hi = cellOf(body.max);
+	body.present = true;
+	bodyCnt++;
+	addToCells(id, body.lo, body.hi);
+}
+
+void SpatialHash::Update(Id id, const glm::vec3& min, const glm::vec3& size) {
+	if (!Contains(id)) {
+		Insert(id, min, size);
+		return;
+	}
+	Body& body = bodies[id];
+	body.min = min;
+	body.max = min + size;
+	glm::ivec3 lo = cellOf(body.min), hi = cellOf(body.max);
+	if (lo == body.lo && hi == body.hi) return;
+
+	rehashCnt++;
+	removeFromCells(id, body.lo, body.hi);
+	body.lo = lo;
+	body.hi = hi;
+	addToCells(id, lo, hi);
+}
+
+void SpatialHash::Remove(Id id) {
+	if (!Contains(id)) return;
+	Body& body = bodies[id];
+	removeFromCells(id, body.lo, body.hi);
+	body.present = false;
+	bodyCnt--;
+}
+
+void SpatialHash::Clear() {
+	bodies.clear();
+	bodyCnt = 0;
+	keys.assign(INITIAL_CAPACITY, 0);
+	slots.assign(INITIAL_CAPACITY, NO_CELL);
+	mask = INITIAL_CAPACITY - 1;
+	cells.clear();
+	cellIdx.clear();
+	freeCells.clear();
+	cellCnt = 0;
+	rehashCnt = 0;
+}
+
+size_t SpatialHash::TakeRehashCount() {
+	size_t n = rehashCnt;
+	rehashCnt = 0;
+	return n;
+}
+
+void SpatialHash::addToCells(Id id, const glm::ivec3& lo, const glm::ivec3& hi) {
+	for (int x = lo.x; x <= hi.x; ++x)
+		for (int y = lo.y; y <= hi.y; ++y)
+			for (int z = lo.z; z <= hi.z; ++z)
+				cells[findOrAddCell({ x, y, z })].push_back(id);
+}
+
+void SpatialHash::removeFromCells(Id id, const glm::ivec3& lo, const glm::ivec3& hi) {
+	for (int x = lo.x; x <= hi.x; ++x) {
+		for (int y = lo.y; y <= hi.y; ++y) {
+			for (int z = lo.z; z <= hi.z; ++z) {
+				uint32_t c = findCell({ x, y, z });
+				if (c == NO_CELL) continue;
+				std::vector<Id>& list = cells[c];
+				auto it = std::find(list.begin(), list.end(), id);
+				if (it == list.end()) continue;
+				*it = list.back();
+				list.pop_back();
+				if (list.empty()) eraseCell({ x, y, z });
+			}
+		}
+	}
+}
+
+uint32_t SpatialHash::findCell(const glm::ivec3& c) const {
+	uint64_t key = ChunkIndex::PackKey(c.x, c.y, c.z);
+	for (size_t s = ChunkIndex::MixKey(key) & mask;; s = (s + 1) & mask) {
+		if (keys[s] == key) return slots[s];
+		if (keys[s] == 0) return NO_CELL;
+	}
+}
+
+uint32_t SpatialHash::findOrAddCell(const glm::ivec3& c) {
+	// keep the load factor under 0.7 so probe sequences stay short
+	if ((cellCnt + 1) * 10 > keys.size() * 7) grow();
+
+	uint64_t key = ChunkIndex::PackKey(c.x, c.y, c.z);
+	size_t s = ChunkIndex::MixKey(key) & mask;
+	while (keys[s] != 0 && keys[s] != key) s = (s + 1) & mask;
+	if (keys[s] == key) return slots[s];
+
+	uint32_t list;
+	if (!freeCells.empty()) {
+		list = freeCells.back();
+		freeCells.pop_back();
+		cellIdx[list] = c;
+	}
+	else {
+		list = (uint32_t)cells.size();
+		cells.emplace_back();
+		cellIdx.push_back(c);
+	}
+	keys[s] = key;
+	slots[s] = list;
+	cellCnt++;
+	return list;
+}
+
+void SpatialHash::eraseCell(const glm::ivec3& c) {
+	uint64_t key = ChunkIndex::PackKey(c.x, c.y, c.z);
+	size_t s = ChunkIndex::MixKey(key) & mask;
+	while (keys[s] != key) {
+		if (keys[s] == 0) return;
+		s = (s + 1) & mask;
+	}
+	freeCells.push_back(slots[s]);
+
+	// backward shift deletion, as in ChunkIndex::ChunkHashMap::Erase
+	size_t hole = s;
+	for (size_t n = (hole + 1) & mask; keys[n] != 0; n = (n + 1) & mask) {
+		size_t home = ChunkIndex::MixKey(keys[n]) & mask;
+		bool movable = (hole <= n) ? (home <= hole || home > n) : (home <= hole && home > n);
+		if (movable) {
+			keys[hole] = keys[n];
+			slots[hole] = slots[n];
+			hole = n;
+		}
+	}
+	keys[hole] = 0;
+	slots[hole] = NO_CELL;
+	cellCnt--;
+}
+
+void SpatialHash::grow() {
+	std::vector<uint64_t> oldKeys(keys.size() * 2, 0);
+	std::vector<uint32_t> oldSlots(slots.size() * 2, NO_CELL);
+	oldKeys.swap(keys);
+	oldSlots.swap(slots);
+	mask = keys.size() - 1;
+
+	for (size_t s = 0; s < oldKeys.size(); ++s) {
+		if (oldKeys[s] == 0) continue;
+		size_t n = ChunkIndex::MixKey(oldKeys[s]) & mask;
+		while (keys[n] != 0) n = (n + 1) & mask;
+		keys[n] = oldKeys[s];
+		slots[n] = oldSlots[s];
+	}
+}
+
+void SpatialHash::CandidatePairs(std::vector<Pair>& pairs) const {
+	pairs.clear();
+	// the lists of erased cells are empty, so they skip themselves
+	for (size_t cell = 0; cell < cells.size(); ++cell) {
+		const std::vector<Id>& list = cells[cell];
+		if (list.size() < 2) continue;
+		const glm::ivec3& c = cellIdx[cell];
+		for (size_t i = 0; i < list.size(); ++i) {
+			const Body& a = bodies[list[i]];
+			for (size_t j = i + 1; j < list.size(); ++j) {
+				const Body& b = bodies[list[j]];
+				// the first cell both cover is the one at the larger of their minimum cells
+				if (glm::max(a.lo, b.lo) != c || !overlaps(a, b)) continue;
+				pairs.emplace_back(std::min(list[i], list[j]), std::max(list[i], list[j]));
+			}
+		}
+	}
+}
+
+void SpatialHash::Query(const glm::vec3& min, const glm::vec3& size, std::vector<Id>& out) const {
+	out.clear();
+	Body box;
+	box.min = min;
+	box.max = min + size;
+	box.lo = cellOf(box.min);
+	box.hi = cellOf(box.max);
+	for (int x = box.lo.x; x <= box.hi.x; ++x) {
+		for (int y = box.lo.y; y <= box.hi.y; ++y) {
+			for (int z = box.lo.z; z <= box.hi.z; ++z) {
+				uint32_t c = findCell({ x, y, z });
+				if (c == NO_CELL) continue;
+				for (Id id : cells[c]) {
+					const Body& body = bodies[id];
+					if (glm::max(body.lo, box.lo) != glm::ivec3(x, y, z) || !overlaps(body, box)) continue;
+					out.push_back(id);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/*
+broadphase for moving bodies: a uniform grid of cells CELL_SIZE blocks on a side, aligned to the blocks,
+stored sparsely in a hash map from cell index to the bodies overlapping the cell.
+each body is an AABB given by its minimum corner and size. for swept tests, insert the box a body sweeps over a step.
+
+bodies are updated in place as they move. a body's cells are only touched when its box crosses a cell boundary,
+which for bodies of about a block moving a few blocks per second is a small fraction of the updates.
+
+CandidatePairs() lists the pairs of bodies whose boxes overlap, each pair once, for a narrowphase to test:
+a pair is only reported by the first cell the two share, so no pair has to be looked up twice.
+*/
+class SpatialHash {
+public:
+	using Id = uint32_t;
+	using Pair = std::pair<Id, Id>; //smaller id first
+
+	static constexpr int CELL_SIZE = 2; //in blocks
+
+	SpatialHash();
+
+	// id is the caller's, any small integer. ids index an array, so keep them dense.
+	void Insert(Id id, const glm::vec3& min, const glm::vec3& size);
+	void Update(Id id, const glm::vec3& min, const glm::vec3& size);
+	void Remove(Id id);
+	bool Contains(Id id) const { return id < bodies.size() && bodies[id].present; }
+	void Clear();
+
+	size_t Size() const { return bodyCnt; }
+	size_t CellCount() const { return cellCnt; }
+	// updates since the last call that moved a body to other cells
+	size_t TakeRehashCount();
+
+	// pairs of bodies whose boxes overlap. pairs is cleared first.
+	void CandidatePairs(std::vector<Pair>& pairs) const;
+	// bodies whose boxes overlap the box, each once. out is cleared first.
+	void Query(const glm::vec3& min, const glm::vec3& size, std::vector<Id>& out) const;
+
+private:
+	struct Body {
+		glm::vec3 min, max;
+		glm::ivec3 lo, hi; //range of cells covered, inclusive
+		bool present = false;
+	};
+	static constexpr uint32_t NO_CELL = UINT32_MAX;
+	static constexpr size_t INITIAL_CAPACITY = 1024; //must be a power of two
+
+	static glm::ivec3 cellOf(const glm::vec3& p);
+	static bool overlaps(const Body& a, const Body& b);
+
+	void addToCells(Id id, const glm::ivec3& lo, const glm::ivec3& hi);
+	void removeFromCells(Id id, const glm::ivec3& lo, const glm::ivec3& hi);
+	uint32_t findCell(const glm::ivec3& c) const;
+	uint32_t findOrAddCell(const glm::ivec3& c);
+	void eraseCell(const glm::ivec3& c);
+	void grow();
+
+	std::vector<Body> bodies; //by id
+	size_t bodyCnt = 0;
+
+	// open addressing map, with linear probing, from packed cell index to a list in cells.
+	// like ChunkIndex::ChunkHashMap, a key of 0 marks an empty slot and erasing shifts entries back.
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> slots;
+	size_t mask;
+	std::vector<std::vector<Id>> cells; //bodies per cell. emptied lists keep their memory for the next cell.
+	std::vector<glm::ivec3> cellIdx; //per list
+	std::vector<uint32_t> freeCells;
+	size_t cellCnt = 0;
+	size_t rehashCnt = 0;
+};
+
+#endif
@@ -26,6 +26,10 @@ const float PITCH = 0.0f;
 const float SPEED = 5.0f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f; //(FOV)
+// depth precision falls off with distance / near plane, and the far plane reaches past the distant terrain ring.
+// the player's eye stays half a block from any wall or ceiling, and the corners of this plane are
+// about 1.16x its distance from the eye at this fov, so it never reaches into a block.
+const float NEAR_PLANE = 0.4f;
 
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
 class Camera
@@ -66,7 +70,7 @@ public:
         this->pitch = pitch;
 
         worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
-        perspective = glm::perspective(glm::radians(45.0f), (float)(screenWidth / screenHeight), 0.1f, 200.0f);
+        perspective = glm::perspective(glm::radians(45.0f), (float)(screenWidth / screenHeight), NEAR_PLANE, 200.0f);
         inversePerspective = glm::inverse(perspective);
         updateCameraVectors();
     }
@@ -83,6 +87,20 @@ public:
         return perspective;
     }
 
+    // places the camera, e.g. at the start of a replayed run.
+    void SetPose(const glm::vec3& pos, float yaw, float pitch) {
+        this->position = pos;
+        this->yaw = yaw;
+        this->pitch = pitch;
+        updateCameraVectors();
+    }
+
+    // moves the far clipping plane, e.g. when the view distance changes.
+    void SetFarPlane(float farPlane) {
+        perspective = glm::perspective(glm::radians(45.0f), (float)(screenWidth / screenHeight), NEAR_PLANE, farPlane);
+        inversePerspective = glm::inverse(perspective);
+    }
+
     // Raycasting
     glm::vec3 ScreenPointToRay(float mouseX, float mouseY) {
         mouseX = 2 * mouseX / screenWidth - 1;
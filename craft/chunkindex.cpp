@@ -0,0 +1,129 @@
+#include "chunkindex.h"
+#include <algorithm>
+
+namespace ChunkIndex {
+
+	static inline int wrap(int v, int n) {
+		v %= n;
+		return v < 0 ? v + n : v;
+	}
+
+	//-------- ChunkHashMap
+
+	ChunkHashMap::ChunkHashMap() {
+		Clear();
+	}
+
+	size_t ChunkHashMap::slotOf(uint64_t key) const {
+		return MixKey(key) & mask;
+	}
+
+	Chunk* ChunkHashMap::Find(int x, int y, int z) const {
+		uint64_t key = PackKey(x, y, z);
+		for (size_t s = slotOf(key);; s = (s + 1) & mask) {
+			if (keys[s] == key) return entries[s].second;
+			if (keys[s] == 0) return nullptr;
+		}
+	}
+
+	void ChunkHashMap::Insert(const p3i& idx, Chunk* chunk) {
+		// keep the load factor under 0.7 so probe sequences stay short
+		if ((cnt + 1) * 10 > keys.size() * 7) grow();
+
+		auto [x, y, z] = idx;
+		uint64_t key = PackKey(x, y, z);
+		size_t s = slotOf(key);
+		while (keys[s] != 0 && keys[s] != key) s = (s + 1) & mask;
+		if (keys[s] == 0) cnt++;
+		keys[s] = key;
+		entries[s] = { idx, chunk };
+	}
+
+	bool ChunkHashMap::Erase(const p3i& idx) {
+		auto [x, y, z] = idx;
+		uint64_t key = PackKey(x, y, z);
+		size_t s = slotOf(key);
+		while (keys[s] != key) {
+			if (keys[s] == 0) return false;
+			s = (s + 1) & mask;
+		}
+
+		// backward shift deletion: pull later entries of the probe sequence into the hole,
+		// so that lookups never need tombstones.
+		size_t hole = s;
+		for (size_t n = (hole + 1) & mask; keys[n] != 0; n = (n + 1) & mask) {
+			size_t home = slotOf(keys[n]);
+			// entry at n may move into the hole only if its home slot is not inside (hole, n]
+			bool movable = (hole <= n) ? (home <= hole || home > n) : (home <= hole && home > n);
+			if (movable) {
+				keys[hole] = keys[n];
+				entries[hole] = entries[n];
+				hole = n;
+			}
+		}
+		keys[hole] = 0;
+		entries[hole] = { {}, nullptr };
+		cnt--;
+		return true;
+	}
+
+	void ChunkHashMap::Clear() {
+		keys.assign(INITIAL_CAPACITY, 0);
+		entries.assign(INITIAL_CAPACITY, { {}, nullptr });
+		mask = INITIAL_CAPACITY - 1;
+		cnt = 0;
+	}
+
+	void ChunkHashMap::grow() {
+		std::vector<uint64_t> oldKeys(keys.size() * 2, 0);
+		std::vector<Entry> oldEntries(entries.size() * 2, { {}, nullptr });
+		oldKeys.swap(keys);
+		oldEntries.swap(entries);
+		mask = keys.size() - 1;
+
+		for (size_t s = 0; s < oldKeys.size(); ++s) {
+			if (oldKeys[s] == 0) continue;
+			size_t n = slotOf(oldKeys[s]);
+			while (keys[n] != 0) n = (n + 1) & mask;
+			keys[n] = oldKeys[s];
+			entries[n] = oldEntries[s];
+		}
+	}
+
+	//-------- ChunkWindow
+
+	ChunkWindow::ChunkWindow(int width, int height) {
+		Resize(width, height);
+	}
+
+	void ChunkWindow::Resize(int w, int h) {
+		width = w, height = h;
+		slots.assign((size_t)width * height * width, { {}, nullptr });
+	}
+
+	size_t ChunkWindow::slotOf(int x, int y, int z) const {
+		return ((size_t)wrap(x, width) * height + wrap(y, height)) * width + wrap(z, width);
+	}
+
+	Chunk* ChunkWindow::Find(int x, int y, int z) const {
+		const Entry& e = slots[slotOf(x, y, z)];
+		if (e.second == nullptr) return nullptr;
+		auto [ex, ey, ez] = e.first;
+		return (ex == x && ey == y && ez == z) ? e.second : nullptr;
+	}
+
+	Entry& ChunkWindow::SlotFor(const p3i& idx) {
+		auto [x, y, z] = idx;
+		return slots[slotOf(x, y, z)];
+	}
+
+	void ChunkWindow::Clear() {
+		std::fill(slots.begin(), slots.end(), Entry{ {}, nullptr });
+	}
+
+	size_t ChunkWindow::size() const {
+		size_t n = 0;
+		for (auto& e : slots) if (e.second) n++;
+		return n;
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+#ifndef CHUNKINDEX_H
+#define CHUNKINDEX_H
+
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+class Chunk;
+
+/*
+chunk lookups happen per voxel in collision checks, per step in raycasts and per neighbour when meshing,
+so the containers here answer "which chunk has index (i, j, k)" in O(1) instead of walking a tree.
+both containers iterate as (p3i, Chunk*) pairs, just like the std::map they replace.
+*/
+namespace ChunkIndex {
+	using p3i = std::tuple<int, int, int>;
+	using Entry = std::pair<p3i, Chunk*>;
+
+	// iterates over the entries of a slot array, skipping the empty ones.
+	template<class EntryTy>
+	class SlotIterator {
+	public:
+		SlotIterator(EntryTy* cur, EntryTy* end) : cur(cur), end(end) { skip(); }
+		EntryTy& operator*() const { return *cur; }
+		EntryTy* operator->() const { return cur; }
+		SlotIterator& operator++() { ++cur; skip(); return *this; }
+		bool operator!=(const SlotIterator& other) const { return cur != other.cur; }
+		bool operator==(const SlotIterator& other) const { return cur == other.cur; }
+	private:
+		void skip() { while (cur != end && cur->second == nullptr) ++cur; }
+		EntryTy* cur;
+		EntryTy* end;
+	};
+
+	// a / b rounded toward negative infinity, for b > 0. turns block coordinates into chunk, tile or region indices.
+	inline int FloorDiv(int a, int b) {
+		return a >= 0 ? a / b : -((-a - 1) / b) - 1;
+	}
+
+	// splitmix64 finalizer. neighbouring indices differ only in the low bits of one axis,
+	// so a packed key must be mixed before it is masked down to a slot.
+	inline uint64_t MixKey(uint64_t key) {
+		key ^= key >> 30;
+		key *= 0xbf58476d1ce4e5b9ull;
+		key ^= key >> 27;
+		key *= 0x94d049bb133111ebull;
+		key ^= key >> 31;
+		return key;
+	}
+
+	// packs a chunk index into 63 bits(21 bits per axis), the top bit marks an occupied slot.
+	// chunk indices are therefore limited to [-2^20, 2^20), which is more than 33 million blocks in every direction.
+	inline uint64_t PackKey(int x, int y, int z) {
+		constexpr uint64_t MASK = (1ull << 21) - 1;
+		return (1ull << 63) | ((uint64_t)(x & MASK) << 42) | ((uint64_t)(y & MASK) << 21) | (uint64_t)(z & MASK);
+	}
+
+	/*
+	open addressing hash map from chunk index to chunk, with linear probing.
+	used for allChunks, which only grows as the player explores.
+	*/
+	class ChunkHashMap {
+	public:
+		using iterator = SlotIterator<Entry>;
+
+		ChunkHashMap();
+
+		Chunk* Find(int x, int y, int z) const;
+		Chunk* Find(const glm::ivec3& idx) const { return Find(idx.x, idx.y, idx.z); }
+		Chunk* Find(const p3i& idx) const { return Find(std::get<0>(idx), std::get<1>(idx), std::get<2>(idx)); }
+
+		// inserts or overwrites. chunk must not be null.
+		void Insert(const p3i& idx, Chunk* chunk);
+		bool Erase(const p3i& idx);
+		void Clear();
+
+		size_t size() const { return cnt; }
+		iterator begin() { return iterator(entries.data(), entries.data() + entries.size()); }
+		iterator end() { return iterator(entries.data() + entries.size(), entries.data() + entries.size()); }
+
+	private:
+		static constexpr size_t INITIAL_CAPACITY = 256; //must be a power of two
+		size_t slotOf(uint64_t key) const;
+		void grow();
+
+		std::vector<uint64_t> keys; //0 means empty
+		std::vector<Entry> entries;
+		size_t cnt = 0;
+		size_t mask;
+	};
+
+	/*
+	toroidal array covering the visible window of chunks.
+	a chunk index maps to slot (i mod W, j mod H, k mod W), so when the window moves
+	the chunk that falls out of view is exactly the one sitting in the slot the new chunk needs.
+	*/
+	class ChunkWindow {
+	public:
+		using iterator = SlotIterator<Entry>;
+
+		ChunkWindow(int width, int height);
+
+		// changes the window size and empties the window.
+		void Resize(int width, int height);
+
+		Chunk* Find(int x, int y, int z) const;
+		Chunk* Find(const glm::ivec3& idx) const { return Find(idx.x, idx.y, idx.z); }
+		Chunk* Find(const p3i& idx) const { return Find(std::get<0>(idx), std::get<1>(idx), std::get<2>(idx)); }
+
+		// the entry whose slot idx maps to. it may hold another chunk, or nothing(chunk == nullptr).
+		Entry& SlotFor(const p3i& idx);
+
+		// places chunk in its slot, replacing whatever was there.
+		void Insert(const p3i& idx, Chunk* chunk) { SlotFor(idx) = { idx, chunk }; }
+		void Clear();
+
+		int Width() const { return width; }
+		int Height() const { return height; }
+		size_t size() const;
+		iterator begin() { return iterator(slots.data(), slots.data() + slots.size()); }
+		iterator end() { return iterator(slots.data() + slots.size(), slots.data() + slots.size()); }
+
+	private:
+		size_t slotOf(int x, int y, int z) const;
+
+		int width, height;
+		std::vector<Entry> slots;
+	};
+}
+
+#endif
@@ -65,86 +65,72 @@ namespace Collision {
 		return normal;
 	}
 
+	void CollisionCheck::sweepAxis(float start, float dim, float vel, float lo, float scale,
+		float& entry, float& t_entry, float& t_exit) {
+		float exit;
+		if (vel > 0.0f) {
+			entry = lo - (start + dim);
+			exit = (lo + scale) - start;
+		}
+		else {
+			entry = (lo + scale) - start;
+			exit = lo - (start + dim);
+		}
+		// check for division by zero
+		if (vel == 0.0f) {
+			if (start >= lo + scale || start + dim <= lo) t_entry = std::numeric_limits<float>::infinity();
+			else t_entry = -std::numeric_limits<float>::infinity();
+			t_exit = std::numeric_limits<float>::infinity();
+		}
+		else {
+			t_entry = entry / vel;
+			t_exit = exit / vel;
+		}
+	}
+
 	Collision CollisionCheck::GetFirstHit(const std::vector<AABB>& boxes) {
-		// sort all existing collosions in order of entry time
-		
-		using entry_pair = std::pair<float, EntryEvent>;
-		std::vector<entry_pair> entry_events;
+		// keep the earliest entry. on a tie the box that comes first wins.
+		float bestTime = std::numeric_limits<float>::infinity();
+		EntryEvent best{};
 		for (const auto& box : boxes) {
-			float entryTime, exitTime;
-			// distances
-			float x_entry, y_entry, z_entry;
-			float x_exit, y_exit, z_exit;
-			// time, as proportion of velocity
-			float xt_entry, yt_entry, zt_entry;
-			float xt_exit, yt_exit, zt_exit;
-
-			// TODO: compute xyz.
-			if (velocity.x > 0.0f) {
-				x_entry = box.start.x - (start_pos.x + box_dim.x);
-				x_exit = (box.start.x + box.scale.x) - start_pos.x;
-			}
-			else {
-				x_entry = (box.start.x + box.scale.x) - start_pos.x;
-				x_exit = box.start.x - (start_pos.x + box_dim.x);
-			}
-			if (velocity.y > 0.0f) {
-				y_entry = box.start.y - (start_pos.y + box_dim.y);
-				y_exit = (box.start.y + box.scale.y) - start_pos.y;
-			}
-			else {
-				y_entry = (box.start.y + box.scale.y) - start_pos.y;
-				y_exit = box.start.y - (start_pos.y + box_dim.y);
-			}
-			if (velocity.z > 0.0f) {
-				z_entry = box.start.z - (start_pos.z + box_dim.z);
-				z_exit = (box.start.z + box.scale.z) - start_pos.z;
-			}
-			else {
-				z_entry = (box.start.z + box.scale.z) - start_pos.z;
-				//if(box.blkTy == 7) std::cout << (box.start.z + box.scale.z) << "-" << start_pos.z << '\n';
-				z_exit = box.start.z - (start_pos.z + box_dim.z);
-			}
-			// compute xt, yt, and zt.
-			// check for division by zero
-			if (velocity.x == 0.0f) {
-				if (start_pos.x >= box.start.x + box.scale.x || start_pos.x + box_dim.x <= box.start.x) xt_entry = std::numeric_limits<float>::infinity();
-				else xt_entry = -std::numeric_limits<float>::infinity();
-				xt_exit = std::numeric_limits<float>::infinity();
-			}
-			else {
-				xt_entry = x_entry / velocity.x;
-				xt_exit = x_exit / velocity.x;
-			}
-			if (velocity.y == 0.0f) {
-				if (start_pos.y >= box.start.y + box.scale.y || start_pos.y + box_dim.y <= box.start.y) yt_entry = std::numeric_limits<float>::infinity();
-				else yt_entry = -std::numeric_limits<float>::infinity();
-				yt_exit = std::numeric_limits<float>::infinity();
-			}
-			else {
-				yt_entry = y_entry / velocity.y;
-				yt_exit = y_exit / velocity.y;
-			}
-			if (velocity.z == 0.0f) {
-				if (start_pos.z >= box.start.z + box.scale.z || start_pos.z + box_dim.z <= box.start.z) zt_entry = std::numeric_limits<float>::infinity();
-				else zt_entry = -std::numeric_limits<float>::infinity();
-				zt_exit = std::numeric_limits<float>::infinity();
-			}
-			else {
-				zt_entry = z_entry / velocity.z;
-				zt_exit = z_exit / velocity.z;
-			}
-			entryTime = std::max({ xt_entry, yt_entry, zt_entry });
-			exitTime = std::min({ xt_exit, yt_exit, zt_exit });
-			if (entryTime >= exitTime || entryTime < -0.0f || entryTime > 1.0f || exitTime < 0.0f) {
-				continue; // no hitwww
-			}
-			else {
-				entry_events.push_back({entryTime, {x_entry, y_entry, z_entry, xt_entry, yt_entry, zt_entry, box.blkTy}});
+			float entryTime;
+			EntryEvent entry;
+			if (!sweepBox(box, entryTime, entry)) continue; // no hit
+			if (entryTime < bestTime) {
+				bestTime = entryTime;
+				best = entry;
 			}
 		}
+		return makeCollision(bestTime == std::numeric_limits<float>::infinity() ? -1.0f : bestTime, best);
+	}
+
+	Collision CollisionCheck::GetFirstHit(const AABB& box) {
+		float entryTime;
+		EntryEvent entry;
+		if (!sweepBox(box, entryTime, entry)) return makeCollision(-1.0f, entry);
+		return makeCollision(entryTime, entry);
+	}
+
+	bool CollisionCheck::sweepBox(const AABB& box, float& entryTime, EntryEvent& entry) const {
+		float exitTime;
+		// distances
+		float x_entry, y_entry, z_entry;
+		// time, as proportion of velocity
+		float xt_entry, yt_entry, zt_entry;
+		float xt_exit, yt_exit, zt_exit;
 
-		if (entry_events.size() == 0) {
+		sweepAxis(start_pos.x, box_dim.x, velocity.x, box.start.x, box.scale.x, x_entry, xt_entry, xt_exit);
+		sweepAxis(start_pos.y, box_dim.y, velocity.y, box.start.y, box.scale.y, y_entry, yt_entry, yt_exit);
+		sweepAxis(start_pos.z, box_dim.z, velocity.z, box.start.z, box.scale.z, z_entry, zt_entry, zt_exit);
+		entryTime = std::max({ xt_entry, yt_entry, zt_entry });
+		exitTime = std::min({ xt_exit, yt_exit, zt_exit });
+		if (entryTime >= exitTime || entryTime < -0.0f || entryTime > 1.0f || exitTime < 0.0f) return false;
+		entry = { x_entry, y_entry, z_entry, xt_entry, yt_entry, zt_entry, box.blkTy };
+		return true;
+	}
+
+	Collision CollisionCheck::makeCollision(float entryTime, const EntryEvent& entry) {
+		if (entryTime < 0.0f) {
 			Collision col;
 			col.time = -1.0f;
 			col.stop_pos = end_pos;
@@ -154,9 +140,6 @@ namespace Collision {
 			return col;
 		}
 
-		std::sort(entry_events.begin(), entry_events.end(), [](const entry_pair& a, const entry_pair& b) {return a.first < b.first;});
-		auto [entryTime, entry] = entry_events[0];
-
 		Collision col;
 		col.time = entryTime;
 		col.vel = velocity;
@@ -167,15 +150,6 @@ namespace Collision {
 		col.normal = normal; 
 		float dotp = normal.x * col.remain_vel.x + normal.y * col.remain_vel.y + normal.z * col.remain_vel.z;
 		col.remain_vel = col.remain_vel - dotp * normal;
-
-		//if (entry_events.size() >= 2 && entry_events[1].first - entryTime < 0.01f) {
-		//	auto entry2 = entry_events[1].second;
-		//	normal = GetHitNormal(entry2);
-		//	dotp = normal.x * col.remain_vel.x + normal.y * col.remain_vel.y + normal.z * col.remain_vel.z;
-		//	col.remain_vel = col.remain_vel - dotp * normal;
-		//}
-		
-		//std::cout << "collided with " << entry.type << std::endl;
 		return col;
 	}
 }
\ No newline at end of file
@@ -6,6 +6,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <limits>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "blocks.hpp"
 // helper function, returns final position after collisions
@@ -54,14 +59,41 @@ namespace Collision {
 		AABB ComputeBroadphaseAABB();
 
 		// returns the first hit collision info.
-		// boxes: AABBs to check for collision with.
+		// boxes: AABBs to check for collision with. when several are hit at the same time, the first of them wins.
 		Collision GetFirstHit(const std::vector<AABB>& boxes);
+		Collision GetFirstHit(const AABB& box);
 
-		glm::vec3 GetHitNormal(EntryEvent entry);
+		// same as GetFirstHit() against the solid unit blocks centered at the integer positions (x, y, z)
+		// of the range [lo, hi], visited in x, y, z order. solidRow(x, y, z) returns the solidity of 32 blocks
+		// along z: bit i is set if the block at (x, y, z + i) is solid(see SolidRows in world.h).
+		// nothing is allocated, a whole x slice or y row the object can't reach first is skipped
+		// before it is looked up, and only the solid blocks of a row are swept.
+		template<typename SolidRow>
+		Collision GetFirstHit(glm::ivec3 lo, glm::ivec3 hi, SolidRow&& solidRow);
+
+		static glm::vec3 GetHitNormal(EntryEvent entry);
 		// returns the second hit, assumes GetFirstHit() is already called.
 		// Collision GetSecondHit();
 
 	private:
+		// index of the lowest set bit of a non zero word
+		static int countTrailingZeros(uint32_t word) {
+#ifdef _MSC_VER
+			unsigned long idx;
+			_BitScanForward(&idx, word);
+			return (int)idx;
+#else
+			return __builtin_ctz(word);
+#endif
+		}
+		// entry/exit distances and times along one axis, against an obstacle spanning [lo, lo + scale].
+		static void sweepAxis(float start, float dim, float vel, float lo, float scale,
+			float& entry, float& t_entry, float& t_exit);
+		// entry time against box and its entry event, false if the box isn't hit within the step.
+		bool sweepBox(const AABB& box, float& entryTime, EntryEvent& entry) const;
+		// the collision info for a hit at entryTime, or for no hit if entryTime < 0.
+		Collision makeCollision(float entryTime, const EntryEvent& entry);
+
 		glm::vec3 start_pos;
 		glm::vec3 end_pos;
 		glm::vec3 velocity;
@@ -69,4 +101,69 @@ namespace Collision {
 		Collision primary_collision;
 
 	};
+
+	// narrowphase for two moving boxes: the first hit of box a against box b, in the frame of b, where b stands still
+	// and a moves by the difference of their movements. stop_pos and remain_vel are relative to b's start.
+	// boxes that already overlap at the start are not a hit.
+	inline Collision SweepPair(glm::vec3 begin_a, glm::vec3 end_a, glm::vec3 dim_a, glm::vec3 begin_b, glm::vec3 end_b, glm::vec3 dim_b) {
+		CollisionCheck checker(begin_a, begin_a + (end_a - begin_a) - (end_b - begin_b), dim_a);
+		return checker.GetFirstHit(AABB(begin_b, dim_b, BlockDB::BlockType::BLOCK_COUNT));
+	}
+
+	// moves a box of box_dim from begin toward end through a grid of unit blocks, sliding along what it hits:
+	// up to three sweeps(one per surface the box may end up pressed against), all against the blocks
+	// overlapping the first sweep's broadphase AABB. solidRow(x, y, z) tells which of the blocks centered at (x, y, z + i),
+	// i in [0, 32), block movement, one bit each, as for GetFirstHit().
+	// returns the final position. if contacts is not null, it receives the sum of the normals of the surfaces hit.
+	// a surface stops the movement along its normal, so no axis is hit twice and each component is -1, 0 or 1.
+	template<typename SolidRow>
+	glm::vec3 SlideThroughVoxels(glm::vec3 begin, glm::vec3 end, glm::vec3 box_dim, SolidRow&& solidRow, glm::vec3* contacts = nullptr) {
+		CollisionCheck checker(begin, end, box_dim);
+		AABB swAABB = checker.ComputeBroadphaseAABB();
+		glm::ivec3 lo((int)(swAABB.start.x - 0.5f), (int)(swAABB.start.y - 0.5f), (int)(swAABB.start.z - 0.5f));
+		glm::ivec3 hi((int)(swAABB.start.x + swAABB.scale.x + 0.5f), (int)(swAABB.start.y + swAABB.scale.y + 0.5f), (int)(swAABB.start.z + swAABB.scale.z + 0.5f));
+
+		Collision col = checker.GetFirstHit(lo, hi, solidRow);
+		if (contacts) *contacts = col.normal;
+		for (int sweep = 1; sweep < 3; ++sweep) {
+			checker = CollisionCheck(col.stop_pos, col.stop_pos + col.remain_vel, box_dim);
+			col = checker.GetFirstHit(lo, hi, solidRow);
+			if (contacts) *contacts += col.normal;
+		}
+		return col.stop_pos + col.remain_vel;
+	}
+
+	template<typename SolidRow>
+	Collision CollisionCheck::GetFirstHit(glm::ivec3 lo, glm::ivec3 hi, SolidRow&& solidRow) {
+		float bestTime = std::numeric_limits<float>::infinity();
+		EntryEvent best{};
+		for (int x = lo.x; x <= hi.x; ++x) {
+			float x_entry, xt_entry, xt_exit;
+			sweepAxis(start_pos.x, box_dim.x, velocity.x, x - 0.5f, 1.0f, x_entry, xt_entry, xt_exit);
+			// every block of the slice enters no earlier than xt_entry, and leaves no later than xt_exit
+			if (xt_entry >= xt_exit || xt_entry > 1.0f || xt_exit < 0.0f || xt_entry >= bestTime) continue;
+			for (int y = lo.y; y <= hi.y; ++y) {
+				float y_entry, yt_entry, yt_exit;
+				sweepAxis(start_pos.y, box_dim.y, velocity.y, y - 0.5f, 1.0f, y_entry, yt_entry, yt_exit);
+				if (yt_entry >= yt_exit || yt_entry > 1.0f || yt_exit < 0.0f || yt_entry >= bestTime) continue;
+				for (int z0 = lo.z; z0 <= hi.z; z0 += 32) {
+					uint32_t row = solidRow(x, y, z0);
+					if (hi.z - z0 < 31) row &= (2u << (hi.z - z0)) - 1u; //the blocks past hi.z
+					// the solid blocks only, lowest z first
+					for (; row; row &= row - 1u) {
+						int z = z0 + countTrailingZeros(row);
+						float z_entry, zt_entry, zt_exit;
+						sweepAxis(start_pos.z, box_dim.z, velocity.z, z - 0.5f, 1.0f, z_entry, zt_entry, zt_exit);
+						float entryTime = std::max({ xt_entry, yt_entry, zt_entry });
+						float exitTime = std::min({ xt_exit, yt_exit, zt_exit });
+						if (entryTime >= exitTime || entryTime < -0.0f || entryTime > 1.0f || exitTime < 0.0f) continue;
+						if (entryTime >= bestTime) continue;
+						bestTime = entryTime;
+						best = { x_entry, y_entry, z_entry, xt_entry, yt_entry, zt_entry, BlockDB::BlockType::BLOCK_COUNT };
+					}
+				}
+			}
+		}
+		return makeCollision(bestTime == std::numeric_limits<float>::infinity() ? -1.0f : bestTime, best);
+	}
 }
\ No newline at end of file
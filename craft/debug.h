@@ -100,6 +100,38 @@ private:
 	EBO ebo;
 };
 
+// the AABBs of all entities, as lines
+class EntityBoxes : public Gizmo {
+public:
+	// boxes: minimum corner and size of each box, in pairs
+	void Build(const std::vector<glm::vec3>& boxes) {
+		static const int edges[12][2] = { {0,1},{1,3},{3,2},{2,0}, {4,5},{5,7},{7,6},{6,4}, {0,4},{1,5},{2,6},{3,7} };
+		vertices.clear();
+		for (size_t n = 0; n + 1 < boxes.size(); n += 2) {
+			const glm::vec3& mn = boxes[n], sz = boxes[n + 1];
+			for (auto& edge : edges) {
+				for (int corner : edge) {
+					vertices.push_back(mn.x + (corner & 1 ? sz.x : 0.0f));
+					vertices.push_back(mn.y + (corner & 2 ? sz.y : 0.0f));
+					vertices.push_back(mn.z + (corner & 4 ? sz.z : 0.0f));
+				}
+			}
+		}
+		vao.Bind();
+		vbo.BufferData(vertices.data(), sizeof(vertices[0]) * vertices.size());
+		vao.LinkAttrib(vbo, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
+		vao.Unbind();
+	}
+
+	void Render() {
+		if (vertices.empty()) return;
+		vao.Bind();
+		glDrawArrays(GL_LINES, 0, (GLsizei)(vertices.size() / 3));
+	}
+
+private:
+	std::vector<float> vertices;
+};
 
 class Debug {
 public:
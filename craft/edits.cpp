@@ -0,0 +1,69 @@
+#include "edits.h"
+
+void ChunkEditJournal::Record(int x, int y, int z, BlockType blkTy) {
+	deltas[VoxelIndex(x, y, z)] = static_cast<uint8_t>(blkTy);
+}
+
+void ChunkEditJournal::Compact(const BlockType grid[SZ][HEIGHT][SZ]) {
+	snapshot.resize(VOLUME);
+	const BlockType* src = &grid[0][0][0];
+	for (int n = 0; n < VOLUME; ++n) snapshot[n] = static_cast<uint8_t>(src[n]);
+	deltas.clear();
+}
+
+void ChunkEditJournal::Replay(BlockType grid[SZ][HEIGHT][SZ]) const {
+	BlockType* dst = &grid[0][0][0];
+	if (HasSnapshot()) {
+		for (int n = 0; n < VOLUME; ++n) dst[n] = static_cast<BlockType>(snapshot[n]);
+	}
+	for (auto& [idx, blkTy] : deltas) {
+		dst[idx] = static_cast<BlockType>(blkTy);
+	}
+}
+
+// save file layout of one journal:
+// u8 hasSnapshot | (VOLUME bytes of snapshot) | u32 delta count | count * (u16 index, u8 type)
+size_t ChunkEditJournal::SerializedSize() const {
+	return 1 + (HasSnapshot() ? VOLUME : 0) + 4 + deltas.size() * 3;
+}
+
+void ChunkEditJournal::Write(std::ostream& os) const {
+	uint8_t hasSnapshot = HasSnapshot() ? 1 : 0;
+	os.write(reinterpret_cast<const char*>(&hasSnapshot), 1);
+	if (hasSnapshot) os.write(reinterpret_cast<const char*>(snapshot.data()), VOLUME);
+
+	uint32_t cnt = static_cast<uint32_t>(deltas.size());
+	os.write(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+	for (auto& [idx, blkTy] : deltas) {
+		os.write(reinterpret_cast<const char*>(&idx), sizeof(idx));
+		os.write(reinterpret_cast<const char*>(&blkTy), sizeof(blkTy));
+	}
+}
+
+bool ChunkEditJournal::Read(std::istream& is) {
+	deltas.clear();
+	snapshot.clear();
+
+	uint8_t hasSnapshot = 0;
+	if (!is.read(reinterpret_cast<char*>(&hasSnapshot), 1)) return false;
+	if (hasSnapshot) {
+		snapshot.resize(VOLUME);
+		if (!is.read(reinterpret_cast<char*>(snapshot.data()), VOLUME)) return false;
+		for (uint8_t blkTy : snapshot) {
+			if (blkTy >= BlockType::BLOCK_COUNT) return false;
+		}
+	}
+
+	uint32_t cnt = 0;
+	if (!is.read(reinterpret_cast<char*>(&cnt), sizeof(cnt))) return false;
+	if (cnt > VOLUME) return false;
+	for (uint32_t n = 0; n < cnt; ++n) {
+		uint16_t idx;
+		uint8_t blkTy;
+		if (!is.read(reinterpret_cast<char*>(&idx), sizeof(idx))) return false;
+		if (!is.read(reinterpret_cast<char*>(&blkTy), sizeof(blkTy))) return false;
+		if (idx >= VOLUME || blkTy >= BlockType::BLOCK_COUNT) return false;
+		deltas[idx] = blkTy;
+	}
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef EDITS_H
+#define EDITS_H
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include "blocks.hpp"
+
+/*
+terrain is regenerated deterministically from the seed maps, so a chunk only needs to remember
+the blocks that were changed after generation. the journal records (voxel index -> new block type)
+and is replayed over the output of TerrainGeneration when the chunk is created again.
+once a chunk has been edited heavily, the deltas are compacted into a full snapshot of the grid.
+*/
+class ChunkEditJournal {
+public:
+	using BlockType = BlockDB::BlockType;
+	static constexpr int SZ = 32, HEIGHT = 32; //must match Chunk::SZ and Chunk::HEIGHT
+	static constexpr int VOLUME = SZ * HEIGHT * SZ;
+
+	// a delta entry takes 3 bytes on disk(2 for index, 1 for type) and a snapshot takes 1 byte per voxel.
+	// past this many entries the snapshot is smaller.
+	static constexpr size_t COMPACT_THRESHOLD = VOLUME / 3;
+
+	// voxel index -> block type placed there
+	std::unordered_map<uint16_t, uint8_t> deltas;
+
+	// full grid, only present after compaction. stored in the same x-y-z order as Chunk::grid
+	std::vector<uint8_t> snapshot;
+
+	static uint16_t VoxelIndex(int x, int y, int z) {
+		return static_cast<uint16_t>((x * HEIGHT + y) * SZ + z);
+	}
+
+	bool empty() const { return deltas.empty() && snapshot.empty(); }
+	bool HasSnapshot() const { return !snapshot.empty(); }
+	bool NeedsCompaction() const { return deltas.size() > COMPACT_THRESHOLD; }
+
+	void Record(int x, int y, int z, BlockType blkTy);
+
+	// true if replaying sets the block at (x, y, z): there is a snapshot, or a delta for it
+	bool Covers(int x, int y, int z) const { return HasSnapshot() || deltas.count(VoxelIndex(x, y, z)); }
+
+	// replaces the deltas with a copy of the whole grid
+	void Compact(const BlockType grid[SZ][HEIGHT][SZ]);
+
+	// writes the snapshot(if any) and then the deltas into grid
+	void Replay(BlockType grid[SZ][HEIGHT][SZ]) const;
+
+	// binary serialization. Read returns false if the stream ends early or holds corrupted values.
+	void Write(std::ostream& os) const;
+	bool Read(std::istream& is);
+
+	// number of bytes this journal takes in a save file
+	size_t SerializedSize() const;
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "entities.h"
+#include "world.h"
+#include "collision.h"
+#include "workers.h"
+#include "profiler.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+EntityStore::EntityStore() {
+	threads = WorkerPool::GetInstance().Threads();
+}
+
+EntityStore::Id EntityStore::Spawn(Kind k, const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& size, BlockDB::BlockType blk) {
+	Id id;
+	if (!freeIds.empty()) {
+		id = freeIds.back();
+		freeIds.pop_back();
+	}
+	else {
+		id = (Id)slotOf.size();
+		slotOf.push_back(INVALID_ID);
+	}
+	slotOf[id] = (Id)ids.size();
+	ids.push_back(id);
+	kind.push_back(k);
+	block.push_back(blk);
+	px.push_back(position.x), py.push_back(position.y), pz.push_back(position.z);
+	vx.push_back(velocity.x), vy.push_back(velocity.y), vz.push_back(velocity.z);
+	sx.push_back(size.x), sy.push_back(size.y), sz.push_back(size.z);
+	age.push_back(0.0f);
+	onGround.push_back(0);
+	broadphase.Insert(id, position, size);
+	return id;
+}
+
+void EntityStore::Despawn(Id id) {
+	if (!IsAlive(id)) return;
+	removeSlot(slotOf[id]);
+}
+
+void EntityStore::Clear() {
+	while (!ids.empty()) removeSlot(ids.size() - 1);
+}
+
+void EntityStore::removeSlot(size_t slot) {
+	// the last entity fills the hole
+	size_t last = ids.size() - 1;
+	Id id = ids[slot];
+	slotOf[id] = INVALID_ID;
+	freeIds.push_back(id);
+	broadphase.Remove(id);
+	if (slot != last) {
+		ids[slot] = ids[last];
+		slotOf[ids[slot]] = (Id)slot;
+		kind[slot] = kind[last];
+		block[slot] = block[last];
+		px[slot] = px[last], py[slot] = py[last], pz[slot] = pz[last];
+		vx[slot] = vx[last], vy[slot] = vy[last], vz[slot] = vz[last];
+		sx[slot] = sx[last], sy[slot] = sy[last], sz[slot] = sz[last];
+		age[slot] = age[last];
+		onGround[slot] = onGround[last];
+	}
+	ids.pop_back();
+	kind.pop_back();
+	block.pop_back();
+	px.pop_back(), py.pop_back(), pz.pop_back();
+	vx.pop_back(), vy.pop_back(), vz.pop_back();
+	sx.pop_back(), sy.pop_back(), sz.pop_back();
+	age.pop_back();
+	onGround.pop_back();
+}
+
+void EntityStore::bucketByChunk(World& world) {
+	size_t cnt = ids.size();
+	sortKeys.resize(cnt);
+	order.resize(cnt);
+	live.assign(cnt, 0.0f);
+	buckets.clear();
+
+	chunkOf.resize(cnt);
+	for (size_t n = 0; n < cnt; ++n) {
+		// the chunk holding the block at the entity's center
+		glm::vec3 center(px[n] + sx[n] * 0.5f, py[n] + sy[n] * 0.5f, pz[n] + sz[n] * 0.5f);
+		chunkOf[n] = Chunk::BlockToChunkIndex(glm::ivec3(glm::floor(center + 0.5f)));
+		// 12 bits of x and z and 8 of y. distant chunks may share a key, the split below tells them apart.
+		uint64_t key = ((uint64_t)(chunkOf[n].x & 0xFFF) << 20) | ((uint64_t)(chunkOf[n].y & 0xFF) << 12) | (uint64_t)(chunkOf[n].z & 0xFFF);
+		sortKeys[n] = key << 32 | n;
+	}
+	std::sort(sortKeys.begin(), sortKeys.end());
+
+	for (size_t n = 0; n < cnt; ++n) {
+		order[n] = (uint32_t)sortKeys[n];
+		const glm::ivec3& idx = chunkOf[order[n]];
+		if (buckets.empty() || buckets.back().chunkIdx != idx) {
+			if (!buckets.empty()) buckets.back().end = n;
+			buckets.push_back({ idx, world.GetChunkByIndex(idx), n, cnt });
+		}
+		if (buckets.back().chunk) live[order[n]] = 1.0f;
+	}
+}
+
+void EntityStore::integrate(float dt) {
+	// branch free loops over the arrays, so they vectorize
+	size_t cnt = ids.size();
+	const float gravity = GRAVITY * dt;
+	const float airDamp = std::pow(AIR_DRAG, dt), groundDamp = std::pow(GROUND_FRICTION, dt);
+	const float* l = live.data();
+	const uint8_t* ground = onGround.data();
+	float* vxp = vx.data();
+	float* vyp = vy.data();
+	float* vzp = vz.data();
+	float* agep = age.data();
+	for (size_t n = 0; n < cnt; ++n) {
+		float damp = ground[n] ? groundDamp : airDamp;
+		damp = 1.0f + (damp - 1.0f) * l[n]; //frozen entities keep their velocity
+		vxp[n] *= damp;
+		vzp[n] *= damp;
+		vyp[n] = std::max(vyp[n] - gravity * l[n], -TERMINAL_VELOCITY);
+		agep[n] += dt * l[n];
+	}
+}
+
+void EntityStore::collideBuckets(World& world, float dt, std::atomic<size_t>& nextBucket) {
+	for (size_t b = nextBucket++; b < buckets.size(); b = nextBucket++) {
+		const Bucket& bucket = buckets[b];
+		if (!bucket.chunk) continue;
+
+		// entities rarely reach past their own chunk, so the reader mostly hits its cache
+		SolidRows solidRows(world);
+
+		for (size_t n = bucket.begin; n < bucket.end; ++n) {
+			size_t s = order[n];
+			glm::vec3 begin(px[s], py[s], pz[s]);
+			glm::vec3 move = glm::vec3(vx[s], vy[s], vz[s]) * dt;
+			glm::vec3 contacts;
+			glm::vec3 end = Collision::SlideThroughVoxels(begin, begin + move, glm::vec3(sx[s], sy[s], sz[s]), solidRows, &contacts);
+
+			// a surface stops the velocity along its normal. one hit on the way down is the ground.
+			onGround[s] = contacts.y != 0.0f && move.y < 0.0f;
+			if (contacts.x != 0.0f) vx[s] = 0.0f;
+			if (contacts.y != 0.0f) vy[s] = 0.0f;
+			if (contacts.z != 0.0f) vz[s] = 0.0f;
+			px[s] = end.x, py[s] = end.y, pz[s] = end.z;
+		}
+	}
+}
+
+void EntityStore::findContacts() {
+	// a frozen entity didn't move, so its swept box is just its box
+	for (size_t n = 0; n < ids.size(); ++n) {
+		glm::vec3 begin(bx[n], by[n], bz[n]), end(px[n], py[n], pz[n]);
+		glm::vec3 mn = glm::min(begin, end);
+		broadphase.Update(ids[n], mn, glm::max(begin, end) - mn + Extent(n));
+	}
+	broadphase.CandidatePairs(pairs);
+
+	contacts.clear();
+	for (const SpatialHash::Pair& pair : pairs) {
+		size_t a = slotOf[pair.first], b = slotOf[pair.second];
+		Collision::Collision col = Collision::SweepPair({ bx[a], by[a], bz[a] }, Position(a), Extent(a), { bx[b], by[b], bz[b] }, Position(b), Extent(b));
+		if (col.time >= 0.0f) contacts.push_back({ pair.first, pair.second, col.time, col.normal });
+	}
+}
+
+void EntityStore::Step(World& world, float dt) {
+	PROFILE_ZONE("EntityStore::Step");
+	auto begin = std::chrono::steady_clock::now();
+	landed.clear();
+
+	{
+		PROFILE_ZONE("entities: bucket");
+		bucketByChunk(world);
+	}
+	{
+		PROFILE_ZONE("entities: integrate");
+		integrate(dt);
+		bx = px, by = py, bz = pz;
+	}
+	{
+		PROFILE_ZONE("entities: collide");
+		std::atomic<size_t> nextBucket{ 0 };
+		size_t jobs = ids.size() < PARALLEL_THRESHOLD ? 1 : std::min<size_t>(std::max(1u, threads), buckets.size());
+		WorkerPool::GetInstance().Run("entities: collide buckets", jobs, [&](size_t) { collideBuckets(world, dt, nextBucket); });
+	}
+	{
+		PROFILE_ZONE("entities: contacts");
+		findContacts();
+	}
+
+	lastStep = Stats{};
+	lastStep.entities = ids.size();
+	lastStep.chunks = buckets.size();
+	lastStep.pairs = pairs.size();
+	lastStep.contacts = contacts.size();
+	for (size_t n = ids.size(); n-- > 0;) {
+		if (live[n] == 0.0f) lastStep.frozen++;
+		else if (kind[n] == FALLING_BLOCK && onGround[n]) landed.push_back(ids[n]);
+		else if (kind[n] == ITEM && age[n] > ITEM_LIFETIME) removeSlot(n);
+	}
+	contacts.erase(std::remove_if(contacts.begin(), contacts.end(), [&](const Contact& c) { return !IsAlive(c.a) || !IsAlive(c.b); }), contacts.end());
+	lastStep.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
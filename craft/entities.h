@@ -0,0 +1,132 @@
+#pragma once
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "blocks.hpp"
+#include "broadphase.h"
+
+class World;
+class Chunk;
+
+/*
+the moving things of the world other than the player: dropped items, falling blocks, mobs.
+each property is its own array(structure of arrays), indexed by slot. slots are dense: despawning
+moves the last entity into the freed slot, so an Id, not a slot, is what stays valid.
+
+Step() advances every entity by dt:
+	1. entities are bucketed by the chunk they are in. entities of chunks that are not loaded stay frozen.
+	2. gravity, drag and ground friction are applied to the velocity arrays in plain loops the compiler vectorizes.
+	3. each entity's AABB is swept through the blocks of the world(Collision::SlideThroughVoxels).
+	   chunks are split among the threads of the WorkerPool, which only read the world and write their own entities' slots.
+	4. the boxes the entities swept over go into a SpatialHash, updated in place as they move. the pairs it
+	   reports are swept against each other(Collision::SweepPair), and the ones that met are the step's contacts.
+falling blocks that land are reported by Landed() for the caller to turn back into blocks, and entities
+that touched each other by Contacts().
+*/
+class EntityStore {
+public:
+	using Id = uint32_t;
+	static constexpr Id INVALID_ID = UINT32_MAX;
+
+	enum Kind : uint8_t {
+		ITEM, FALLING_BLOCK, MOB
+	};
+
+	// entity a ran into entity b at time(a proportion of the step), on b's surface with the normal
+	struct Contact {
+		Id a, b;
+		float time;
+		glm::vec3 normal;
+	};
+
+	struct Stats {
+		size_t entities = 0;
+		size_t frozen = 0; //in chunks that are not loaded
+		size_t chunks = 0; //buckets the step was split into
+		size_t pairs = 0; //candidate pairs from the broadphase
+		size_t contacts = 0;
+		double ms = 0.0;
+	};
+
+	static constexpr float GRAVITY = 24.0f; //blocks/s^2
+	static constexpr float TERMINAL_VELOCITY = 60.0f;
+	static constexpr float AIR_DRAG = 0.5f; //fraction of horizontal velocity kept after a second in the air
+	static constexpr float GROUND_FRICTION = 0.002f; //and on the ground
+	static constexpr float ITEM_LIFETIME = 300.0f; //seconds until a dropped item disappears
+	// below this many entities Step() runs on the calling thread only
+	static constexpr size_t PARALLEL_THRESHOLD = 1024;
+
+	// threads Step() uses at most, including the calling one. defaults to the WorkerPool's.
+	unsigned threads;
+
+	EntityStore();
+
+	// position is the minimum corner of the entity's AABB, size its extent.
+	Id Spawn(Kind kind, const glm::vec3& position, const glm::vec3& velocity, const glm::vec3& size,
+		BlockDB::BlockType block = BlockDB::BlockType::BLOCK_AIR);
+	void Despawn(Id id);
+	bool IsAlive(Id id) const { return id < slotOf.size() && slotOf[id] != INVALID_ID; }
+	size_t Size() const { return ids.size(); }
+	void Clear();
+
+	void Step(World& world, float dt);
+	// falling blocks that landed in the last step. they stay in the store until despawned.
+	const std::vector<Id>& Landed() const { return landed; }
+	// pairs of entities that ran into each other in the last step. they pass through each other, the caller decides what happens.
+	const std::vector<Contact>& Contacts() const { return contacts; }
+
+	const Stats& LastStepStats() const { return lastStep; }
+
+	size_t SlotOf(Id id) const { return slotOf[id]; }
+	glm::vec3 Position(size_t slot) const { return { px[slot], py[slot], pz[slot] }; }
+	glm::vec3 Velocity(size_t slot) const { return { vx[slot], vy[slot], vz[slot] }; }
+	glm::vec3 Extent(size_t slot) const { return { sx[slot], sy[slot], sz[slot] }; }
+
+	// per slot
+	std::vector<Id> ids;
+	std::vector<Kind> kind;
+	std::vector<BlockDB::BlockType> block; //the block an item or falling block carries
+	std::vector<float> px, py, pz;
+	std::vector<float> vx, vy, vz;
+	std::vector<float> sx, sy, sz;
+	std::vector<float> age; //seconds since spawned
+	std::vector<uint8_t> onGround;
+
+private:
+	// entities of one chunk, order[begin, end)
+	struct Bucket {
+		glm::ivec3 chunkIdx;
+		Chunk* chunk; //nullptr if not loaded
+		size_t begin, end;
+	};
+
+	void removeSlot(size_t slot);
+	void bucketByChunk(World& world);
+	void integrate(float dt);
+	void collideBuckets(World& world, float dt, std::atomic<size_t>& nextBucket);
+	void findContacts();
+
+	std::vector<Id> slotOf; //id -> slot, INVALID_ID if despawned
+	std::vector<Id> freeIds;
+
+	// step scratch, reused every step
+	std::vector<uint64_t> sortKeys; //chunk key << 32 | slot
+	std::vector<glm::ivec3> chunkOf; //per slot
+	std::vector<uint32_t> order; //slots grouped by chunk
+	std::vector<Bucket> buckets;
+	std::vector<float> live; //1 for entities in loaded chunks, 0 for frozen ones
+	std::vector<Id> landed;
+	std::vector<float> bx, by, bz; //positions at the beginning of the step
+	std::vector<SpatialHash::Pair> pairs;
+	std::vector<Contact> contacts;
+
+	SpatialHash broadphase; //by id
+
+	Stats lastStep;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+/*
+the six clipping planes of a view-projection matrix, in world space.
+planes point inwards, so a point p is inside a plane if dot(plane.xyz, p) + plane.w >= 0
+*/
+class Frustum {
+public:
+	glm::vec4 planes[6];
+
+	Frustum() = default;
+	explicit Frustum(const glm::mat4& viewProj) {
+		// glm is column major, row r of the matrix is (m[0][r], m[1][r], m[2][r], m[3][r])
+		glm::vec4 row[4];
+		for (int r = 0; r < 4; ++r) row[r] = glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]);
+		planes[0] = row[3] + row[0]; //left
+		planes[1] = row[3] - row[0]; //right
+		planes[2] = row[3] + row[1]; //bottom
+		planes[3] = row[3] - row[1]; //top
+		planes[4] = row[3] + row[2]; //near
+		planes[5] = row[3] - row[2]; //far
+	}
+
+	// conservative test, may return true for boxes just outside a corner of the frustum.
+	bool TestAABB(const glm::vec3& mn, const glm::vec3& mx) const {
+		for (const glm::vec4& p : planes) {
+			// the box corner farthest along the plane normal
+			glm::vec3 v{ p.x >= 0 ? mx.x : mn.x, p.y >= 0 ? mx.y : mn.y, p.z >= 0 ? mx.z : mn.z };
+			if (p.x * v.x + p.y * v.y + p.z * v.z + p.w < 0) return false;
+		}
+		return true;
+	}
+};
+
+#endif
@@ -151,7 +151,7 @@ namespace MapGen {
 	template<typename MapDataTy, unsigned int SZ>
 	Map<MapDataTy, SZ>::Map(const vec2i& pos, const int sc) : basepos(pos), scale(sc), pad(2) {
 		data = new MapDataTy * [SZ + 2 * pad];
-		for (int i = 0; i <= size(); ++i) {
+		for (int i = 0; i < size(); ++i) {
 			data[i] = new MapDataTy[SZ + 2 * pad];
 		}
 	}
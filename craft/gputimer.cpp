@@ -0,0 +1,87 @@
+#include "gputimer.h"
+#include <algorithm>
+#include <cstring>
+
+static void sortSlowestFirst(std::vector<Profiler::ZoneSummary>& summary) {
+	std::sort(summary.begin(), summary.end(), [](const Profiler::ZoneSummary& a, const Profiler::ZoneSummary& b) { return a.ms > b.ms; });
+}
+
+std::vector<Profiler::ZoneSummary> GpuTimer::AverageSummary() const {
+	std::vector<Profiler::ZoneSummary> summary;
+	if (frameCnt == 0) return summary;
+	for (auto& [name, z] : accumulated) summary.push_back({ z.name, z.ms / frameCnt, (uint32_t)(z.calls / frameCnt) });
+	sortSlowestFirst(summary);
+	return summary;
+}
+
+void GpuTimer::addFrame(std::vector<Profiler::ZoneSummary>&& summary) {
+	sortSlowestFirst(summary);
+	lastFrame = std::move(summary);
+	for (const Profiler::ZoneSummary& z : lastFrame) {
+		Profiler::ZoneSummary& acc = accumulated.try_emplace(z.name, Profiler::ZoneSummary{ z.name, 0.0, 0 }).first->second;
+		acc.ms += z.ms;
+		acc.calls += z.calls;
+	}
+	frameCnt++;
+}
+
+GLGpuTimer::~GLGpuTimer() {
+	for (Frame& frame : frames) {
+		if (!frame.queries.empty()) glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+	}
+}
+
+void GLGpuTimer::BeginFrame() {
+	current = (current + 1) % FRAMES_IN_FLIGHT;
+	Frame& frame = frames[current];
+	if (frame.pending) collect(frame);
+	frame.used = 0;
+}
+
+void GLGpuTimer::collect(Frame& frame) {
+	frame.pending = false;
+	// queries finish in order, so the last one being available means they all are
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		dropped++;
+		return;
+	}
+
+	std::vector<Profiler::ZoneSummary> summary;
+	for (size_t n = 0; n < frame.used; ++n) {
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(frame.queries[n], GL_QUERY_RESULT, &ns);
+		const char* pass = frame.passes[n];
+		auto it = std::find_if(summary.begin(), summary.end(), [pass](const Profiler::ZoneSummary& z) { return std::strcmp(z.name, pass) == 0; });
+		if (it == summary.end()) it = summary.insert(summary.end(), { pass, 0.0, 0 });
+		it->ms += ns * 1e-6;
+		it->calls++;
+	}
+	addFrame(std::move(summary));
+}
+
+void GLGpuTimer::Begin(const char* pass) {
+	if (running) End();
+	Frame& frame = frames[current];
+	if (frame.used == frame.queries.size()) {
+		GLuint query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+		frame.passes.push_back(nullptr);
+	}
+	frame.passes[frame.used] = pass;
+	glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.used++]);
+	running = true;
+}
+
+void GLGpuTimer::End() {
+	if (!running) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	running = false;
+}
+
+void GLGpuTimer::EndFrame() {
+	End();
+	frames[current].pending = frames[current].used > 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <glad/glad.h>
+#include "profiler.h"
+
+/*
+gpu time of the render passes of a frame. passes are timed one after another, never nested.
+results come back some frames late, so the summaries describe an earlier frame than the cpu zones' summaries.
+*/
+class GpuTimer {
+public:
+	virtual ~GpuTimer() = default;
+
+	virtual void BeginFrame() = 0;
+	// starting a pass ends the one still running.
+	virtual void Begin(const char* pass) = 0;
+	virtual void End() = 0;
+	virtual void EndFrame() = 0;
+
+	// passes of the latest frame whose results arrived, slowest first.
+	const std::vector<Profiler::ZoneSummary>& LastFrameSummary() const { return lastFrame; }
+	// average gpu time per frame of every pass, over the frames whose results arrived.
+	std::vector<Profiler::ZoneSummary> AverageSummary() const;
+	size_t FrameCount() const { return frameCnt; }
+	// frames whose results were still pending when their queries were needed again
+	size_t DroppedFrames() const { return dropped; }
+
+protected:
+	void addFrame(std::vector<Profiler::ZoneSummary>&& summary);
+
+	std::vector<Profiler::ZoneSummary> lastFrame;
+	std::map<std::string, Profiler::ZoneSummary> accumulated;
+	size_t frameCnt = 0, dropped = 0;
+};
+
+// measures nothing. for contexts without timer queries, and for running without a gl context.
+class NullGpuTimer : public GpuTimer {
+public:
+	void BeginFrame() override {}
+	void Begin(const char*) override {}
+	void End() override {}
+	void EndFrame() override {}
+};
+
+/*
+GL_TIME_ELAPSED queries, double buffered: a frame's queries are read when their buffer comes around again,
+two frames later. results that are still not available then are dropped instead of waited for,
+so reading never stalls the pipeline.
+*/
+class GLGpuTimer : public GpuTimer {
+public:
+	static constexpr int FRAMES_IN_FLIGHT = 2;
+
+	GLGpuTimer() = default;
+	~GLGpuTimer();
+	GLGpuTimer(const GLGpuTimer&) = delete;
+	GLGpuTimer& operator=(const GLGpuTimer&) = delete;
+
+	void BeginFrame() override;
+	void Begin(const char* pass) override;
+	void End() override;
+	void EndFrame() override;
+
+private:
+	struct Frame {
+		std::vector<GLuint> queries; //grows to the most passes a frame has had
+		std::vector<const char*> passes;
+		size_t used = 0;
+		bool pending = false;
+	};
+
+	void collect(Frame& frame);
+
+	Frame frames[FRAMES_IN_FLIGHT];
+	int current = 0;
+	bool running = false;
+};
+
+#endif
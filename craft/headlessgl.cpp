@@ -0,0 +1,559 @@
+#include "headlessgl.h"
+#include <iostream>
+#include <cstring>
+
+static HeadlessGL& gl() {
+	return HeadlessGL::GetInstance();
+}
+
+// counts the call, and names it for error messages
+#define RECORD(name) \
+	[[maybe_unused]] const char* call = name; \
+	HeadlessGL& rec = gl(); \
+	rec.current.calls++
+
+//-------- recorder
+
+void HeadlessGL::error(const char* call, const char* what) {
+	current.errors++;
+	std::cout << "ERROR::HEADLESS_GL::" << call << ": " << what << std::endl;
+}
+
+GLuint HeadlessGL::genName() {
+	return nextName++;
+}
+
+GLuint& HeadlessGL::bindingOf(GLenum target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER: return arrayBuffer;
+	case GL_ELEMENT_ARRAY_BUFFER: return vertexArrays[currentVertexArray].elementBuffer;
+	case GL_COPY_READ_BUFFER: return copyReadBuffer;
+	case GL_COPY_WRITE_BUFFER: return copyWriteBuffer;
+	default: return otherBuffer;
+	}
+}
+
+HeadlessGL::Buffer* HeadlessGL::boundBuffer(GLenum target, const char* call) {
+	GLuint name = bindingOf(target);
+	if (name == 0) {
+		error(call, "no buffer bound to the target");
+		return nullptr;
+	}
+	return &buffers[name];
+}
+
+bool HeadlessGL::validateDraw(const char* call, bool indexed) {
+	current.drawCalls++;
+	bool ok = true;
+	if (currentProgram == 0) {
+		error(call, "no program in use");
+		ok = false;
+	}
+	if (currentVertexArray == 0) {
+		error(call, "no vertex array bound, which a core context requires");
+		ok = false;
+	}
+	else if (indexed && vertexArrays[currentVertexArray].elementBuffer == 0) {
+		error(call, "no element buffer bound to the vertex array");
+		ok = false;
+	}
+	return ok;
+}
+
+size_t HeadlessGL::BufferMemory() const {
+	size_t bytes = 0;
+	for (auto& [name, buffer] : buffers) bytes += buffer.size;
+	return bytes;
+}
+
+void HeadlessGL::EndFrame() {
+	current.frames = 1;
+	lastFrame = current;
+	total.frames++;
+	total.calls += current.calls;
+	total.drawCalls += current.drawCalls;
+	total.drawCommands += current.drawCommands;
+	total.bufferUploads += current.bufferUploads;
+	total.uploadBytes += current.uploadBytes;
+	total.copyBytes += current.copyBytes;
+	total.textureBytes += current.textureBytes;
+	total.stateChanges += current.stateChanges;
+	total.errors += current.errors;
+	current = Stats();
+}
+
+//-------- entry points
+
+// buffers
+
+static void APIENTRY genBuffers(GLsizei n, GLuint* names) {
+	RECORD("glGenBuffers");
+	for (GLsizei i = 0; i < n; ++i) {
+		names[i] = rec.genName();
+		rec.buffers[names[i]];
+	}
+}
+
+static void APIENTRY deleteBuffers(GLsizei n, const GLuint* names) {
+	RECORD("glDeleteBuffers");
+	for (GLsizei i = 0; i < n; ++i) {
+		if (names[i] == 0) continue;
+		if (!rec.buffers.erase(names[i])) rec.error(call, "not a buffer name");
+		// deleting a bound buffer unbinds it
+		for (GLuint* binding : { &rec.arrayBuffer, &rec.copyReadBuffer, &rec.copyWriteBuffer, &rec.otherBuffer }) {
+			if (*binding == names[i]) *binding = 0;
+		}
+		for (auto& [vao, state] : rec.vertexArrays) {
+			if (state.elementBuffer == names[i]) state.elementBuffer = 0;
+		}
+	}
+}
+
+static void APIENTRY bindBuffer(GLenum target, GLuint name) {
+	RECORD("glBindBuffer");
+	if (name != 0 && !rec.buffers.count(name)) {
+		rec.error(call, "not a buffer name");
+		return;
+	}
+	rec.bindingOf(target) = name;
+}
+
+static void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+	RECORD("glBufferData");
+	HeadlessGL::Buffer* buffer = rec.boundBuffer(target, call);
+	if (!buffer) return;
+	if (size < 0) {
+		rec.error(call, "negative size");
+		return;
+	}
+	buffer->size = (size_t)size;
+	rec.current.bufferUploads++;
+	if (data) rec.current.uploadBytes += (size_t)size;
+}
+
+static void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+	RECORD("glBufferSubData");
+	HeadlessGL::Buffer* buffer = rec.boundBuffer(target, call);
+	if (!buffer) return;
+	if (offset < 0 || size < 0 || (size_t)(offset + size) > buffer->size) {
+		rec.error(call, "range outside the buffer");
+		return;
+	}
+	rec.current.bufferUploads++;
+	rec.current.uploadBytes += (size_t)size;
+}
+
+static void APIENTRY copyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) {
+	RECORD("glCopyBufferSubData");
+	HeadlessGL::Buffer* src = rec.boundBuffer(readTarget, call);
+	HeadlessGL::Buffer* dst = rec.boundBuffer(writeTarget, call);
+	if (!src || !dst) return;
+	if (readOffset < 0 || writeOffset < 0 || size < 0 || (size_t)(readOffset + size) > src->size || (size_t)(writeOffset + size) > dst->size) {
+		rec.error(call, "range outside a buffer");
+		return;
+	}
+	rec.current.copyBytes += (size_t)size;
+}
+
+// vertex arrays
+
+static void APIENTRY genVertexArrays(GLsizei n, GLuint* names) {
+	RECORD("glGenVertexArrays");
+	for (GLsizei i = 0; i < n; ++i) {
+		names[i] = rec.genName();
+		rec.vertexArrays[names[i]];
+	}
+}
+
+static void APIENTRY deleteVertexArrays(GLsizei n, const GLuint* names) {
+	RECORD("glDeleteVertexArrays");
+	for (GLsizei i = 0; i < n; ++i) {
+		if (names[i] == 0) continue;
+		if (!rec.vertexArrays.erase(names[i])) rec.error(call, "not a vertex array name");
+		if (rec.currentVertexArray == names[i]) rec.currentVertexArray = 0;
+	}
+}
+
+static void APIENTRY bindVertexArray(GLuint name) {
+	RECORD("glBindVertexArray");
+	if (name != 0 && !rec.vertexArrays.count(name)) {
+		rec.error(call, "not a vertex array name");
+		return;
+	}
+	rec.currentVertexArray = name;
+	rec.current.stateChanges++;
+}
+
+static void APIENTRY vertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+	RECORD("glVertexAttribPointer");
+	if (rec.currentVertexArray == 0) rec.error(call, "no vertex array bound");
+	if (rec.arrayBuffer == 0) rec.error(call, "no buffer bound to GL_ARRAY_BUFFER");
+}
+
+static void APIENTRY enableVertexAttribArray(GLuint index) {
+	RECORD("glEnableVertexAttribArray");
+	if (rec.currentVertexArray == 0) rec.error(call, "no vertex array bound");
+}
+
+static void APIENTRY vertexAttribDivisor(GLuint index, GLuint divisor) {
+	RECORD("glVertexAttribDivisor");
+	if (rec.currentVertexArray == 0) rec.error(call, "no vertex array bound");
+}
+
+// draws
+
+static void APIENTRY drawArrays(GLenum mode, GLint first, GLsizei count) {
+	RECORD("glDrawArrays");
+	if (rec.validateDraw(call, false)) rec.current.drawCommands++;
+}
+
+static void APIENTRY drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+	RECORD("glDrawArraysInstanced");
+	if (rec.validateDraw(call, false)) rec.current.drawCommands++;
+}
+
+static void APIENTRY drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+	RECORD("glDrawElements");
+	if (rec.validateDraw(call, true)) rec.current.drawCommands++;
+}
+
+static void APIENTRY multiDrawElementsBaseVertex(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei drawcount, const GLint* basevertex) {
+	RECORD("glMultiDrawElementsBaseVertex");
+	if (!rec.validateDraw(call, true)) return;
+	rec.current.drawCommands += drawcount;
+
+	// every command must stay inside the element buffer
+	const HeadlessGL::Buffer& elements = rec.buffers[rec.vertexArrays[rec.currentVertexArray].elementBuffer];
+	for (GLsizei i = 0; i < drawcount; ++i) {
+		if ((size_t)indices[i] + count[i] * sizeof(GLuint) > elements.size) {
+			rec.error(call, "command reads past the element buffer");
+			return;
+		}
+	}
+}
+
+// shaders and programs
+
+static GLuint APIENTRY createShader(GLenum type) {
+	RECORD("glCreateShader");
+	GLuint name = rec.genName();
+	rec.shaders[name] = type;
+	return name;
+}
+
+static void APIENTRY deleteShader(GLuint name) {
+	RECORD("glDeleteShader");
+	if (name != 0 && !rec.shaders.erase(name)) rec.error(call, "not a shader name");
+}
+
+static void APIENTRY shaderSource(GLuint name, GLsizei count, const GLchar* const* string, const GLint* length) {
+	RECORD("glShaderSource");
+	if (!rec.shaders.count(name)) rec.error(call, "not a shader name");
+}
+
+static void APIENTRY compileShader(GLuint name) {
+	RECORD("glCompileShader");
+	if (!rec.shaders.count(name)) rec.error(call, "not a shader name");
+}
+
+static void APIENTRY getShaderiv(GLuint name, GLenum pname, GLint* params) {
+	RECORD("glGetShaderiv");
+	// every shader compiles, without a log
+	*params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+static void APIENTRY getShaderInfoLog(GLuint name, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	RECORD("glGetShaderInfoLog");
+	if (length) *length = 0;
+	if (bufSize > 0) infoLog[0] = '\0';
+}
+
+static GLuint APIENTRY createProgram() {
+	RECORD("glCreateProgram");
+	GLuint name = rec.genName();
+	rec.programs[name] = false;
+	return name;
+}
+
+static void APIENTRY attachShader(GLuint program, GLuint shader) {
+	RECORD("glAttachShader");
+	if (!rec.programs.count(program)) rec.error(call, "not a program name");
+	if (!rec.shaders.count(shader)) rec.error(call, "not a shader name");
+}
+
+static void APIENTRY linkProgram(GLuint program) {
+	RECORD("glLinkProgram");
+	auto it = rec.programs.find(program);
+	if (it == rec.programs.end()) rec.error(call, "not a program name");
+	else it->second = true;
+}
+
+static void APIENTRY getProgramiv(GLuint program, GLenum pname, GLint* params) {
+	RECORD("glGetProgramiv");
+	*params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+static void APIENTRY getProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	RECORD("glGetProgramInfoLog");
+	if (length) *length = 0;
+	if (bufSize > 0) infoLog[0] = '\0';
+}
+
+static void APIENTRY useProgram(GLuint program) {
+	RECORD("glUseProgram");
+	if (program != 0) {
+		auto it = rec.programs.find(program);
+		if (it == rec.programs.end()) {
+			rec.error(call, "not a program name");
+			return;
+		}
+		if (!it->second) rec.error(call, "program is not linked");
+	}
+	rec.currentProgram = program;
+	rec.current.stateChanges++;
+}
+
+static GLint APIENTRY getUniformLocation(GLuint program, const GLchar* name) {
+	RECORD("glGetUniformLocation");
+	auto it = rec.programs.find(program);
+	if (it == rec.programs.end() || !it->second) {
+		rec.error(call, "not a linked program");
+		return -1;
+	}
+	return 0;
+}
+
+static void checkUniformTarget(HeadlessGL& rec, const char* call) {
+	if (rec.currentProgram == 0) rec.error(call, "no program in use");
+}
+
+static void APIENTRY uniform1i(GLint location, GLint v0) {
+	RECORD("glUniform1i");
+	checkUniformTarget(rec, call);
+}
+
+static void APIENTRY uniform1f(GLint location, GLfloat v0) {
+	RECORD("glUniform1f");
+	checkUniformTarget(rec, call);
+}
+
+static void APIENTRY uniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+	RECORD("glUniform2fv");
+	checkUniformTarget(rec, call);
+}
+
+static void APIENTRY uniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+	RECORD("glUniform3fv");
+	checkUniformTarget(rec, call);
+}
+
+static void APIENTRY uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+	RECORD("glUniformMatrix4fv");
+	checkUniformTarget(rec, call);
+}
+
+// textures
+
+static void APIENTRY genTextures(GLsizei n, GLuint* names) {
+	RECORD("glGenTextures");
+	for (GLsizei i = 0; i < n; ++i) {
+		names[i] = rec.genName();
+		rec.textures[names[i]] = true;
+	}
+}
+
+static void APIENTRY deleteTextures(GLsizei n, const GLuint* names) {
+	RECORD("glDeleteTextures");
+	for (GLsizei i = 0; i < n; ++i) {
+		if (names[i] != 0 && !rec.textures.erase(names[i])) rec.error(call, "not a texture name");
+	}
+}
+
+static void APIENTRY bindTexture(GLenum target, GLuint name) {
+	RECORD("glBindTexture");
+	if (name != 0 && !rec.textures.count(name)) rec.error(call, "not a texture name");
+	rec.current.stateChanges++;
+}
+
+static void APIENTRY activeTexture(GLenum unit) {
+	RECORD("glActiveTexture");
+}
+
+static void APIENTRY texParameteri(GLenum target, GLenum pname, GLint param) {
+	RECORD("glTexParameteri");
+}
+
+static size_t texelBytes(GLenum format) {
+	switch (format) {
+	case GL_RGBA: return 4;
+	case GL_RGB: return 3;
+	case GL_RG: return 2;
+	default: return 1;
+	}
+}
+
+static void APIENTRY texImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+	RECORD("glTexImage2D");
+	if (pixels) rec.current.textureBytes += (size_t)width * height * texelBytes(format);
+}
+
+static void APIENTRY texImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels) {
+	RECORD("glTexImage3D");
+	if (pixels) rec.current.textureBytes += (size_t)width * height * depth * texelBytes(format);
+}
+
+static void APIENTRY texSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+	RECORD("glTexSubImage3D");
+	if (pixels) rec.current.textureBytes += (size_t)width * height * depth * texelBytes(format);
+}
+
+static void APIENTRY generateMipmap(GLenum target) {
+	RECORD("glGenerateMipmap");
+}
+
+// queries
+
+static void APIENTRY genQueries(GLsizei n, GLuint* names) {
+	RECORD("glGenQueries");
+	for (GLsizei i = 0; i < n; ++i) {
+		names[i] = rec.genName();
+		rec.queries[names[i]] = true;
+	}
+}
+
+static void APIENTRY deleteQueries(GLsizei n, const GLuint* names) {
+	RECORD("glDeleteQueries");
+	for (GLsizei i = 0; i < n; ++i) {
+		if (names[i] != 0 && !rec.queries.erase(names[i])) rec.error(call, "not a query name");
+	}
+}
+
+static void APIENTRY beginQuery(GLenum target, GLuint name) {
+	RECORD("glBeginQuery");
+	if (!rec.queries.count(name)) rec.error(call, "not a query name");
+	if (rec.activeQuery != 0) rec.error(call, "a query of the target is already active");
+	rec.activeQuery = name;
+}
+
+static void APIENTRY endQuery(GLenum target) {
+	RECORD("glEndQuery");
+	if (rec.activeQuery == 0) rec.error(call, "no active query");
+	rec.activeQuery = 0;
+}
+
+static void APIENTRY getQueryObjectiv(GLuint name, GLenum pname, GLint* params) {
+	RECORD("glGetQueryObjectiv");
+	// results are ready at once, and every pass takes no time
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void APIENTRY getQueryObjectui64v(GLuint name, GLenum pname, GLuint64* params) {
+	RECORD("glGetQueryObjectui64v");
+	*params = 0;
+}
+
+// fixed function state
+
+static void APIENTRY viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	RECORD("glViewport");
+}
+
+static void APIENTRY enable(GLenum cap) {
+	RECORD("glEnable");
+}
+
+static void APIENTRY disable(GLenum cap) {
+	RECORD("glDisable");
+}
+
+static void APIENTRY blendFunc(GLenum sfactor, GLenum dfactor) {
+	RECORD("glBlendFunc");
+}
+
+static void APIENTRY depthMask(GLboolean flag) {
+	RECORD("glDepthMask");
+}
+
+static void APIENTRY polygonMode(GLenum face, GLenum mode) {
+	RECORD("glPolygonMode");
+}
+
+static void APIENTRY clearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	RECORD("glClearColor");
+}
+
+static void APIENTRY clear(GLbitfield mask) {
+	RECORD("glClear");
+}
+
+void HeadlessGL::Install() {
+	// names are never 0, which GL keeps for "none"
+	vertexArrays[0];
+	GLAD_GL_VERSION_1_0 = GLAD_GL_VERSION_1_1 = GLAD_GL_VERSION_1_2 = GLAD_GL_VERSION_1_3 = GLAD_GL_VERSION_1_4 = GLAD_GL_VERSION_1_5 = 1;
+	GLAD_GL_VERSION_2_0 = GLAD_GL_VERSION_2_1 = 1;
+	GLAD_GL_VERSION_3_0 = GLAD_GL_VERSION_3_1 = GLAD_GL_VERSION_3_2 = GLAD_GL_VERSION_3_3 = 1;
+
+	glad_glGenBuffers = genBuffers;
+	glad_glDeleteBuffers = deleteBuffers;
+	glad_glBindBuffer = bindBuffer;
+	glad_glBufferData = bufferData;
+	glad_glBufferSubData = bufferSubData;
+	glad_glCopyBufferSubData = copyBufferSubData;
+
+	glad_glGenVertexArrays = genVertexArrays;
+	glad_glDeleteVertexArrays = deleteVertexArrays;
+	glad_glBindVertexArray = bindVertexArray;
+	glad_glVertexAttribPointer = vertexAttribPointer;
+	glad_glEnableVertexAttribArray = enableVertexAttribArray;
+	glad_glVertexAttribDivisor = vertexAttribDivisor;
+
+	glad_glDrawArrays = drawArrays;
+	glad_glDrawArraysInstanced = drawArraysInstanced;
+	glad_glDrawElements = drawElements;
+	glad_glMultiDrawElementsBaseVertex = multiDrawElementsBaseVertex;
+
+	glad_glCreateShader = createShader;
+	glad_glDeleteShader = deleteShader;
+	glad_glShaderSource = shaderSource;
+	glad_glCompileShader = compileShader;
+	glad_glGetShaderiv = getShaderiv;
+	glad_glGetShaderInfoLog = getShaderInfoLog;
+	glad_glCreateProgram = createProgram;
+	glad_glAttachShader = attachShader;
+	glad_glLinkProgram = linkProgram;
+	glad_glGetProgramiv = getProgramiv;
+	glad_glGetProgramInfoLog = getProgramInfoLog;
+	glad_glUseProgram = useProgram;
+	glad_glGetUniformLocation = getUniformLocation;
+	glad_glUniform1i = uniform1i;
+	glad_glUniform1f = uniform1f;
+	glad_glUniform2fv = uniform2fv;
+	glad_glUniform3fv = uniform3fv;
+	glad_glUniformMatrix4fv = uniformMatrix4fv;
+
+	glad_glGenTextures = genTextures;
+	glad_glDeleteTextures = deleteTextures;
+	glad_glBindTexture = bindTexture;
+	glad_glActiveTexture = activeTexture;
+	glad_glTexParameteri = texParameteri;
+	glad_glTexImage2D = texImage2D;
+	glad_glTexImage3D = texImage3D;
+	glad_glTexSubImage3D = texSubImage3D;
+	glad_glGenerateMipmap = generateMipmap;
+
+	glad_glGenQueries = genQueries;
+	glad_glDeleteQueries = deleteQueries;
+	glad_glBeginQuery = beginQuery;
+	glad_glEndQuery = endQuery;
+	glad_glGetQueryObjectiv = getQueryObjectiv;
+	glad_glGetQueryObjectui64v = getQueryObjectui64v;
+
+	glad_glViewport = viewport;
+	glad_glEnable = enable;
+	glad_glDisable = disable;
+	glad_glBlendFunc = blendFunc;
+	glad_glDepthMask = depthMask;
+	glad_glPolygonMode = polygonMode;
+	glad_glClearColor = clearColor;
+	glad_glClear = clear;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#ifndef HEADLESSGL_H
+#define HEADLESSGL_H
+
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <glad/glad.h>
+
+/*
+a stand in for the GL driver, for running the renderer without a GPU or a window.
+every GL call of the game goes through glad's function pointers, and Install() points the ones the game uses
+at this recorder instead of a driver. it draws nothing. it counts calls, draws and uploaded bytes,
+and tracks just enough state(names, bindings, buffer sizes, the current program, VAO and query)
+to report calls a driver would reject, as ERROR::HEADLESS_GL messages.
+*/
+class HeadlessGL {
+public:
+	struct Stats {
+		size_t frames = 0;
+		size_t calls = 0;
+		size_t drawCalls = 0; //glDraw* and glMultiDraw* calls
+		size_t drawCommands = 0; //draws inside those calls, a multi draw counts each of its commands
+		size_t bufferUploads = 0; //glBufferData and glBufferSubData calls
+		size_t uploadBytes = 0; //bytes passed to them
+		size_t copyBytes = 0; //bytes copied between buffers on the "GPU"
+		size_t textureBytes = 0;
+		size_t stateChanges = 0; //program, VAO and texture binds
+		size_t errors = 0;
+	};
+
+	static HeadlessGL& GetInstance() {
+		static HeadlessGL instance;
+		return instance;
+	}
+
+	// replaces glad's function pointers and reports a 3.3 core context. call instead of gladLoadGL().
+	void Install();
+
+	// frame statistics. call once per frame after the last draw.
+	void EndFrame();
+	const Stats& LastFrameStats() const { return lastFrame; }
+	const Stats& TotalStats() const { return total; }
+
+	// bytes held by live buffer objects
+	size_t BufferMemory() const;
+
+	// the recorder's side of each call, public for the installed entry points
+	struct Buffer {
+		size_t size = 0;
+	};
+	struct VertexArray {
+		GLuint elementBuffer = 0;
+	};
+
+	void error(const char* call, const char* what);
+	GLuint genName();
+	Buffer* boundBuffer(GLenum target, const char* call);
+	GLuint& bindingOf(GLenum target);
+	bool validateDraw(const char* call, bool indexed);
+
+	std::unordered_map<GLuint, Buffer> buffers;
+	std::unordered_map<GLuint, VertexArray> vertexArrays;
+	std::unordered_map<GLuint, GLenum> shaders; //name -> shader type
+	std::unordered_map<GLuint, bool> programs; //name -> linked
+	std::unordered_map<GLuint, bool> textures;
+	std::unordered_map<GLuint, bool> queries;
+
+	GLuint arrayBuffer = 0, copyReadBuffer = 0, copyWriteBuffer = 0, otherBuffer = 0;
+	GLuint currentVertexArray = 0;
+	GLuint currentProgram = 0;
+	GLuint activeQuery = 0;
+
+	Stats current;
+
+private:
+	HeadlessGL() = default;
+	HeadlessGL(HeadlessGL const& other) = delete;
+	HeadlessGL& operator=(HeadlessGL const& other) = delete;
+
+	GLuint nextName = 1;
+	Stats lastFrame, total;
+};
+
+#endif
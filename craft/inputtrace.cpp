@@ -0,0 +1,140 @@
+#include "inputtrace.h"
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <GLFW/glfw3.h>
+
+static constexpr char TRACE_MAGIC[4] = { 'G', 'L', 'I', 'T' };
+static constexpr uint32_t TRACE_VERSION = 1;
+
+float InputTrace::Duration() const {
+	float t = 0.0f;
+	for (const Frame& f : frames) t += f.dt;
+	return t;
+}
+
+void InputTrace::BeginFrame(float dt) {
+	frames.push_back({ dt, {}, {} });
+}
+
+void InputTrace::RecordKey(int key) {
+	std::vector<int16_t>& keys = frames.back().keysDown;
+	auto it = std::lower_bound(keys.begin(), keys.end(), (int16_t)key);
+	if (it == keys.end() || *it != key) keys.insert(it, (int16_t)key);
+}
+
+void InputTrace::RecordEvent(const Event& e) {
+	frames.back().events.push_back(e);
+}
+
+bool InputTrace::IsKeyDown(size_t frame, int key) const {
+	const std::vector<int16_t>& keys = frames[frame].keysDown;
+	return std::binary_search(keys.begin(), keys.end(), (int16_t)key);
+}
+
+// file layout:
+// magic | u32 version | pose(3 f32 position, f32 yaw, f32 pitch) | u32 frame count |
+// per frame: f32 dt | u16 key count | keys(i16) | u16 event count | events(u8 type, 3 i32, 2 f64)
+bool InputTrace::Write(const std::string& path) const {
+	std::ofstream ofs(path, std::ios::binary);
+	if (!ofs) {
+		std::cout << "ERROR::INPUT_TRACE::COULD_NOT_OPEN_FILE: " << path << std::endl;
+		return false;
+	}
+	auto put = [&ofs](const auto& v) { ofs.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+
+	ofs.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	put(TRACE_VERSION);
+	put(start.position.x), put(start.position.y), put(start.position.z);
+	put(start.yaw), put(start.pitch);
+	put((uint32_t)frames.size());
+	for (const Frame& f : frames) {
+		put(f.dt);
+		put((uint16_t)f.keysDown.size());
+		for (int16_t key : f.keysDown) put(key);
+		put((uint16_t)f.events.size());
+		for (const Event& e : f.events) {
+			put((uint8_t)e.type);
+			put(e.button), put(e.action), put(e.mods);
+			put(e.x), put(e.y);
+		}
+	}
+	std::cout << "wrote input trace of " << frames.size() << " frames(" << Duration() << " s) to " << path << std::endl;
+	return ofs.good();
+}
+
+bool InputTrace::Read(const std::string& path) {
+	frames.clear();
+	std::ifstream ifs(path, std::ios::binary);
+	if (!ifs) {
+		std::cout << "ERROR::INPUT_TRACE::COULD_NOT_OPEN_FILE: " << path << std::endl;
+		return false;
+	}
+	auto get = [&ifs](auto& v) { return (bool)ifs.read(reinterpret_cast<char*>(&v), sizeof(v)); };
+
+	char magic[4];
+	uint32_t version = 0, cnt = 0;
+	ifs.read(magic, sizeof(magic));
+	get(version);
+	get(start.position.x), get(start.position.y), get(start.position.z);
+	get(start.yaw), get(start.pitch);
+	get(cnt);
+	if (!ifs || !std::equal(magic, magic + 4, TRACE_MAGIC) || version != TRACE_VERSION) {
+		std::cout << "ERROR::INPUT_TRACE::INVALID_FILE: " << path << std::endl;
+		return false;
+	}
+
+	// the count isn't trusted to size anything: frames are read one at a time, up to the first that is cut short
+	std::vector<Frame> loaded;
+	for (uint32_t n = 0; n < cnt; ++n) {
+		Frame& f = loaded.emplace_back();
+		uint16_t keyCnt = 0, eventCnt = 0;
+		bool ok = get(f.dt) && get(keyCnt);
+		f.keysDown.resize(keyCnt);
+		for (int16_t& key : f.keysDown) ok = ok && get(key);
+		ok = ok && get(eventCnt);
+		f.events.resize(eventCnt);
+		for (Event& e : f.events) {
+			uint8_t type = 0;
+			ok = ok && get(type) && get(e.button) && get(e.action) && get(e.mods) && get(e.x) && get(e.y);
+			e.type = (Event::Type)type;
+			ok = ok && type <= Event::SCROLL;
+		}
+		if (!ok || !std::isfinite(f.dt) || f.dt < 0.0f || !std::is_sorted(f.keysDown.begin(), f.keysDown.end())) {
+			std::cout << "ERROR::INPUT_TRACE::CORRUPTED_FILE: " << path << std::endl;
+			return false;
+		}
+	}
+	frames = std::move(loaded);
+	return true;
+}
+
+InputTrace InputTrace::Flight(const Pose& start, float distance, float speed, float dt) {
+	InputTrace trace;
+	trace.start = start;
+	size_t cnt = (size_t)std::ceil(distance / (speed * dt));
+	for (size_t n = 0; n < cnt; ++n) {
+		trace.BeginFrame(dt);
+		trace.RecordKey(GLFW_KEY_W);
+	}
+	return trace;
+}
+
+InputTrace InputTrace::Dig(const Pose& start, float seconds, float dt, double screenCenterX, double screenCenterY) {
+	InputTrace trace;
+	trace.start = start;
+	trace.start.pitch = 89.0f; //straight down
+	size_t cnt = (size_t)std::ceil(seconds / dt);
+	for (size_t n = 0; n < cnt; ++n) trace.BeginFrame(dt);
+
+	Event cursor{ Event::CURSOR };
+	cursor.x = screenCenterX, cursor.y = screenCenterY;
+	Event button{ Event::BUTTON };
+	button.button = GLFW_MOUSE_BUTTON_LEFT;
+	button.action = GLFW_PRESS;
+	trace.frames.front().events = { cursor, button };
+	button.action = GLFW_RELEASE;
+	trace.frames.back().events.push_back(button);
+	return trace;
+}
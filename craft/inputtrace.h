@@ -0,0 +1,64 @@
+#pragma once
+#ifndef INPUTTRACE_H
+#define INPUTTRACE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/*
+the input of a run, frame by frame: the time step, the keys processInput saw held down,
+and the window callbacks(cursor, mouse button, scroll) in the order they arrived.
+replaying a trace from its starting pose feeds the game the same input with the same time steps,
+so a run can be repeated exactly, with or without a window.
+*/
+class InputTrace {
+public:
+	struct Event {
+		enum Type : uint8_t {
+			CURSOR, BUTTON, SCROLL
+		};
+		Type type;
+		int32_t button = 0, action = 0, mods = 0; //BUTTON
+		double x = 0.0, y = 0.0; //CURSOR position, SCROLL offsets
+	};
+
+	struct Frame {
+		float dt = 0.0f;
+		std::vector<int16_t> keysDown; //glfw key codes, sorted
+		std::vector<Event> events;
+	};
+
+	// camera at the first frame
+	struct Pose {
+		glm::vec3 position{ 0.0f };
+		float yaw = 0.0f, pitch = 0.0f;
+	};
+
+	Pose start;
+	std::vector<Frame> frames;
+
+	bool empty() const { return frames.empty(); }
+	size_t size() const { return frames.size(); }
+	float Duration() const;
+
+	// recording. the frame's keys and events go to the last frame added.
+	void BeginFrame(float dt);
+	void RecordKey(int key);
+	void RecordEvent(const Event& e);
+	bool IsKeyDown(size_t frame, int key) const;
+
+	// binary trace files. Read returns false, and leaves the trace empty, if the file is missing or corrupted.
+	bool Write(const std::string& path) const;
+	bool Read(const std::string& path);
+
+	// scripted runs at a fixed time step.
+	// a straight flight of the given length at a constant height, holding W.
+	static InputTrace Flight(const Pose& start, float distance, float speed, float dt);
+	// looking straight down from start and holding the left mouse button at the screen center for the given time,
+	// which digs a shaft under the camera.
+	static InputTrace Dig(const Pose& start, float seconds, float dt, double screenCenterX, double screenCenterY);
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "light.h"
+#include "world.h"
+#include "profiler.h"
+#include <algorithm>
+
+static const int DIRS[6][3] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+static constexpr int MAX_LIGHT = BlockDB::MAX_LIGHT;
+
+static int opposite(int dir) {
+	return dir ^ 1;
+}
+
+bool LightEngine::neighbour(const Node& n, int dir, Node& out) {
+	out.chunk = n.chunk;
+	out.i = n.i + DIRS[dir][0], out.j = n.j + DIRS[dir][1], out.k = n.k + DIRS[dir][2];
+	glm::ivec3 step(0);
+	if (out.i < 0) out.i += Chunk::SZ, step.x = -1;
+	else if (out.i >= Chunk::SZ) out.i -= Chunk::SZ, step.x = 1;
+	if (out.j < 0) out.j += Chunk::HEIGHT, step.y = -1;
+	else if (out.j >= Chunk::HEIGHT) out.j -= Chunk::HEIGHT, step.y = 1;
+	if (out.k < 0) out.k += Chunk::SZ, step.z = -1;
+	else if (out.k >= Chunk::SZ) out.k -= Chunk::SZ, step.z = 1;
+	if (step == glm::ivec3(0)) return true;
+	out.chunk = world.allChunks.Find(n.chunk->chunkIdx + step);
+	return out.chunk && out.chunk->lit;
+}
+
+int LightEngine::passes(int light, int dir, BlockDB::BlockType ty) {
+	int opacity = BlockDB::GetInstance().lightOpacity(ty);
+	if (light == MAX_LIGHT && dir == Y_NEG && opacity == 0) return MAX_LIGHT;
+	return std::max(0, light - 1 - opacity);
+}
+
+int LightEngine::skyLight(Chunk& chunk, int i, int j, int k) {
+	if (j != Chunk::HEIGHT - 1) return 0;
+	Chunk* above = world.allChunks.Find(chunk.chunkIdx + glm::ivec3(0, 1, 0));
+	if (above && above->lit) return 0;
+	if (chunk.basepos.y + Chunk::HEIGHT <= chunk.blockHeight[i][k]) return 0; //under the terrain
+	return passes(MAX_LIGHT, Y_NEG, chunk.grid[i][j][k]);
+}
+
+void LightEngine::markRelit(Chunk& chunk, int i, int j, int k) {
+	auto mark = [this](Chunk* c) {
+		if (!c) return;
+		c->requiresRebuild = true;
+		if (std::find(relit.begin(), relit.end(), c->chunkIdx) == relit.end()) relit.push_back(c->chunkIdx);
+	};
+	mark(&chunk);
+	// the faces of the neighbour that look into this block show its light
+	if (i == 0) mark(world.allChunks.Find(chunk.chunkIdx + glm::ivec3(-1, 0, 0)));
+	if (i == Chunk::SZ - 1) mark(world.allChunks.Find(chunk.chunkIdx + glm::ivec3(1, 0, 0)));
+	if (j == 0) mark(world.allChunks.Find(chunk.chunkIdx + glm::ivec3(0, -1, 0)));
+	if (j == Chunk::HEIGHT - 1) mark(world.allChunks.Find(chunk.chunkIdx + glm::ivec3(0, 1, 0)));
+	if (k == 0) mark(world.allChunks.Find(chunk.chunkIdx + glm::ivec3(0, 0, -1)));
+	if (k == Chunk::SZ - 1) mark(world.allChunks.Find(chunk.chunkIdx + glm::ivec3(0, 0, 1)));
+}
+
+void LightEngine::set(Node& n, int light) {
+	n.chunk->skyLight[n.i][n.j][n.k] = (uint8_t)light;
+	markRelit(*n.chunk, n.i, n.j, n.k);
+}
+
+void LightEngine::removeAll() {
+	// a neighbour that is no brighter than what the removed light gave it may have been lit by it, so it goes too.
+	// a brighter one has a light of its own, and refills the removed region afterwards.
+	for (size_t head = 0; head < removeQueue.size(); ++head) {
+		Node n = removeQueue[head];
+		stats.cellsVisited++;
+		for (int dir = 0; dir < 6; ++dir) {
+			Node m;
+			if (!neighbour(n, dir, m)) continue;
+			int cur = m.chunk->skyLight[m.i][m.j][m.k];
+			if (cur == 0) continue;
+			if (cur > passes(n.light, dir, m.chunk->grid[m.i][m.j][m.k])) {
+				addQueue.push_back(m);
+				continue;
+			}
+			int sky = skyLight(*m.chunk, m.i, m.j, m.k);
+			set(m, sky);
+			if (sky > 0) addQueue.push_back(m);
+			if (sky < cur) {
+				m.light = (uint8_t)cur;
+				removeQueue.push_back(m);
+			}
+		}
+	}
+	removeQueue.clear();
+}
+
+void LightEngine::addAll() {
+	for (size_t head = 0; head < addQueue.size(); ++head) {
+		Node n = addQueue[head];
+		stats.cellsVisited++;
+		int light = n.chunk->skyLight[n.i][n.j][n.k];
+		if (light <= 1) continue;
+		for (int dir = 0; dir < 6; ++dir) {
+			Node m;
+			if (!neighbour(n, dir, m)) continue;
+			int v = passes(light, dir, m.chunk->grid[m.i][m.j][m.k]);
+			if (v <= m.chunk->skyLight[m.i][m.j][m.k]) continue;
+			set(m, v);
+			addQueue.push_back(m);
+		}
+	}
+	addQueue.clear();
+}
+
+void LightEngine::Seed(Chunk& chunk) {
+	constexpr int SZ = Chunk::SZ, HEIGHT = Chunk::HEIGHT;
+	PROFILE_ZONE("LightEngine::Seed");
+	Chunk* nbrs[6];
+	for (int dir = 0; dir < 6; ++dir) {
+		Chunk* c = world.allChunks.Find(chunk.chunkIdx + glm::ivec3(DIRS[dir][0], DIRS[dir][1], DIRS[dir][2]));
+		nbrs[dir] = c && c->lit ? c : nullptr;
+	}
+	stats.seeded++;
+
+	// 1. the columns, from the sky down. nothing is lit yet, so they are written without marking.
+	for (int i = 0; i < SZ; ++i) {
+		for (int k = 0; k < SZ; ++k) {
+			int light = skyLight(chunk, i, HEIGHT - 1, k);
+			for (int j = HEIGHT - 1; j >= 0 && light > 0; --j) {
+				if (j < HEIGHT - 1) light = passes(light, Y_NEG, chunk.grid[i][j][k]);
+				chunk.skyLight[i][j][k] = (uint8_t)light;
+			}
+		}
+	}
+	chunk.lit = true;
+	markRelit(chunk, 1, 1, 1);
+
+	// 2. the chunk below took the sky above it from the terrain height. where this chunk doesn't pass the sky
+	// down after all(a tree, an overhang), that light goes.
+	if (Chunk* below = nbrs[Y_NEG]) {
+		for (int i = 0; i < SZ; ++i) {
+			for (int k = 0; k < SZ; ++k) {
+				if (chunk.skyLight[i][0][k] == MAX_LIGHT || below->basepos.y + HEIGHT <= below->blockHeight[i][k]) continue;
+				Node n{ below, i, HEIGHT - 1, k, below->skyLight[i][HEIGHT - 1][k] };
+				if (n.light == 0) continue;
+				set(n, 0);
+				removeQueue.push_back(n);
+			}
+		}
+		removeAll();
+	}
+
+	// 3. spread sideways inside the chunk, from the blocks next to a darker one
+	for (int i = 0; i < SZ; ++i) {
+		for (int j = 0; j < HEIGHT; ++j) {
+			for (int k = 0; k < SZ; ++k) {
+				int light = chunk.skyLight[i][j][k];
+				if (light <= 1) continue;
+				bool darker = (i > 0 && chunk.skyLight[i - 1][j][k] < light - 1) || (i < SZ - 1 && chunk.skyLight[i + 1][j][k] < light - 1)
+					|| (k > 0 && chunk.skyLight[i][j][k - 1] < light - 1) || (k < SZ - 1 && chunk.skyLight[i][j][k + 1] < light - 1)
+					|| (j > 0 && chunk.skyLight[i][j - 1][k] < light - 1);
+				if (darker) addQueue.push_back({ &chunk, i, j, k, 0 });
+			}
+		}
+	}
+
+	// 4. and across the borders, both ways
+	for (int dir = 0; dir < 6; ++dir) {
+		Chunk* nbr = nbrs[dir];
+		if (!nbr) continue;
+		int axis = dir / 2;
+		int mine = dir % 2 ? (axis == 1 ? HEIGHT - 1 : SZ - 1) : 0; //layer of this chunk on that side
+		int theirs = dir % 2 ? 0 : (axis == 1 ? HEIGHT - 1 : SZ - 1);
+		int ua = axis == 0 ? 1 : 0, va = axis == 2 ? 1 : 2; //the two other axes
+		int uEnd = ua == 1 ? HEIGHT : SZ, vEnd = va == 1 ? HEIGHT : SZ;
+		for (int u = 0; u < uEnd; ++u) {
+			for (int v = 0; v < vEnd; ++v) {
+				int c[3];
+				c[ua] = u, c[va] = v;
+				c[axis] = mine;
+				if (chunk.skyLight[c[0]][c[1]][c[2]] > 1) addQueue.push_back({ &chunk, c[0], c[1], c[2], 0 });
+				c[axis] = theirs;
+				if (nbr->skyLight[c[0]][c[1]][c[2]] > 1) addQueue.push_back({ nbr, c[0], c[1], c[2], 0 });
+			}
+		}
+	}
+	addAll();
+}
+
+void LightEngine::BlockChanged(Chunk& chunk, const glm::ivec3& bidx, BlockDB::BlockType before, BlockDB::BlockType after) {
+	Change change{ &chunk, bidx, before, after };
+	BlocksChanged(&change, 1);
+}
+
+void LightEngine::BlocksChanged(const Change* changes, size_t count) {
+	BlockDB& blockDB = BlockDB::GetInstance();
+	auto relights = [&blockDB](const Change& c) { return c.chunk->lit && blockDB.lightOpacity(c.before) != blockDB.lightOpacity(c.after); };
+
+	// take away the blocks' light and whatever depended on it
+	for (size_t n = 0; n < count; ++n) {
+		const Change& c = changes[n];
+		if (!relights(c)) continue;
+		stats.updates++;
+		Node node{ c.chunk, c.bidx.x, c.bidx.y, c.bidx.z, c.chunk->skyLight[c.bidx.x][c.bidx.y][c.bidx.z] };
+		set(node, 0);
+		removeQueue.push_back(node);
+	}
+	if (removeQueue.empty()) return;
+	removeAll();
+
+	// then light them again from their neighbours, and the removed region along with them.
+	// a block changed twice is lit by what is in the grid now.
+	for (size_t n = 0; n < count; ++n) {
+		const Change& c = changes[n];
+		if (!relights(c)) continue;
+		Node node{ c.chunk, c.bidx.x, c.bidx.y, c.bidx.z, 0 };
+		BlockDB::BlockType type = c.chunk->grid[node.i][node.j][node.k];
+		int light = skyLight(*c.chunk, node.i, node.j, node.k);
+		for (int dir = 0; dir < 6; ++dir) {
+			Node m;
+			if (!neighbour(node, dir, m)) continue;
+			light = std::max(light, passes(m.chunk->skyLight[m.i][m.j][m.k], opposite(dir), type));
+		}
+		if (light > c.chunk->skyLight[node.i][node.j][node.k]) set(node, light);
+		addQueue.push_back(node);
+	}
+	addAll();
+}
+
+std::vector<glm::ivec3> LightEngine::TakeRelit() {
+	std::vector<glm::ivec3> taken;
+	taken.swap(relit);
+	return taken;
+}
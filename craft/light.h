@@ -0,0 +1,79 @@
+#pragma once
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "blocks.hpp"
+
+class World;
+class Chunk;
+
+/*
+sky light, per block, in Chunk::skyLight. light comes down from the sky unchanged through blocks that don't absorb any,
+and loses 1 for every other step(plus the block's BlockDB::lightOpacity), so it fades into caves and under overhangs.
+
+a chunk is lit once it is decorated(Seed()): each column is filled from the top, then the light spreads sideways
+breadth first, and across the borders with the lit neighbours in both directions. the sky above a chunk whose upper
+neighbour isn't lit is taken from the terrain height: a column that reaches above the terrain sees the sky.
+
+after that, a block whose light opacity changes(BlockChanged(), called by the chunk's block manipulation functions,
+or BlocksChanged() for a batch of edits) is relit incrementally, across chunk borders: the light that depended on the block is removed breadth first,
+then the removed region is filled again from its lit surroundings. the work is proportional to the region whose light
+changed, not to the chunk. chunks that aren't lit are left alone, they get their light when they are seeded.
+
+chunks whose light changed, or whose faces show a neighbour's changed light, are collected for World::Build.
+*/
+class LightEngine {
+public:
+	struct Stats {
+		size_t seeded = 0; //chunks
+		size_t updates = 0; //block changes relit
+		size_t cellsVisited = 0; //by the propagation
+	};
+
+	struct Change {
+		Chunk* chunk;
+		glm::ivec3 bidx;
+		BlockDB::BlockType before, after;
+	};
+
+	explicit LightEngine(World& world) : world(world) {}
+
+	void Seed(Chunk& chunk);
+	void BlockChanged(Chunk& chunk, const glm::ivec3& bidx, BlockDB::BlockType before, BlockDB::BlockType after);
+	// blocks changed together(World::ApplyEdits), already in their chunks' grids. the light of all of them is removed
+	// in one pass and filled in again in another, so a region several of them darken is only visited once.
+	void BlocksChanged(const Change* changes, size_t count);
+
+	// chunks to rebuild because their light changed since the last call
+	std::vector<glm::ivec3> TakeRelit();
+	const Stats& GetStats() const { return stats; }
+
+private:
+	struct Node {
+		Chunk* chunk;
+		int i, j, k;
+		uint8_t light; //removal: the light the block had
+	};
+	enum Dir { X_NEG, X_POS, Y_NEG, Y_POS, Z_NEG, Z_POS };
+
+	// the block next to n in dir, false if its chunk isn't lit
+	bool neighbour(const Node& n, int dir, Node& out);
+	// light reaching a block of type ty from a neighbour with light, coming in dir
+	static int passes(int light, int dir, BlockDB::BlockType ty);
+	// light a block gets straight from the sky: only the top layer of a chunk whose upper neighbour isn't lit
+	int skyLight(Chunk& chunk, int i, int j, int k);
+	void set(Node& n, int light);
+	void removeAll();
+	void addAll();
+	void markRelit(Chunk& chunk, int i, int j, int k);
+
+	World& world;
+	std::vector<Node> addQueue, removeQueue; //reused
+	std::vector<glm::ivec3> relit;
+	Stats stats;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "lod.h"
+#include "world.h"
+#include <algorithm>
+
+int TerrainLod::StepFor(int dist, int viewRadius) {
+	if (dist <= viewRadius || dist > RadiusFor(viewRadius)) return 0;
+	if (dist <= 2 * viewRadius) return 2;
+	if (dist <= 4 * viewRadius) return 4;
+	return 8;
+}
+
+int TerrainLod::tileStep(int tx, int tz) const {
+	return StepFor(std::max(std::abs(tx - center.x), std::abs(tz - center.z)), radius);
+}
+
+void TerrainLod::retarget(const glm::ivec3& centerChunk, int viewRadius) {
+	center = centerChunk;
+	radius = viewRadius;
+	const int reach = RadiusFor(radius);
+	const int rx0 = ChunkIndex::FloorDiv(center.x - reach, REGION_TILES), rx1 = ChunkIndex::FloorDiv(center.x + reach, REGION_TILES);
+	const int rz0 = ChunkIndex::FloorDiv(center.z - reach, REGION_TILES), rz1 = ChunkIndex::FloorDiv(center.z + reach, REGION_TILES);
+
+	// regions that left the ring free their buffers, tiles that left it or entered the window their samples.
+	for (auto it = regions.begin(); it != regions.end();) {
+		auto [rx, rz] = it->first;
+		auto next = std::next(it);
+		if (rx < rx0 || rx > rx1 || rz < rz0 || rz > rz1) {
+			it->second.renderObj.DeleteBuffers();
+			spareRegions.push_back(regions.extract(it));
+		}
+		it = next;
+	}
+	for (auto it = tiles.begin(); it != tiles.end();) {
+		auto next = std::next(it);
+		if (tileStep(it->first.first, it->first.second) == 0) spareTiles.push_back(tiles.extract(it));
+		it = next;
+	}
+
+	steps.resize(REGION_TILES * REGION_TILES);
+	for (int rx = rx0; rx <= rx1; ++rx) {
+		for (int rz = rz0; rz <= rz1; ++rz) {
+			for (int a = 0; a < REGION_TILES; ++a) {
+				for (int b = 0; b < REGION_TILES; ++b) {
+					steps[a * REGION_TILES + b] = tileStep(rx * REGION_TILES + a, rz * REGION_TILES + b);
+				}
+			}
+			Region& region = findOrAddRegion({ rx, rz });
+			if (region.steps == steps) continue;
+			region.dirty = true;
+
+			// a mesh still covering tiles inside the window would poke through the full-detail chunks.
+			for (int n = 0; n < (int)region.steps.size(); ++n) {
+				int tx = rx * REGION_TILES + n / REGION_TILES, tz = rz * REGION_TILES + n % REGION_TILES;
+				bool inWindow = std::abs(tx - center.x) <= radius && std::abs(tz - center.z) <= radius;
+				if (region.steps[n] != 0 && inWindow) region.urgent = true;
+			}
+		}
+	}
+}
+
+void TerrainLod::Update(TerrainGeneration& worldgen, const glm::ivec3& centerChunk, int viewRadius) {
+	auto begin = std::chrono::steady_clock::now();
+	auto deadline = begin + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(budgetMs));
+	lastFrame.sampled = lastFrame.rebuilt = 0;
+	if (centerChunk.x != center.x || centerChunk.z != center.z || viewRadius != radius) retarget(centerChunk, viewRadius);
+
+	// urgent regions first, then nearest first
+	rebuildList.clear();
+	for (auto& [ridx, region] : regions) {
+		if (!region.dirty) continue;
+		int cx = ridx.first * REGION_TILES + REGION_TILES / 2, cz = ridx.second * REGION_TILES + REGION_TILES / 2;
+		int dist = std::max(std::abs(cx - center.x), std::abs(cz - center.z));
+		rebuildList.push_back({ region.urgent ? -1 : dist, ridx });
+	}
+	std::sort(rebuildList.begin(), rebuildList.end());
+
+	for (auto& [dist, ridx] : rebuildList) {
+		Region& region = regions[ridx];
+		if (!region.urgent && std::chrono::steady_clock::now() >= deadline) break;
+
+		// urgent regions are meshed from whatever samples exist, and meshed again once the rest are sampled.
+		bool complete = sampleRegion(worldgen, ridx, deadline);
+		if (!complete && !region.urgent) break;
+		buildRegion(ridx, region);
+		region.dirty = !complete;
+		region.urgent = false;
+		lastFrame.rebuilt++;
+	}
+
+	lastFrame.regions = regions.size();
+	lastFrame.tiles = tiles.size();
+	lastFrame.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+bool TerrainLod::sampleRegion(TerrainGeneration& worldgen, const pii& ridx, std::chrono::steady_clock::time_point deadline) {
+	for (int a = 0; a < REGION_TILES; ++a) {
+		for (int b = 0; b < REGION_TILES; ++b) {
+			pii tidx{ ridx.first * REGION_TILES + a, ridx.second * REGION_TILES + b };
+			int step = tileStep(tidx.first, tidx.second);
+			if (step == 0) continue;
+			// steps are powers of two, so samples of any finer step contain the ones needed
+			auto it = tiles.find(tidx);
+			if (it != tiles.end() && it->second.step <= step) continue;
+			if (std::chrono::steady_clock::now() >= deadline) return false;
+			sampleTile(worldgen, tidx, step);
+			lastFrame.sampled++;
+		}
+	}
+	return true;
+}
+
+TerrainLod::TileSamples& TerrainLod::findOrAddTile(const pii& tidx) {
+	auto it = tiles.find(tidx);
+	if (it != tiles.end()) return it->second;
+	if (spareTiles.empty()) {
+		// room for the finest step, so the buffers never grow again
+		TileSamples& samples = tiles[tidx];
+		samples.height.reserve((Chunk::SZ / 2 + 1) * (Chunk::SZ / 2 + 1));
+		samples.biome.reserve((Chunk::SZ / 2 + 1) * (Chunk::SZ / 2 + 1));
+		return samples;
+	}
+	auto node = std::move(spareTiles.back());
+	spareTiles.pop_back();
+	node.key() = tidx;
+	return tiles.insert(std::move(node)).position->second;
+}
+
+TerrainLod::Region& TerrainLod::findOrAddRegion(const pii& ridx) {
+	auto it = regions.find(ridx);
+	if (it != regions.end()) return it->second;
+	if (spareRegions.empty()) return regions[ridx];
+	auto node = std::move(spareRegions.back());
+	spareRegions.pop_back();
+	node.key() = ridx;
+	Region& region = regions.insert(std::move(node)).position->second;
+	region.steps.clear();
+	region.dirty = true;
+	region.urgent = false;
+	return region;
+}
+
+void TerrainLod::sampleTile(TerrainGeneration& worldgen, const pii& tidx, int step) {
+	TileSamples& samples = findOrAddTile(tidx);
+	const int n = Chunk::SZ / step + 1; //the last row and column are shared with the next tiles
+	samples.step = step;
+	samples.height.resize(n * n);
+	samples.biome.resize(n * n);
+	for (int a = 0; a < n; ++a) {
+		for (int b = 0; b < n; ++b) {
+			worldgen.SampleColumn(tidx.first * Chunk::SZ + a * step, tidx.second * Chunk::SZ + b * step,
+				OUT samples.height[a * n + b], OUT samples.biome[a * n + b]);
+		}
+	}
+}
+
+void TerrainLod::buildRegion(const pii& ridx, Region& region) {
+	region.steps.assign(REGION_TILES * REGION_TILES, 0);
+	region.renderObj.arena = &MeshArena::GetInstance();
+	region.renderObj.DeleteBuffers();
+	region.renderObj.BeginStaging(MeshStaging::ThreadLocal(0));
+	for (int a = 0; a < REGION_TILES; ++a) {
+		for (int b = 0; b < REGION_TILES; ++b) {
+			pii tidx{ ridx.first * REGION_TILES + a, ridx.second * REGION_TILES + b };
+			int step = tileStep(tidx.first, tidx.second);
+			region.steps[a * REGION_TILES + b] = step;
+			if (step) meshTile(region.renderObj, tidx, step);
+		}
+	}
+	region.renderObj.Build();
+}
+
+void TerrainLod::meshTile(RenderObject& obj, const pii& tidx, int step) {
+	auto it = tiles.find(tidx);
+	if (it == tiles.end()) return;
+	const TileSamples& samples = it->second;
+
+	// coarser samples stand in until the finer ones are sampled
+	const int s = std::max(step, samples.step);
+	const int stride = s / samples.step, n = Chunk::SZ / samples.step + 1, m = Chunk::SZ / s;
+	const glm::f32vec3 base(tidx.first * Chunk::SZ - 0.5f, 0.0f, tidx.second * Chunk::SZ - 0.5f);
+
+	// top of the column under grid point (a, b). oceans are filled with water up to level 0.
+	auto point = [&](int a, int b) {
+		int n0 = a * stride * n + b * stride;
+		bool isOcean = samples.biome[n0] == BiomeType::SHALLOW_OCEAN || samples.biome[n0] == BiomeType::DEEP_OCEAN;
+		float top = (isOcean ? std::max(0, samples.height[n0]) : samples.height[n0]) + 0.5f;
+		return base + glm::f32vec3(a * s, top, b * s);
+	};
+	auto texture = [&](int a, int b) {
+		BiomeType biome = samples.biome[a * stride * n + b * stride];
+		if (biome == BiomeType::SHALLOW_OCEAN || biome == BiomeType::DEEP_OCEAN) return BlockDB::BlockTextures::WATER;
+		const BiomeDB::BiomeDataRow& row = BiomeDB::GetInstance().biomes[biome];
+		BlockDB::BlockType surface = row.surfaceBlockTypes.empty() ? BlockDB::BLOCK_GRANITE : row.surfaceBlockTypes[0];
+		return BlockDB::GetInstance().tbl[surface].faceTextures[Block::Face::TOP];
+	};
+
+	// heightfield
+	for (int a = 0; a < m; ++a) {
+		for (int b = 0; b < m; ++b) {
+			glm::f32vec3 corners[4] = { point(a, b), point(a + 1, b), point(a + 1, b + 1), point(a, b + 1) };
+			obj.PlaceQuadData(corners, texture(a, b), (float)s, (float)s);
+		}
+	}
+
+	// skirts along the four edges
+	auto skirt = [&](int a0, int b0, int a1, int b1) {
+		glm::f32vec3 p0 = point(a0, b0), p1 = point(a1, b1);
+		float bottom = std::min(p0.y, p1.y) - SKIRT_DEPTH * s;
+		glm::f32vec3 corners[4] = { p0, p1, { p1.x, bottom, p1.z }, { p0.x, bottom, p0.z } };
+		obj.PlaceQuadData(corners, texture(std::min(a0, m - 1), std::min(b0, m - 1)), (float)s, std::max(p0.y, p1.y) - bottom);
+	};
+	for (int i = 0; i < m; ++i) {
+		skirt(0, i, 0, i + 1);
+		skirt(m, i, m, i + 1);
+		skirt(i, 0, i + 1, 0);
+		skirt(i, m, i + 1, m);
+	}
+}
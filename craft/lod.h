@@ -0,0 +1,91 @@
+#pragma once
+#ifndef LOD_H
+#define LOD_H
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "rendering.hpp"
+#include "map.h"
+
+class TerrainGeneration;
+
+/*
+far terrain drawn around the view window, meshed directly from sampled column heights and biomes
+instead of voxel grids.
+the ring is made of tiles with the footprint of a chunk column. a tile samples every 2nd, 4th or 8th
+block column the farther it is from the window, and becomes a heightfield textured with the surface
+block of each column's biome.
+tiles hang skirts from their edges. the skirts cover the cracks between tiles of different steps,
+and between the ring and the full-detail chunks at the edge of the window.
+tiles are merged into regions of REGION_TILES x REGION_TILES tiles, one render object each.
+a region is rebuilt only when the step of one of its tiles changes.
+*/
+class TerrainLod {
+public:
+	using pii = std::pair<int, int>;
+	static constexpr int REGION_TILES = 8;
+	static constexpr int RADIUS_FACTOR = 10; //the ring reaches this many view radii from the window center
+	static constexpr int SKIRT_DEPTH = 4; //in sampling steps
+
+	struct Region {
+		RenderObject renderObj{ RenderObject::OPAQUE };
+		std::vector<int> steps; //step of every tile when the region was last meshed, 0 if not drawn
+		bool dirty = true;
+		bool urgent = false; //the mesh covers tiles that are now inside the window
+	};
+
+	struct Stats {
+		size_t regions = 0, tiles = 0; //in the ring
+		int sampled = 0, rebuilt = 0; //this frame
+		double elapsedMs = 0.0;
+	};
+
+	// time spent on sampling and meshing per frame.
+	// regions overlapping the window are rebuilt regardless, from whatever samples exist.
+	double budgetMs = 2.0;
+
+	std::map<pii, Region> regions;
+
+	// outer radius of the ring in chunks, for a window of the given radius.
+	static int RadiusFor(int viewRadius) { return viewRadius * RADIUS_FACTOR; }
+	// sampling step of a tile dist chunks from the window center(chebyshev distance). 0 means not drawn.
+	static int StepFor(int dist, int viewRadius);
+
+	// follows the window center and rebuilds changed regions, nearest first, within the budget.
+	void Update(TerrainGeneration& worldgen, const glm::ivec3& centerChunk, int viewRadius);
+
+	const Stats& LastFrameStats() const { return lastFrame; }
+
+private:
+	struct TileSamples {
+		int step = 0;
+		std::vector<int> height; //(SZ/step + 1)^2 columns, x major
+		std::vector<MapGen::BiomeType> biome;
+	};
+
+	int tileStep(int tx, int tz) const;
+	void retarget(const glm::ivec3& centerChunk, int viewRadius);
+	bool sampleRegion(TerrainGeneration& worldgen, const pii& ridx, std::chrono::steady_clock::time_point deadline);
+	void sampleTile(TerrainGeneration& worldgen, const pii& tidx, int step);
+	void buildRegion(const pii& ridx, Region& region);
+	void meshTile(RenderObject& obj, const pii& tidx, int step);
+
+	// finds or adds the tile's samples, reusing the buffers of a tile that left the ring
+	TileSamples& findOrAddTile(const pii& tidx);
+	Region& findOrAddRegion(const pii& ridx);
+
+	std::map<pii, TileSamples> tiles;
+	// tiles and regions that left the ring, kept with their buffers so the ring moves without allocating
+	std::vector<std::map<pii, TileSamples>::node_type> spareTiles;
+	std::vector<std::map<pii, Region>::node_type> spareRegions;
+	std::vector<std::pair<int, pii>> rebuildList; //(distance, region), reused across frames
+	std::vector<int> steps; //reused by retarget
+	glm::ivec3 center{ 0 };
+	int radius = 0;
+	Stats lastFrame;
+};
+
+#endif
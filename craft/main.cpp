@@ -1,4 +1,7 @@
 #include <iostream>
+#include <chrono>
+#include <random>
+#include <map>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <stb/stb_image.h>
@@ -17,15 +20,76 @@
 #include "collision.h"
 #include "rendering.hpp"
 #include "weather.h"
+#include "renderqueue.h"
+#include "occlusion.h"
+#include "visibility.h"
+#include "profiler.h"
+#include "gputimer.h"
+#include "headlessgl.h"
+#include "inputtrace.h"
+#include "runstats.h"
+#include "raycaster.h"
+#include "simulation.h"
+#include "broadphase.h"
 using namespace std;
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-void testRaycast(FacesSelection& selectedFaces);
+int getKey(GLFWwindow* window, int key);
+bool captureEvent(const InputTrace::Event& e);
+void dispatchEvent(GLFWwindow* window, const InputTrace::Event& e);
+void applyViewDistance();
+void benchmarkRaycast();
+void benchmarkEntities();
+void benchmarkBroadphase();
+void benchmarkWater();
+void benchmarkEdits();
+void benchmarkChunkIndex();
+std::vector<glm::ivec3> groundAroundSpawn(int spacing);
 
 constexpr int SCREEN_WIDTH = 800, SCREEN_HEIGHT = 800;
+const char* EDITS_SAVE_PATH = "world.edits";
+const char* WATER_SAVE_PATH = "world.water";
+const char* PROFILE_TRACE_PATH = "trace.json";
+// command line:
+//	--record <path>		records the input of the run to a trace file
+//	--replay <path>		replays a recorded trace, then exits
+//	--script flight|dig	replays a built in trace: a straight 2km flight, or digging in place
+//	--fixed-step		advances time by FIXED_TIME_STEP every frame instead of the wall clock
+//	--headless			runs without a window or GPU(see HeadlessGL), replaying the flight script unless told otherwise
+//	--report <path>		writes the run's frame time percentiles, streaming counts and memory high-water marks
+//	--bench-raycast		measures VoxelRaycaster throughput on the spawn area, then exits
+//	--bench-entities	measures EntityStore::Step with ENTITY_BENCH_COUNT entities falling on the spawn area, then exits
+//	--bench-broadphase	measures SpatialHash updates, pairs and the narrowphase for each of BROADPHASE_BENCH_COUNTS bodies, then exits
+//	--bench-water		measures WaterFlow::Step while each of WATER_BENCH_SOURCES sources placed around the spawn area flows, then exits
+//	--bench-edits		blasts EDIT_BENCH_CRATERS craters into the spawn area, block by block and in batches, remeshing as it goes, then exits
+//	--bench-chunkindex	measures chunk lookups of the spawn area in a std::map, the ChunkHashMap and the ChunkWindow, then exits
+constexpr float FIXED_TIME_STEP = 1.0f / 60.0f;
+constexpr float FLIGHT_DISTANCE = 2000.0f, FLIGHT_HEIGHT = 72.0f, DIG_SECONDS = 20.0f;
+// chunk streaming tasks per frame while replaying, instead of the time budget
+constexpr size_t REPLAY_TASK_BUDGET = 4;
+constexpr size_t RAYCAST_BENCH_RAYS = 1 << 20;
+constexpr float RAYCAST_BENCH_DISTANCE = 64.0f;
+constexpr size_t ENTITY_BENCH_COUNT = 10000, ENTITY_BENCH_STEPS = 600;
+constexpr size_t BROADPHASE_BENCH_COUNTS[] = { 1000, 10000, 100000 }, BROADPHASE_BENCH_STEPS = 60;
+constexpr float BROADPHASE_BENCH_VOLUME = 64.0f; //cubic blocks per body
+constexpr size_t WATER_BENCH_SOURCES[] = { 1, 16, 128 }, WATER_BENCH_MAX_TICKS = 6000, WATER_BENCH_IDLE_TICKS = 600;
+constexpr int EDIT_BENCH_CRATERS = 8, EDIT_BENCH_RADIUS = 4; //half of the craters are blasted block by block
+constexpr size_t CHUNKINDEX_BENCH_LOOKUPS = 1 << 22;
+// player movement, collision, digging and entities, in fixed ticks. on a thread of its own in live runs.
+std::unique_ptr<Simulation> simulation;
+// chunks this close to the camera's chunk contribute occluders to the occlusion buffer
+constexpr int OCCLUDER_RADIUS = 2;
+OcclusionBuffer occlusion;
+ChunkVisibility visibility;
+std::unique_ptr<GpuTimer> gpuTimer = std::make_unique<NullGpuTimer>();
+// view distance in chunks, horizontally and vertically around the player. changed at runtime with -/= and [/]
+int viewRadius = World::DEFAULT_VIEW_RADIUS, viewHeightRadius = World::DEFAULT_VIEW_HEIGHT_RADIUS;
+// brightness of the sky light, from night(0) to day(1). changed at runtime with O/P
+float dayLight = 1.0f;
+constexpr float DAY_LIGHT_STEP = 0.1f;
 
 bool isWindowed = true;
 bool isKeyboardProcessed[1024] = { 0 };
@@ -39,70 +103,151 @@ double lastX = SCREEN_WIDTH / 2.0f, lastY = SCREEN_HEIGHT / 2.0f;
 // timing
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
+double simTime = 0.0; // sum of the time steps so far
+bool fixedStep = false;
 
-// position
-glm::vec3 last_pos;
+// input record/replay
+enum class InputMode { LIVE, RECORD, REPLAY } inputMode = InputMode::LIVE;
+InputTrace inputTrace;
+size_t inputFrame = 0; //frame of inputTrace being replayed
 
-// active selection
-glm::ivec3 selectedBlockIdx;
-int selectedFace = -1;
-bool selectedBlockExists;
+std::shared_ptr<Shader> solidUIShader;
 
-struct Timer {
-public:
-	double startTime;
-	double setTime;
-	bool running;
-	double Start() {
-		startTime = glfwGetTime();
-		running = true;
-		return startTime;
+int main(int argc, char** argv) {
+	bool headless = false, benchRaycast = false, benchEntities = false, benchBroadphase = false, benchWater = false, benchEdits = false, benchChunkIndex = false;
+	std::string recordPath, replayPath, script, reportPath;
+	for (int n = 1; n < argc; ++n) {
+		std::string arg = argv[n];
+		bool hasValue = n + 1 < argc;
+		if (arg == "--headless") headless = true;
+		else if (arg == "--fixed-step") fixedStep = true;
+		else if (arg == "--bench-raycast") benchRaycast = true;
+		else if (arg == "--bench-entities") benchEntities = true;
+		else if (arg == "--bench-broadphase") benchBroadphase = true;
+		else if (arg == "--bench-water") benchWater = true;
+		else if (arg == "--bench-edits") benchEdits = true;
+		else if (arg == "--bench-chunkindex") benchChunkIndex = true;
+		else if (arg == "--record" && hasValue) recordPath = argv[++n];
+		else if (arg == "--replay" && hasValue) replayPath = argv[++n];
+		else if (arg == "--script" && hasValue) script = argv[++n];
+		else if (arg == "--report" && hasValue) reportPath = argv[++n];
+		else {
+			cout << "ERROR::MAIN::UNKNOWN_ARGUMENT: " << arg << endl;
+			return -1;
+		}
 	}
-	void Stop() {
-		running = false;
+	if (headless && replayPath.empty() && script.empty()) script = "flight";
+
+	GLFWwindow* window = nullptr;
+	if (headless) {
+		HeadlessGL::GetInstance().Install();
 	}
-	double GetTime() {
-		return running? (glfwGetTime() - startTime) : -1.0;
+	else {
+		glfwInit();
+
+		//gl VERSION 3.3
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "GLCraft", NULL, NULL);
+		if (window == NULL) {
+			cout << "window creation failed" << endl;
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		glfwSetCursorPosCallback(window, [](GLFWwindow* w, double x, double y) {
+			InputTrace::Event e{ InputTrace::Event::CURSOR };
+			e.x = x, e.y = y;
+			if (captureEvent(e)) mouse_callback(w, x, y);
+		});
+		glfwSetMouseButtonCallback(window, [](GLFWwindow* w, int button, int action, int mods) {
+			InputTrace::Event e{ InputTrace::Event::BUTTON };
+			e.button = button, e.action = action, e.mods = mods;
+			if (captureEvent(e)) mouse_button_callback(w, button, action, mods);
+		});
+		glfwSetScrollCallback(window, [](GLFWwindow* w, double xoffset, double yoffset) {
+			InputTrace::Event e{ InputTrace::Event::SCROLL };
+			e.x = xoffset, e.y = yoffset;
+			if (captureEvent(e)) scroll_callback(w, xoffset, yoffset);
+		});
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); //capture mouse? set CURSOR_DISABLED/NORMAL
+
+		gladLoadGL();
 	}
+	glViewport(0, 0, 800, 800);
+	// timer queries are core since 3.3
+	if (GLAD_GL_VERSION_3_3) gpuTimer = std::make_unique<GLGpuTimer>();
+	
 
-};
-
-struct BlockDestructionTimer:public Timer  {
-public:
-	static constexpr double DURATION = 2;
-	glm::ivec3 blockIdx;
-
-} blockDestructionTimer;
-
-std::shared_ptr<Shader> solidUIShader;
-
-int main() {
-	glfwInit();
-
-	//gl VERSION 3.3
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "GLCraft", NULL, NULL);
-	if (window == NULL) {
-		cout << "window creation failed" << endl;
-		glfwTerminate();
+	// input
+	if (!replayPath.empty()) {
+		if (!inputTrace.Read(replayPath)) return -1;
+		inputMode = InputMode::REPLAY;
+	}
+	else if (script == "flight") {
+		InputTrace::Pose start;
+		start.position = { 0.0f, FLIGHT_HEIGHT, 0.0f };
+		inputTrace = InputTrace::Flight(start, FLIGHT_DISTANCE, Camera::MainCamera.movementSpeed, FIXED_TIME_STEP);
+		inputMode = InputMode::REPLAY;
+	}
+	else if (script == "dig") {
+		// standing on the terrain at the origin
+		int height;
+		BiomeType biome;
+		World::GetInstance().worldgen.SampleColumn(0, 0, OUT height, OUT biome);
+		InputTrace::Pose start;
+		start.position = { 0.0f, height + 2.0f, 0.0f };
+		inputTrace = InputTrace::Dig(start, DIG_SECONDS, FIXED_TIME_STEP, SCREEN_WIDTH / 2.0, SCREEN_HEIGHT / 2.0);
+		inputMode = InputMode::REPLAY;
+	}
+	else if (!script.empty()) {
+		cout << "ERROR::MAIN::UNKNOWN_SCRIPT: " << script << endl;
 		return -1;
 	}
-	glfwMakeContextCurrent(window);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetMouseButtonCallback(window, mouse_button_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); //capture mouse? set CURSOR_DISABLED/NORMAL
+	else if (!recordPath.empty()) {
+		inputMode = InputMode::RECORD;
+		inputTrace.start = { Camera::MainCamera.position, Camera::MainCamera.yaw, Camera::MainCamera.pitch };
+	}
+	if (inputMode == InputMode::REPLAY) {
+		if (inputTrace.empty()) return 0;
+		Camera::MainCamera.SetPose(inputTrace.start.position, inputTrace.start.yaw, inputTrace.start.pitch);
+		// work per frame must not depend on the machine's speed
+		World::GetInstance().streamer.taskBudget = REPLAY_TASK_BUDGET;
+	}
 
-	gladLoadGL();
-	glViewport(0, 0, 800, 800);
-	
+	// the benchmarks start just above the ground(or the sea, at height 0) at the origin,
+	// so about half of the rays hit it, and the entities have somewhere to land.
+	if (benchRaycast || benchEntities || benchWater || benchEdits) {
+		int height;
+		BiomeType biome;
+		World::GetInstance().worldgen.SampleColumn(0, 0, OUT height, OUT biome);
+		Camera::MainCamera.SetPose({ 0.0f, std::max(height, 0) + 2.0f, 0.0f }, Camera::MainCamera.yaw, Camera::MainCamera.pitch);
+	}
 
 	// initialize objects
 	FacesSelection selectedFaces;
+	selectedFaces.Build();
+	EntityBoxes entityBoxes;
+	simulation = std::make_unique<Simulation>(World::GetInstance());
+	// replays start from the generated world and leave no edits behind
+	if (inputMode != InputMode::REPLAY) World::GetInstance().LoadEdits(EDITS_SAVE_PATH);
+	applyViewDistance();
 	World::GetInstance().CreateInitialChunks(Camera::MainCamera.position);
+	simulation->Reset(Camera::MainCamera.position);
+	// after Reset(), which forgets the scheduled water updates and restarts the ticks at 0
+	if (inputMode != InputMode::REPLAY) simulation->water.Load(WATER_SAVE_PATH, 0);
+	if (benchRaycast || benchEntities || benchBroadphase || benchWater || benchEdits || benchChunkIndex) {
+		if (benchRaycast) benchmarkRaycast();
+		if (benchEntities) benchmarkEntities();
+		if (benchBroadphase) benchmarkBroadphase();
+		if (benchWater) benchmarkWater();
+		if (benchEdits) benchmarkEdits();
+		if (benchChunkIndex) benchmarkChunkIndex();
+		if (window) glfwTerminate();
+		return 0;
+	}
 	CircleFill circleUI(70.f);
 	WeatherParticleRenderObj rainRenderObj(60.0f, 100.0f, 3000);
 	//create gl texture
@@ -124,66 +269,53 @@ int main() {
 
 	glEnable(GL_DEPTH_TEST);
 
-	double applicationStartTime = glfwGetTime();
 	size_t frameCnt = 0;
-	last_pos = Camera::MainCamera.position;
-	while (!glfwWindowShouldClose(window)) {
-
+	RenderQueue renderQueue; //reused every frame
+	Profiler::SetThreadName("main");
+	RunStats runStats;
+	auto running = [&]() {
+		if (inputMode == InputMode::REPLAY && inputFrame >= inputTrace.size()) return false;
+		return headless || !glfwWindowShouldClose(window);
+	};
+	// live runs tick in real time on the simulation thread. recorded, replayed and fixed step runs
+	// tick on this one, as many ticks as each frame's time step covers, so a replay repeats the run exactly.
+	if (inputMode == InputMode::LIVE && !fixedStep) simulation->Start();
+	while (running()) {
+		auto frameBegin = std::chrono::steady_clock::now();
+		Profiler::BeginFrame();
+		gpuTimer->BeginFrame();
 
 		//--------- GAME STATE
-		// time
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
-		lastFrame = currentFrame;
+		// time. replays and fixed step runs advance by their step instead of the clock.
+		if (inputMode == InputMode::REPLAY) {
+			deltaTime = inputTrace.frames[inputFrame].dt;
+		}
+		else if (fixedStep) {
+			deltaTime = FIXED_TIME_STEP;
+		}
+		else {
+			float now = glfwGetTime();
+			deltaTime = now - lastFrame;
+			lastFrame = now;
+		}
+		simTime += deltaTime;
+		float currentFrame = (float)simTime;
+		if (inputMode == InputMode::RECORD) inputTrace.BeginFrame(deltaTime);
 		frameCnt = (frameCnt + 1) % 1000000;
 
 		//--------- INPUT
-		processInput(window);
-		testRaycast(selectedFaces);
-
-		//--------- PHYSICS
-		// physics must come after inputs, because inputs directly modify camera's position.
-		glm::vec3 curr_pos = Camera::MainCamera.position;
-		glm::vec3 begin_pos = last_pos - glm::vec3{ 0.5f, 1.5f, 0.5f };
-		glm::vec3 end_pos = curr_pos - glm::vec3{ 0.5f, 1.5f, 0.5f };
-
-		glm::vec3 updated_pos = updatePositionWithCollisionCheck(begin_pos, end_pos, { 1.0f, 2.0f, 1.0f });
-		Camera::MainCamera.position = updated_pos + glm::vec3{0.5f, 1.5f, 0.5f};
-		last_pos = Camera::MainCamera.position;
-
-		//block destruction
-		if (mouseHeld) {
-			if (!selectedBlockExists) {
-				if (blockDestructionTimer.running) blockDestructionTimer.Stop();
-			}
-			else if (selectedBlockIdx == blockDestructionTimer.blockIdx && blockDestructionTimer.GetTime() > BlockDestructionTimer::DURATION) {
-				//DestroyBlock(blockDestructionTimer.blockIdx);
-				cout << "timer goes off" << endl;
-				Chunk* ch = World::GetInstance().GetChunkContainingBlock(selectedBlockIdx);
-				if (ch != nullptr) {
-					glm::ivec3 bidx = ch->BlockWorldToGridIdx(selectedBlockIdx);
-					ch->DestroyBlockAt(bidx);
-				}
-				blockDestructionTimer.Start();
-			}
-			else if (!blockDestructionTimer.running || selectedBlockIdx != blockDestructionTimer.blockIdx) {
-				//if selected block exists but timer isn't runinng, it should start running.
-				//also, if the selected block changes while mouse is still pressed, timer should restart.
-				Chunk* ch = World::GetInstance().GetChunkContainingBlock(selectedBlockIdx);
-
-				if (ch) {
-					glm::ivec3 bidx = ch->BlockWorldToGridIdx(selectedBlockIdx);
-					if (ch->grid[bidx.x][bidx.y][bidx.z]) {
-						blockDestructionTimer.blockIdx = selectedBlockIdx;
-						blockDestructionTimer.Start();
-					}
-				}
-
-			}
+		{
+			PROFILE_ZONE("input");
+			processInput(window);
 		}
+
+		//--------- SIMULATION
+		if (!simulation->IsThreaded()) simulation->Advance(deltaTime);
+		Simulation::Snapshot state = simulation->View();
+		Camera::MainCamera.position = state.position;
 		if (GUIManager::GetInstance().mouseEvent == 1) {
-			std::cout << selectedBlockIdx.x << "," << selectedBlockIdx.y << "," << selectedBlockIdx.z << '\n';
-			std::cout << selectedFace << std::endl;
+			std::cout << state.selectedBlock.x << "," << state.selectedBlock.y << "," << state.selectedBlock.z << '\n';
+			std::cout << state.selectedFace << std::endl;
 		}
 
 		//--------- RENDER
@@ -203,8 +335,17 @@ int main() {
 		proj = Camera::MainCamera.GetPerspectiveMatrix();
 
 		// world update
-		World::GetInstance().UpdateChunks(Camera::MainCamera.position);
-		World::GetInstance().Build();
+		{
+			std::lock_guard<std::mutex> lock(World::GetInstance().mutex);
+			{
+				PROFILE_ZONE("World::UpdateChunks");
+				World::GetInstance().UpdateChunks(Camera::MainCamera.position, deltaTime);
+			}
+			{
+				PROFILE_ZONE("World::Build");
+				World::GetInstance().Build(simulation->TakeDirtyChunks());
+			}
+		}
 		//world.Render();
 
 		//-------- Render
@@ -212,242 +353,418 @@ int main() {
 		shader.setMat4f("model", glm::value_ptr(model));
 		shader.setMat4f("view", glm::value_ptr(view));
 		shader.setMat4f("proj", glm::value_ptr(proj));
+		shader.setFloat("dayLight", dayLight);
+
+		// every chunk mesh lives in the mesh arena. the queue sorts them by pass, shader and distance,
+		// and draws each run sharing a shader with a single multi draw call.
+		enum DrawState : uint16_t { BASIC, WAVE, CUTOUT };
+		const glm::vec3 camPos = Camera::MainCamera.position;
+		auto chunkDepth = [&camPos](const Chunk& chunk) {
+			return glm::distance(glm::vec3(chunk.basepos) + glm::vec3(Chunk::SZ, Chunk::HEIGHT, Chunk::SZ) * 0.5f, camPos);
+		};
+		Chunk::ivec3 curridx = Chunk::WorldToChunkIndex(camPos);
+
+		// cave culling: only chunks reachable from the camera's chunk through open chunk faces are drawn.
+		{
+			PROFILE_ZONE("cave culling");
+			visibility.Update(World::GetInstance(), camPos, Frustum(proj * view));
+		}
 
-		// 1. Opaque pass
-		for (auto& [cidx, chunk] : World::GetInstance().visChunks) {
-			if (!chunk->solidRenderObj.isBuilt || !chunk->solidRenderObj.isRender) continue;
-			chunk->solidRenderObj.vao.Bind();
-			glDrawElements(GL_TRIANGLES, chunk->solidRenderObj.idxcnt, GL_UNSIGNED_INT, 0);
-		}
-
-		// 2. Water pass
-		waterShader.use();
-		waterShader.setMat4f("model", glm::value_ptr(model));
-		waterShader.setMat4f("view", glm::value_ptr(view));
-		waterShader.setMat4f("proj", glm::value_ptr(proj));
-		Chunk::ivec3 curridx = Chunk::WorldToChunkIndex(Camera::MainCamera.position);
-		for (auto& [cidx, chunk] : World::GetInstance().visChunks) {
-			if (!chunk->waterRenderObj.isBuilt || !chunk->waterRenderObj.isRender) continue;
-			chunk->waterRenderObj.vao.Bind();
-			// water blocks far away from player need not be so detailed
-			// we don't draw them with water shader.
-			auto [ci, cj, ck] = cidx;
-			if (ci - curridx.x > 1 || ci - curridx.x < -1 || cj - curridx.y > 1 || cj - curridx.y < -1 || ck - curridx.z > 1 || ck - curridx.z < -1) {
-				shader.use();
-			}
-			else {
-				waterShader.use();
-				waterShader.setFloat("_Time", currentFrame);
+		// software occlusion culling: the opaque cells of chunks around the camera are rasterized
+		// into a small depth buffer, and chunks completely behind them are not submitted.
+		occlusion.Begin(proj * view);
+		{
+			PROFILE_ZONE("occluder raster");
+			for (auto& [cidx, chunk] : World::GetInstance().visChunks) {
+				auto [ci, cj, ck] = cidx;
+				if (!chunk->isBuilt || std::abs(ci - curridx.x) > OCCLUDER_RADIUS || std::abs(cj - curridx.y) > OCCLUDER_RADIUS || std::abs(ck - curridx.z) > OCCLUDER_RADIUS) continue;
+				chunk->ForEachOccluder([](const glm::vec3& mn, const glm::vec3& mx) { occlusion.AddOccluder(mn, mx); });
 			}
-			glDrawElements(GL_TRIANGLES, chunk->waterRenderObj.idxcnt, GL_UNSIGNED_INT, 0);
 		}
 
-		// 3. Cutout pass
-		cutoutShader.use();
-		cutoutShader.setMat4f("model", glm::value_ptr(model));
-		cutoutShader.setMat4f("view", glm::value_ptr(view));
-		cutoutShader.setMat4f("proj", glm::value_ptr(proj));
-		for (auto& [cidx, chunk] : World::GetInstance().visChunks) {
-			if (!chunk->cutoutRenderObj.isBuilt || !chunk->cutoutRenderObj.isRender) continue;
-			chunk->cutoutRenderObj.vao.Bind();
-			glDrawElements(GL_TRIANGLES, chunk->cutoutRenderObj.idxcnt, GL_UNSIGNED_INT, 0);
+		{
+			PROFILE_ZONE("render queue build");
+			renderQueue.Clear();
+			for (auto& [cidx, chunk] : World::GetInstance().visChunks) {
+				if (!visibility.IsVisible(cidx)) continue;
+				glm::vec3 chunkMin = glm::vec3(chunk->basepos) - 0.5f;
+				if (chunk->isBuilt && !occlusion.TestAABB(chunkMin, chunkMin + glm::vec3(Chunk::SZ, Chunk::HEIGHT, Chunk::SZ))) continue;
+				if (chunk->solidRenderObj.isBuilt && chunk->solidRenderObj.isRender)
+					renderQueue.Push(RenderQueue::OPAQUE, BASIC, chunkDepth(*chunk), chunk->solidRenderObj.alloc);
+				if (chunk->cutoutRenderObj.isBuilt && chunk->cutoutRenderObj.isRender)
+					renderQueue.Push(RenderQueue::CUTOUT, CUTOUT, chunkDepth(*chunk), chunk->cutoutRenderObj.alloc);
+				if (chunk->waterRenderObj.isBuilt && chunk->waterRenderObj.isRender) {
+					// water blocks far away from player need not be so detailed
+					// we don't draw them with water shader.
+					auto [ci, cj, ck] = cidx;
+					bool isNear = std::abs(ci - curridx.x) <= 1 && std::abs(cj - curridx.y) <= 1 && std::abs(ck - curridx.z) <= 1;
+					renderQueue.Push(RenderQueue::TRANSPARENT, isNear ? WAVE : BASIC, chunkDepth(*chunk), chunk->waterRenderObj.alloc);
+				}
+			}
+			occlusion.End();
+			for (auto& [ridx, region] : World::GetInstance().lod.regions) {
+				if (!region.renderObj.isBuilt) continue;
+				glm::vec3 center = (glm::vec3(ridx.first, 0.0f, ridx.second) + 0.5f) * (float)(TerrainLod::REGION_TILES * Chunk::SZ);
+				renderQueue.Push(RenderQueue::OPAQUE, BASIC, glm::distance(glm::vec3(center.x, camPos.y, center.z), camPos), region.renderObj.alloc);
+			}
+			renderQueue.Sort();
 		}
+		static const char* const GPU_PASSES[3] = { "gpu: opaque", "gpu: cutout", "gpu: water" };
+		int gpuPass = -1;
+		renderQueue.Submit(MeshArena::GetInstance(), [&](RenderQueue::Pass pass, uint16_t state) {
+			if (pass != gpuPass) {
+				gpuTimer->Begin(GPU_PASSES[pass]);
+				gpuPass = pass;
+				// water blends over what is behind it, far water first(see RenderQueue::MakeKey).
+				// it still tests depth against the terrain, but doesn't hide the water behind it.
+				if (pass == RenderQueue::TRANSPARENT) {
+					glEnable(GL_BLEND);
+					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+					glDepthMask(GL_FALSE);
+				}
+			}
+			switch (state) {
+			case BASIC:
+				shader.use();
+				break;
+			case WAVE:
+				waterShader.use();
+				waterShader.setMat4f("model", glm::value_ptr(model));
+				waterShader.setMat4f("view", glm::value_ptr(view));
+				waterShader.setMat4f("proj", glm::value_ptr(proj));
+				waterShader.setFloat("_Time", currentFrame);
+				waterShader.setFloat("dayLight", dayLight);
+				break;
+			case CUTOUT:
+				cutoutShader.use();
+				cutoutShader.setMat4f("model", glm::value_ptr(model));
+				cutoutShader.setMat4f("view", glm::value_ptr(view));
+				cutoutShader.setMat4f("proj", glm::value_ptr(proj));
+				cutoutShader.setFloat("dayLight", dayLight);
+				break;
+			}
+		});
+		gpuTimer->End();
+		glDisable(GL_BLEND);
+		glDepthMask(GL_TRUE);
+		MeshArena::GetInstance().EndFrame();
 		
 		//-------- Weather particles
-		weatherShader.use();
-		weatherShader.setMat4f("modelview", glm::value_ptr(view));
-		weatherShader.setFloat("_Time", currentFrame);
-		weatherShader.setMat4f("proj", glm::value_ptr(proj));
-		rainRenderObj.Render();
+		{
+			PROFILE_ZONE("weather");
+			gpuTimer->Begin("gpu: weather");
+			weatherShader.use();
+			weatherShader.setMat4f("modelview", glm::value_ptr(view));
+			weatherShader.setFloat("_Time", currentFrame);
+			weatherShader.setMat4f("proj", glm::value_ptr(proj));
+			rainRenderObj.Render();
+			gpuTimer->End();
+		}
 
 		//-------- UI
-		if (mouseHeld && blockDestructionTimer.running) {
-			circleUI.Render(blockDestructionTimer.GetTime() / BlockDestructionTimer::DURATION, mouseX, mouseY);
-		}
-		
-		for (auto& [idx, window] : GUIManager::GetInstance().windows) {
-			window->Update();
-			window->Render();
+		{
+			PROFILE_ZONE("gui");
+			gpuTimer->Begin("gpu: gui");
+			if (mouseHeld && state.digProgress >= 0.0f) {
+				circleUI.Render(state.digProgress, mouseX, mouseY);
+			}
+
+			for (auto& [idx, window] : GUIManager::GetInstance().windows) {
+				window->Update();
+				window->Render();
+			}
+			gpuTimer->End();
 		}
 		//-------- DEBUG
-		solidColorShader.use();
-		solidColorShader.setMat4f("model", glm::value_ptr(model));
-		solidColorShader.setMat4f("view", glm::value_ptr(view));
-		solidColorShader.setMat4f("proj", glm::value_ptr(proj));
-		glm::vec3 col(0.0f, 1.0f, 0.0f);
-		solidColorShader.setVec3f("col", glm::value_ptr(col));
-		Debug::Render();
-		selectedFaces.Render();
-
-		glfwSwapBuffers(window);
+		{
+			PROFILE_ZONE("debug");
+			gpuTimer->Begin("gpu: debug");
+			solidColorShader.use();
+			solidColorShader.setMat4f("model", glm::value_ptr(model));
+			solidColorShader.setMat4f("view", glm::value_ptr(view));
+			solidColorShader.setMat4f("proj", glm::value_ptr(proj));
+			glm::vec3 col(0.0f, 1.0f, 0.0f);
+			solidColorShader.setVec3f("col", glm::value_ptr(col));
+			Debug::Render();
+			selectedFaces.Render();
+			entityBoxes.Build(state.entityBoxes);
+			entityBoxes.Render();
+			gpuTimer->End();
+		}
+
+		if (headless) {
+			HeadlessGL::GetInstance().EndFrame();
+		}
+		else {
+			PROFILE_ZONE("swap");
+			glfwSwapBuffers(window);
+		}
 		GUIManager::GetInstance().mouseEvent = 0;
-		glfwPollEvents();
+		if (!headless) glfwPollEvents();
+		if (inputMode == InputMode::REPLAY) {
+			// in place of the events glfwPollEvents would have delivered
+			for (const InputTrace::Event& e : inputTrace.frames[inputFrame].events) dispatchEvent(window, e);
+			inputFrame++;
+		}
 
+		auto& streamStats = World::GetInstance().streamer.LastFrameStats();
+		size_t meshBytes = MeshArena::GetInstance().VertexCapacity() * 6 * sizeof(GLfloat) + MeshArena::GetInstance().IndexCapacity() * sizeof(GLuint);
+		runStats.AddFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameBegin).count(),
+			streamStats.generated, streamStats.decorated, streamStats.meshed, streamStats.prefetched, meshBytes);
+		gpuTimer->EndFrame();
+		Profiler::EndFrame();
 	}
-	
+	simulation->Stop();
 
+	if (inputMode != InputMode::REPLAY) {
+		World::GetInstance().SaveEdits(EDITS_SAVE_PATH);
+		simulation->water.Save(WATER_SAVE_PATH);
+	}
+	if (inputMode == InputMode::RECORD) inputTrace.Write(recordPath);
+	RunStats::Summary runSummary = runStats.Summarize();
+	RunStats::Print(cout, runSummary);
+	if (!reportPath.empty()) RunStats::WriteReport(reportPath, runSummary);
+	auto prefetchStats = World::GetInstance().prefetcher.GetStats();
+	auto drawStats = MeshArena::GetInstance().TotalStats();
+	if (drawStats.frames) cout << "chunk passes: " << (float)drawStats.drawCalls / drawStats.frames << " draw calls for " << (float)drawStats.commands / drawStats.frames << " meshes per frame" << endl;
+	auto visibilityStats = visibility.TotalStats();
+	if (visibilityStats.frames) {
+		cout << "cave culling: " << (float)visibilityStats.culled / visibilityStats.frames << " chunks unreachable per frame, "
+			<< visibilityStats.ms / visibilityStats.frames << " ms per frame" << endl;
+	}
+	auto occlusionStats = occlusion.TotalStats();
+	if (occlusionStats.frames) {
+		cout << "occlusion culling: " << (float)occlusionStats.culled / occlusionStats.frames << " of " << (float)occlusionStats.tested / occlusionStats.frames << " chunks culled per frame, "
+			<< (occlusionStats.rasterMs + occlusionStats.testMs) / occlusionStats.frames << " ms per frame (raster " << occlusionStats.rasterMs / occlusionStats.frames << " ms)" << endl;
+	}
+	cout << "simulation: " << simulation->MeanTickMs() << " ms per tick" << endl;
+	const LightEngine::Stats& lightStats = World::GetInstance().light.GetStats();
+	cout << "light: " << lightStats.seeded << " chunks seeded, " << lightStats.updates << " block changes relit, "
+		<< lightStats.cellsVisited << " cells visited" << endl;
+	cout << "prefetch hit rate " << prefetchStats.HitRate() << " (" << prefetchStats.ready << "/" << prefetchStats.needed << " chunks ready when needed)" << endl;
+	if (Profiler::FrameCount()) {
+		cout << "average frame profile over " << Profiler::FrameCount() << " frames:" << endl;
+		Profiler::PrintSummary(cout, Profiler::AverageSummary());
+	}
+	if (gpuTimer->FrameCount()) {
+		cout << "average gpu time over " << gpuTimer->FrameCount() << " frames (" << gpuTimer->DroppedFrames() << " dropped):" << endl;
+		Profiler::PrintSummary(cout, gpuTimer->AverageSummary());
+	}
 	arr_tex.UnBind();
 	//dirt_bottom_tex.Delete();
 	//dirt_side_tex.Delete();
 	//dirt_top_tex.Delete();
 
+	gpuTimer.reset(); //its queries go with the context
+	if (headless) {
+		auto glStats = HeadlessGL::GetInstance().TotalStats();
+		float frames = (float)std::max<size_t>(1, glStats.frames);
+		cout << "headless gl per frame: " << glStats.drawCalls / frames << " draw calls (" << glStats.drawCommands / frames << " draws), "
+			<< glStats.bufferUploads / frames << " buffer uploads of " << glStats.uploadBytes / frames / 1024.0f << " KB, "
+			<< glStats.copyBytes / frames / 1024.0f << " KB copied between buffers, " << glStats.stateChanges / frames << " binds, "
+			<< glStats.calls / frames << " gl calls" << endl;
+		cout << "headless gl: " << HeadlessGL::GetInstance().BufferMemory() / (1024.0f * 1024.0f) << " MB in buffers, " << glStats.errors << " errors" << endl;
+		return glStats.errors ? 1 : 0;
+	}
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return 0;
 }
 
 
-void testRaycast(FacesSelection& selectedFaces) {
-	glm::vec3 dir = Camera::MainCamera.ScreenPointToRay(mouseX, mouseY);
-	Ray ray(Camera::MainCamera.position, dir);
-	//Debug::DrawRay(ray);
-	
-	glm::ivec3 currChunkIdx = Chunk::WorldToChunkIndex(Camera::MainCamera.position);
-	Chunk* currChunk = World::GetInstance().GetChunkByIndex(currChunkIdx);
-	if (!currChunk) return;
-
-	glm::ivec3 idx = currChunk->FindBlockIndex(Camera::MainCamera.position);
-	//integer voxel indices
-	int ix = idx.x, iy = idx.y, iz = idx.z;
-
-	//'step'
-	int xDir = (ray.dir.x > 0) ? 1 : (ray.dir.x == 0) ? 0 : -1;
-	int yDir = (ray.dir.y > 0) ? 1 : (ray.dir.y == 0) ? 0 : -1;
-	int zDir = (ray.dir.z > 0) ? 1 : (ray.dir.z == 0) ? 0 : -1;
-
-	//'bound'
-	float xBound = ((ray.dir.x >= 0) ? ix + 1 : ix);
-	float yBound = ((ray.dir.y >= 0) ? iy + 1 : iy);
-	float zBound = ((ray.dir.z >= 0) ? iz + 1 : iz);
-
-	//'current t'
-	glm::vec3 initPos = Camera::MainCamera.position; 
-	initPos -= (currChunk->basepos); 
-	initPos += 0.5f;
-
-	float xt = (xBound - initPos.x) * ray.invDir.x;
-	float yt = (yBound - initPos.y) * ray.invDir.y;
-	float zt = (zBound - initPos.z) * ray.invDir.z;
-
-	//'delta t'
-	float xDelta = xDir * ray.invDir.x;
-	float yDelta = yDir * ray.invDir.y;
-	float zDelta = zDir * ray.invDir.z;
-
-	int xface = ((ray.dir.x >= 0) ? Block::Face::LEFT : Block::Face::RIGHT);
-	int yface = ((ray.dir.y >= 0) ? Block::Face::BOTTOM : Block::Face::TOP);
-	int zface = ((ray.dir.z >= 0) ? Block::Face::BACK : Block::Face::FRONT);
-	int face = -1, ii = 0, found = 0;
-
-	selectedBlockExists = false;
-
-	for (int cnt = 0; cnt < 20; ++cnt) {
-		if (xt < yt && xt < zt) {
-			ii = ix + xDir;
-			if (ii < 0 || ii >= Chunk::SZ) {
-				currChunkIdx.x += xDir;
-				currChunk = World::GetInstance().GetChunkByIndex(currChunkIdx);
-				if (!currChunk) break;
-				ii = ix = (ii < 0 ? Chunk::SZ - 1 : 0);
-			}
-			face = xface, ix = ii, xt += xDelta;
-		}
-		else if (yt < zt) {
-			ii = iy + yDir;
-			if (ii < 0 || ii >= Chunk::HEIGHT) {
-				currChunkIdx.y += yDir;
-				currChunk = World::GetInstance().GetChunkByIndex(currChunkIdx);
-				if (!currChunk) break;
-				ii = iy = (ii < 0 ? Chunk::HEIGHT - 1 : 0);
-			}
-			face = yface, iy = ii, yt += yDelta;
-		}
-		else {
-			ii = iz + zDir;
-			if (ii < 0 || ii >= Chunk::SZ) {
-				currChunkIdx.z += zDir;
-				currChunk = World::GetInstance().GetChunkByIndex(currChunkIdx);
-				if (!currChunk) break;
-				ii = iz = (ii < 0 ? Chunk::SZ-1 : 0);
-			}
-			face = zface, iz = ii, zt += zDelta;
-		}
+void benchmarkRaycast() {
+	VoxelRaycaster raycaster(World::GetInstance());
+	std::mt19937 rng(1);
+	std::normal_distribution<float> gaussian;
+	std::vector<Ray> rays(RAYCAST_BENCH_RAYS);
+	for (Ray& ray : rays) ray = Ray(Camera::MainCamera.position, { gaussian(rng), gaussian(rng), gaussian(rng) }); //uniform directions
+	std::vector<VoxelRaycaster::Hit> hits(rays.size());
 
-		if (currChunk->grid[ix][iy][iz] != BlockDB::BlockType::BLOCK_AIR) {
-			glm::ivec3 idx = currChunk->BlockGridToWorldIdx(glm::ivec3{ix, iy, iz});
-			
-			//if (selectedBlockIdx != idx) {
-			//	glm::ivec3 bidx = currChunk->grid[ix][iy][iz]->pos;
-			//}
+	auto begin = std::chrono::steady_clock::now();
+	size_t singleHits = 0;
+	for (size_t n = 0; n < rays.size(); ++n) {
+		hits[n] = raycaster.Cast(rays[n], RAYCAST_BENCH_DISTANCE);
+		singleHits += hits[n].hit;
+	}
+	double singleSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
 
-			selectedBlockIdx = idx;
-			selectedFace = face;
-			selectedBlockExists = true;
-			//selectedFaces.AddFace(currChunk->grid[ix][iy][iz], face);
+	begin = std::chrono::steady_clock::now();
+	size_t batchHits = raycaster.CastBatch(rays, RAYCAST_BENCH_DISTANCE, hits);
+	double batchSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
 
-			break;
-		}
+	cout << "raycast benchmark: " << rays.size() << " rays of up to " << RAYCAST_BENCH_DISTANCE << " blocks, " << 100.0 * batchHits / rays.size() << "% hit" << endl;
+	cout << "single: " << rays.size() / singleSec * 1e-6 << " Mrays/s" << endl;
+	cout << "batched: " << rays.size() / batchSec * 1e-6 << " Mrays/s on " << raycaster.threads << " threads" << endl;
+	if (singleHits != batchHits) cout << "ERROR::RAYCAST::BATCH_MISMATCH: " << singleHits << " vs " << batchHits << " hits" << endl;
+}
+
+void benchmarkEntities() {
+	// a cloud of items falling on the spawn area, spread over the chunks around the camera
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> spread(-40.0f, 40.0f), height(0.0f, 30.0f), speed(-2.0f, 2.0f);
+	glm::vec3 center = Camera::MainCamera.position;
+	EntityStore& entities = simulation->entities;
+	entities.Clear();
+	for (size_t n = 0; n < ENTITY_BENCH_COUNT; ++n) {
+		glm::vec3 pos = center + glm::vec3(spread(rng), height(rng), spread(rng));
+		entities.Spawn(EntityStore::ITEM, pos, { speed(rng), 0.0f, speed(rng) }, Simulation::ITEM_SIZE, BlockDB::BlockType::BLOCK_DIRT);
 	}
 
-	if (face == -1) {
-		selectedFace = -1;
-		selectedBlockExists = false;
+	double totalMs = 0.0, maxMs = 0.0;
+	for (size_t n = 0; n < ENTITY_BENCH_STEPS; ++n) {
+		entities.Step(World::GetInstance(), FIXED_TIME_STEP);
+		totalMs += entities.LastStepStats().ms;
+		maxMs = std::max(maxMs, entities.LastStepStats().ms);
 	}
-	
-	selectedFaces.Build();
+	size_t grounded = std::count(entities.onGround.begin(), entities.onGround.end(), 1);
+	const EntityStore::Stats& last = entities.LastStepStats();
+	cout << "entity benchmark: " << ENTITY_BENCH_COUNT << " entities, " << ENTITY_BENCH_STEPS << " steps, mean " << totalMs / ENTITY_BENCH_STEPS
+		<< " ms, max " << maxMs << " ms per step on " << entities.threads << " threads" << endl;
+	cout << "after the last step: " << grounded << " on the ground, " << last.frozen << " frozen, " << last.chunks << " chunks, "
+		<< last.pairs << " broadphase pairs, " << last.contacts << " contacts" << endl;
+	entities.Clear();
 }
 
-glm::vec3 updatePositionWithCollisionCheck(glm::vec3 begin_pos, glm::vec3 end_pos, glm::vec3 box_dims) {
-	//using namespace Collision;
-	Collision::CollisionCheck checker(begin_pos, end_pos, box_dims);
-	Collision::AABB swAABB = checker.ComputeBroadphaseAABB(); //get swept AABB
-
-	std::vector<Collision::AABB> colliders;
-	int endx = (int)(swAABB.start.x + swAABB.scale.x + 0.5f);
-	int endy = (int)(swAABB.start.y + swAABB.scale.y + 0.5f);
-	int endz = (int)(swAABB.start.z + swAABB.scale.z + 0.5f);
-	for (int x = (int)(swAABB.start.x-0.5f); x <= endx; ++x) {
-		for (int y = (int)(swAABB.start.y-0.5f); y <= endy; ++y) {
-			for (int z = (int)(swAABB.start.z-0.5f); z <= endz; ++z) {
-				Chunk* chunk = World::GetInstance().CurrentChunk({ x, y, z });
-				Chunk::ivec3 blockidx = chunk->FindBlockIndex({ x, y, z });
-				if (chunk->grid[blockidx.x][blockidx.y][blockidx.z] != BlockDB::BlockType::BLOCK_AIR) {
-					colliders.push_back({ {x-0.5f, y-0.5f, z-0.5f}, {1.0f, 1.0f, 1.0f}, chunk->grid[blockidx.x][blockidx.y][blockidx.z] });
+void benchmarkBroadphase() {
+	// bodies of up to a block flying around a box, bouncing off its walls. the box grows with the count, so the density stays the same.
+	for (size_t cnt : BROADPHASE_BENCH_COUNTS) {
+		std::mt19937 rng(1);
+		float side = std::cbrt(cnt * BROADPHASE_BENCH_VOLUME);
+		std::uniform_real_distribution<float> place(0.0f, side), extent(0.25f, 1.0f), speed(-4.0f, 4.0f);
+		std::vector<glm::vec3> pos(cnt), vel(cnt), size(cnt), begin(cnt);
+		SpatialHash hash;
+		for (size_t n = 0; n < cnt; ++n) {
+			pos[n] = { place(rng), place(rng), place(rng) };
+			vel[n] = { speed(rng), speed(rng), speed(rng) };
+			size[n] = glm::vec3(extent(rng));
+			hash.Insert((SpatialHash::Id)n, pos[n], size[n]);
+		}
+		hash.TakeRehashCount();
+
+		std::vector<SpatialHash::Pair> pairs;
+		double updateMs = 0.0, pairMs = 0.0, narrowMs = 0.0;
+		size_t pairCnt = 0, contactCnt = 0;
+		for (size_t step = 0; step < BROADPHASE_BENCH_STEPS; ++step) {
+			for (size_t n = 0; n < cnt; ++n) {
+				begin[n] = pos[n];
+				pos[n] += vel[n] * FIXED_TIME_STEP;
+				for (int a = 0; a < 3; ++a) {
+					if (pos[n][a] < 0.0f || pos[n][a] > side) vel[n][a] = -vel[n][a];
 				}
 			}
+
+			auto t0 = std::chrono::steady_clock::now();
+			for (size_t n = 0; n < cnt; ++n) {
+				glm::vec3 mn = glm::min(begin[n], pos[n]);
+				hash.Update((SpatialHash::Id)n, mn, glm::max(begin[n], pos[n]) - mn + size[n]);
+			}
+			auto t1 = std::chrono::steady_clock::now();
+			hash.CandidatePairs(pairs);
+			auto t2 = std::chrono::steady_clock::now();
+			for (const SpatialHash::Pair& p : pairs) {
+				size_t a = p.first, b = p.second;
+				contactCnt += Collision::SweepPair(begin[a], pos[a], size[a], begin[b], pos[b], size[b]).time >= 0.0f;
+			}
+			auto t3 = std::chrono::steady_clock::now();
+
+			updateMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			pairMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+			narrowMs += std::chrono::duration<double, std::milli>(t3 - t2).count();
+			pairCnt += pairs.size();
+		}
+		cout << "broadphase benchmark: " << cnt << " bodies, " << hash.CellCount() << " cells, "
+			<< 100.0 * hash.TakeRehashCount() / (cnt * BROADPHASE_BENCH_STEPS) << "% of updates moved cells" << endl;
+		cout << "per step: update " << updateMs / BROADPHASE_BENCH_STEPS << " ms, pairs " << pairMs / BROADPHASE_BENCH_STEPS
+			<< " ms, narrowphase " << narrowMs / BROADPHASE_BENCH_STEPS << " ms, " << pairCnt / BROADPHASE_BENCH_STEPS << " pairs, "
+			<< (double)contactCnt / BROADPHASE_BENCH_STEPS << " contacts" << endl;
+
+		// the smallest run checks the pairs of the last step against testing every pair
+		if (cnt > BROADPHASE_BENCH_COUNTS[0]) continue;
+		auto t0 = std::chrono::steady_clock::now();
+		size_t bruteCnt = 0;
+		for (size_t a = 0; a < cnt; ++a) {
+			glm::vec3 amn = glm::min(begin[a], pos[a]), amx = glm::max(begin[a], pos[a]) + size[a];
+			for (size_t b = a + 1; b < cnt; ++b) {
+				glm::vec3 bmn = glm::min(begin[b], pos[b]), bmx = glm::max(begin[b], pos[b]) + size[b];
+				bruteCnt += glm::all(glm::lessThan(amn, bmx)) && glm::all(glm::lessThan(bmn, amx));
+			}
 		}
+		cout << "every pair: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms" << endl;
+		if (bruteCnt != pairs.size()) cout << "ERROR::BROADPHASE::PAIR_MISMATCH: " << pairs.size() << " vs " << bruteCnt << " pairs" << endl;
 	}
-	Collision::Collision col = checker.GetFirstHit(colliders);
-	checker = Collision::CollisionCheck(col.stop_pos, col.stop_pos + col.remain_vel, box_dims);
-	Collision::Collision col2 = checker.GetFirstHit(colliders);
-	checker = Collision::CollisionCheck(col2.stop_pos, col2.stop_pos + col2.remain_vel, box_dims);
-	Collision::Collision col3 = checker.GetFirstHit(colliders);
+}
 
-	return col3.stop_pos + col3.remain_vel;
+void applyViewDistance() {
+	{
+		std::lock_guard<std::mutex> lock(World::GetInstance().mutex);
+		World::GetInstance().SetViewDistance(viewRadius, viewHeightRadius);
+	}
+	// the far plane must reach the corners of the distant terrain ring, or it gets clipped.
+	float reach = (TerrainLod::RadiusFor(viewRadius) + 1) * Chunk::SZ * 1.5f;
+	Camera::MainCamera.SetFarPlane(std::max(200.0f, reach));
 }
 
 void processInput(GLFWwindow* window)
 {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	if (getKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS && window)
 		glfwSetWindowShouldClose(window, true);
 
-	// TODO : make camera movable (WASD) & increase or decrease dayFactor(press O: increase, press P: decrease)
-	const float cameraSpeed = 0.05f;
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-		Camera::MainCamera.ProcessKeyboard(FORWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-		Camera::MainCamera.ProcessKeyboard(BACKWARD, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-		Camera::MainCamera.ProcessKeyboard(LEFT, deltaTime);
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-		Camera::MainCamera.ProcessKeyboard(RIGHT, deltaTime);
+	// movement(WASD), looking and digging go to the simulation, which applies them on its next tick
+	Simulation::Input in;
+	in.forward = getKey(window, GLFW_KEY_W) == GLFW_PRESS;
+	in.backward = getKey(window, GLFW_KEY_S) == GLFW_PRESS;
+	in.left = getKey(window, GLFW_KEY_A) == GLFW_PRESS;
+	in.right = getKey(window, GLFW_KEY_D) == GLFW_PRESS;
+	in.yaw = Camera::MainCamera.yaw;
+	in.pitch = Camera::MainCamera.pitch;
+	in.pickDir = Camera::MainCamera.ScreenPointToRay(mouseX, mouseY);
+	in.mouseHeld = mouseHeld;
+	simulation->SetInput(in);
 
 	//DEBUG MODE INPUT
-	if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) {
+	if (getKey(window, GLFW_KEY_1) == GLFW_PRESS) {
 		cout << Camera::MainCamera.position.r << ", " << Camera::MainCamera.position.g << ", " << Camera::MainCamera.position.b << "\n";
 	}
-	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) isKeyboardProcessed[GLFW_KEY_X] = true;
-	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE && isKeyboardProcessed[GLFW_KEY_X]) {
+	// view distance
+	const int viewKeys[4] = { GLFW_KEY_EQUAL, GLFW_KEY_MINUS, GLFW_KEY_RIGHT_BRACKET, GLFW_KEY_LEFT_BRACKET };
+	for (int key : viewKeys) {
+		if (getKey(window, key) == GLFW_PRESS) isKeyboardProcessed[key] = true;
+		if (getKey(window, key) == GLFW_RELEASE && isKeyboardProcessed[key]) {
+			isKeyboardProcessed[key] = false;
+			if (key == GLFW_KEY_EQUAL) viewRadius++;
+			if (key == GLFW_KEY_MINUS) viewRadius = std::max(1, viewRadius - 1);
+			if (key == GLFW_KEY_RIGHT_BRACKET) viewHeightRadius++;
+			if (key == GLFW_KEY_LEFT_BRACKET) viewHeightRadius = std::max(1, viewHeightRadius - 1);
+			applyViewDistance();
+			cout << "view distance " << viewRadius << " chunks, height " << viewHeightRadius << " chunks" << endl;
+		}
+	}
+	// time of day
+	const int dayKeys[2] = { GLFW_KEY_O, GLFW_KEY_P };
+	for (int key : dayKeys) {
+		if (getKey(window, key) == GLFW_PRESS) isKeyboardProcessed[key] = true;
+		if (getKey(window, key) == GLFW_RELEASE && isKeyboardProcessed[key]) {
+			isKeyboardProcessed[key] = false;
+			dayLight = glm::clamp(dayLight + (key == GLFW_KEY_P ? DAY_LIGHT_STEP : -DAY_LIGHT_STEP), 0.0f, 1.0f);
+			cout << "day light " << dayLight << endl;
+		}
+	}
+
+	// profiler: F3 prints the last frame's cpu zones and gpu passes, F4 writes a chrome trace
+	if (getKey(window, GLFW_KEY_F3) == GLFW_PRESS) isKeyboardProcessed[GLFW_KEY_F3] = true;
+	if (getKey(window, GLFW_KEY_F3) == GLFW_RELEASE && isKeyboardProcessed[GLFW_KEY_F3]) {
+		isKeyboardProcessed[GLFW_KEY_F3] = false;
+		Profiler::PrintSummary(cout, Profiler::LastFrameSummary());
+		Profiler::PrintSummary(cout, gpuTimer->LastFrameSummary());
+	}
+	if (getKey(window, GLFW_KEY_F4) == GLFW_PRESS) isKeyboardProcessed[GLFW_KEY_F4] = true;
+	if (getKey(window, GLFW_KEY_F4) == GLFW_RELEASE && isKeyboardProcessed[GLFW_KEY_F4]) {
+		isKeyboardProcessed[GLFW_KEY_F4] = false;
+		Profiler::WriteChromeTrace(PROFILE_TRACE_PATH);
+	}
+
+	if (getKey(window, GLFW_KEY_X) == GLFW_PRESS) isKeyboardProcessed[GLFW_KEY_X] = true;
+	if (getKey(window, GLFW_KEY_X) == GLFW_RELEASE && isKeyboardProcessed[GLFW_KEY_X]) {
 		isKeyboardProcessed[GLFW_KEY_X] = false;
 		if (GUIManager::GetInstance().windows.count("inventory")) {
 			auto inven = GUIManager::GetInstance().windows["inventory"];
@@ -502,6 +819,35 @@ void processInput(GLFWwindow* window)
 	}
 }
 
+// glfwGetKey, recorded or replayed
+int getKey(GLFWwindow* window, int key) {
+	if (inputMode == InputMode::REPLAY) return inputTrace.IsKeyDown(inputFrame, key) ? GLFW_PRESS : GLFW_RELEASE;
+	int state = glfwGetKey(window, key);
+	if (inputMode == InputMode::RECORD && state == GLFW_PRESS) inputTrace.RecordKey(key);
+	return state;
+}
+
+// window events pass through here first. returns false if the event must be ignored, which is while a trace replays.
+bool captureEvent(const InputTrace::Event& e) {
+	if (inputMode == InputMode::REPLAY) return false;
+	if (inputMode == InputMode::RECORD && !inputTrace.empty()) inputTrace.RecordEvent(e);
+	return true;
+}
+
+void dispatchEvent(GLFWwindow* window, const InputTrace::Event& e) {
+	switch (e.type) {
+	case InputTrace::Event::CURSOR:
+		mouse_callback(window, e.x, e.y);
+		break;
+	case InputTrace::Event::BUTTON:
+		mouse_button_callback(window, e.button, e.action, e.mods);
+		break;
+	case InputTrace::Event::SCROLL:
+		scroll_callback(window, e.x, e.y);
+		break;
+	}
+}
+
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 {
 	mouseX = xpos;
@@ -519,23 +865,15 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-	static double mouseLastX, mouseLastY;
 	if (button == GLFW_MOUSE_BUTTON_LEFT) {
 		if (!mouseHeld) { //pressed
 			cout << "0\n";
 			mouseHeld = true;
-			glfwGetCursorPos(window, &mouseLastX, &mouseLastY);
-
-			if (selectedBlockExists) {
-				blockDestructionTimer.blockIdx = selectedBlockIdx;
-				blockDestructionTimer.Start();
-			}
 			GUIManager::GetInstance().mouseEvent = 1;
 		}
 		else { //released
 			GUIManager::GetInstance().mouseEvent = 2;
 			mouseHeld = false;
-			blockDestructionTimer.Stop();
 		}
 	}
 	else { //held
@@ -548,4 +886,161 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
 	Camera::MainCamera.ProcessMouseScroll(yoffset);
-}
\ No newline at end of file
+}
+
+void benchmarkWater() {
+	// sources placed on the ground around the spawn area flow until they settle. the flow only visits cells next to
+	// water that changed, so its cost follows the water, and ticks with nothing scheduled cost the same however many chunks are loaded.
+	World& world = World::GetInstance();
+	WaterFlow& water = simulation->water;
+	water.Clear();
+	std::vector<glm::ivec3> ground = groundAroundSpawn(3);
+
+	uint64_t tick = 0;
+	size_t used = 0;
+	for (size_t cnt : WATER_BENCH_SOURCES) {
+		if (used + cnt > ground.size()) break;
+		for (size_t n = 0; n < cnt; ++n, ++used) {
+			Chunk* ch = world.GetChunkContainingBlock(ground[used]);
+			ch->PlaceBlockAt(ch->BlockWorldToGridIdx(ground[used]), BlockDB::BlockType::BLOCK_WATER);
+			water.BlockChanged(ground[used], tick);
+		}
+		size_t ticks = 0, updates = 0, changed = 0, remeshes = 0;
+		double totalMs = 0.0, maxMs = 0.0;
+		for (; ticks < WATER_BENCH_MAX_TICKS && water.Pending(); ++ticks) {
+			water.Step(++tick);
+			const WaterFlow::Stats& step = water.LastStepStats();
+			updates += step.updates;
+			changed += step.changed;
+			totalMs += step.ms;
+			maxMs = std::max(maxMs, step.ms);
+			remeshes += water.TakeChangedChunks().size();
+		}
+		cout << "water benchmark: " << cnt << " sources settled after " << ticks << " ticks, " << updates << " updates(" << changed << " changed), "
+			<< remeshes << " chunk remeshes" << endl;
+		cout << "per tick: mean " << (ticks ? totalMs / ticks : 0.0) << " ms, max " << maxMs << " ms, " << (updates ? 1000.0 * totalMs / updates : 0.0) << " us per update" << endl;
+	}
+
+	double idleMs = 0.0;
+	for (size_t n = 0; n < WATER_BENCH_IDLE_TICKS; ++n) {
+		water.Step(++tick);
+		idleMs += water.LastStepStats().ms;
+	}
+	cout << "with nothing scheduled: " << idleMs / WATER_BENCH_IDLE_TICKS << " ms per tick, " << world.allChunks.size() << " chunks loaded" << endl;
+}
+
+void benchmarkEdits() {
+	// a crater is a ball of air. blasted block by block, every edit remeshes the chunks it touched, the way edits made one
+	// per tick would be. blasted as one batch(Simulation::SetBlocks), each chunk it touches is remeshed once.
+	World& world = World::GetInstance();
+	std::vector<glm::ivec3> ground = groundAroundSpawn(2 * EDIT_BENCH_RADIUS + 1);
+	size_t remeshes = 0;
+	auto remesh = [&world, &remeshes]() {
+		for (const glm::ivec3& cidx : simulation->TakeDirtyChunks()) {
+			Chunk* chunk = world.visChunks.Find(cidx);
+			if (chunk && chunk->isBuilt && chunk->requiresRebuild) chunk->ReBuild(), remeshes++;
+		}
+		for (const glm::ivec3& cidx : world.light.TakeRelit()) {
+			Chunk* chunk = world.visChunks.Find(cidx);
+			if (chunk && chunk->isBuilt && chunk->requiresRebuild) chunk->ReBuild(), remeshes++;
+		}
+	};
+	remesh(); //whatever settling the spawn left behind
+
+	std::vector<BlockEdit> edits;
+	for (int batched = 0; batched < 2; ++batched) {
+		size_t craters = 0, blocks = 0;
+		remeshes = 0;
+		auto begin = std::chrono::steady_clock::now();
+		for (int n = batched; n < EDIT_BENCH_CRATERS && n < (int)ground.size(); n += 2, ++craters) {
+			edits.clear();
+			const int r = EDIT_BENCH_RADIUS;
+			for (int x = -r; x <= r; ++x) {
+				for (int y = -r; y <= r; ++y) {
+					for (int z = -r; z <= r; ++z) {
+						if (x * x + y * y + z * z <= r * r) edits.push_back({ ground[n] + glm::ivec3(x, y, z), BlockDB::BlockType::BLOCK_AIR });
+					}
+				}
+			}
+			blocks += edits.size();
+			if (batched) {
+				simulation->SetBlocks(edits);
+				remesh();
+				continue;
+			}
+			for (const BlockEdit& edit : edits) {
+				simulation->SetBlock(edit.block, edit.type);
+				remesh();
+			}
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+		cout << "edit benchmark, " << (batched ? "batched" : "block by block") << ": " << craters << " craters of radius " << EDIT_BENCH_RADIUS << ", "
+			<< blocks << " blocks, " << remeshes << " chunk remeshes, " << (craters ? ms / craters : 0.0) << " ms per crater" << endl;
+	}
+}
+
+std::vector<glm::ivec3> groundAroundSpawn(int spacing) {
+	// the air above the highest block of every spacing-th column of the view window, if that block is solid, shuffled
+	World& world = World::GetInstance();
+	int reach = viewRadius * Chunk::SZ - Chunk::SZ / 2;
+	int top = (world.centerChunkIdx.y + viewHeightRadius + 1) * Chunk::HEIGHT - 2, bottom = (world.centerChunkIdx.y - viewHeightRadius) * Chunk::HEIGHT;
+	std::vector<glm::ivec3> ground;
+	for (int x = -reach; x <= reach; x += spacing) {
+		for (int z = -reach; z <= reach; z += spacing) {
+			for (int y = top; y >= bottom; --y) {
+				Chunk* ch = world.GetChunkContainingBlock({ x, y, z });
+				if (!ch) break;
+				glm::ivec3 bidx = ch->BlockWorldToGridIdx({ x, y, z });
+				BlockDB::BlockType type = ch->grid[bidx.x][bidx.y][bidx.z];
+				if (type == BlockDB::BlockType::BLOCK_AIR) continue;
+				if (ch->IsSolid(bidx)) ground.push_back({ x, y + 1, z });
+				break;
+			}
+		}
+	}
+	std::shuffle(ground.begin(), ground.end(), std::mt19937(1));
+	return ground;
+}
+
+void benchmarkChunkIndex() {
+	// lookups of the blocks around the loaded chunks, in random order like the raycasts and the entities make them.
+	// the box reaches a chunk past the loaded ones on every side, so some of the lookups miss.
+	World& world = World::GetInstance();
+	std::map<ChunkIndex::p3i, Chunk*> tree;
+	ChunkIndex::ChunkHashMap hashMap;
+	glm::ivec3 lo(std::numeric_limits<int>::max()), hi(std::numeric_limits<int>::min());
+	for (auto& [idx, chunk] : world.allChunks) {
+		tree[idx] = chunk;
+		hashMap.Insert(idx, chunk);
+		glm::ivec3 cidx(std::get<0>(idx), std::get<1>(idx), std::get<2>(idx));
+		lo = glm::min(lo, cidx), hi = glm::max(hi, cidx);
+	}
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> bx((lo.x - 1) * Chunk::SZ, (hi.x + 2) * Chunk::SZ - 1);
+	std::uniform_int_distribution<int> by((lo.y - 1) * Chunk::HEIGHT, (hi.y + 2) * Chunk::HEIGHT - 1);
+	std::uniform_int_distribution<int> bz((lo.z - 1) * Chunk::SZ, (hi.z + 2) * Chunk::SZ - 1);
+	std::vector<glm::ivec3> lookups(CHUNKINDEX_BENCH_LOOKUPS);
+	for (glm::ivec3& idx : lookups) idx = Chunk::BlockToChunkIndex({ bx(rng), by(rng), bz(rng) });
+
+	auto measure = [&](auto&& find, size_t& found) {
+		found = 0;
+		auto begin = std::chrono::steady_clock::now();
+		for (const glm::ivec3& idx : lookups) found += find(idx) != nullptr;
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	};
+	size_t treeFound, hashFound, windowFound;
+	double treeSec = measure([&](const glm::ivec3& idx) -> Chunk* {
+		auto it = tree.find({ idx.x, idx.y, idx.z });
+		return it == tree.end() ? nullptr : it->second;
+	}, treeFound);
+	double hashSec = measure([&](const glm::ivec3& idx) { return hashMap.Find(idx); }, hashFound);
+	double windowSec = measure([&](const glm::ivec3& idx) { return world.visChunks.Find(idx); }, windowFound);
+
+	cout << "chunk index benchmark: " << lookups.size() << " lookups over " << tree.size() << " chunks, "
+		<< 100.0 * treeFound / lookups.size() << "% found" << endl;
+	cout << "std::map: " << lookups.size() / treeSec * 1e-6 << " Mlookups/s" << endl;
+	cout << "ChunkHashMap: " << lookups.size() / hashSec * 1e-6 << " Mlookups/s" << endl;
+	cout << "ChunkWindow: " << lookups.size() / windowSec * 1e-6 << " Mlookups/s, " << world.visChunks.size() << " visible chunks, "
+		<< 100.0 * windowFound / lookups.size() << "% found" << endl;
+	if (treeFound != hashFound) cout << "ERROR::CHUNKINDEX::LOOKUP_MISMATCH: " << treeFound << " vs " << hashFound << " found" << endl;
+}
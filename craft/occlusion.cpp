@@ -0,0 +1,178 @@
+#include "occlusion.h"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define OCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+static constexpr float FAR_DEPTH = std::numeric_limits<float>::infinity();
+
+// corner n of a box takes x from mx if bit 0 is set, y if bit 1, z if bit 2.
+static const int BOX_FACES[6][4] = {
+	{ 0, 2, 6, 4 }, { 1, 5, 7, 3 }, //-x, +x
+	{ 0, 4, 5, 1 }, { 2, 3, 7, 6 }, //-y, +y
+	{ 0, 1, 3, 2 }, { 4, 6, 7, 5 }, //-z, +z
+};
+
+static inline glm::vec3 boxCorner(const glm::vec3& mn, const glm::vec3& mx, int n) {
+	return { (n & 1) ? mx.x : mn.x, (n & 2) ? mx.y : mn.y, (n & 4) ? mx.z : mn.z };
+}
+
+static inline double msSince(std::chrono::steady_clock::time_point begin) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+OcclusionBuffer::OcclusionBuffer() : depth(WIDTH * HEIGHT, FAR_DEPTH) {
+}
+
+void OcclusionBuffer::Begin(const glm::mat4& vp) {
+	phaseBegin = std::chrono::steady_clock::now();
+	testing = false;
+	viewProj = vp;
+	std::fill(depth.begin(), depth.end(), FAR_DEPTH);
+	current = Stats();
+}
+
+void OcclusionBuffer::End() {
+	(testing ? current.testMs : current.rasterMs) = msSince(phaseBegin);
+	current.frames = 1;
+	lastFrame = current;
+	total.frames++;
+	total.occluders += current.occluders;
+	total.triangles += current.triangles;
+	total.tested += current.tested;
+	total.culled += current.culled;
+	total.rasterMs += current.rasterMs;
+	total.testMs += current.testMs;
+}
+
+bool OcclusionBuffer::project(const glm::vec3& p, glm::vec3& out) const {
+	glm::vec4 clip = viewProj * glm::vec4(p, 1.0f);
+	if (clip.w < nearPlane) return false;
+	out.x = (clip.x / clip.w * 0.5f + 0.5f) * WIDTH;
+	out.y = (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT;
+	out.z = clip.w;
+	return true;
+}
+
+void OcclusionBuffer::AddOccluder(const glm::vec3& mn, const glm::vec3& mx) {
+	glm::vec3 screen[8];
+	for (int n = 0; n < 8; ++n) {
+		// clipping occluders is not worth it, dropping one only means less is culled
+		if (!project(boxCorner(mn, mx, n), screen[n])) return;
+	}
+	for (const int* f : BOX_FACES) {
+		rasterizeTriangle(screen[f[0]], screen[f[1]], screen[f[2]]);
+		rasterizeTriangle(screen[f[0]], screen[f[2]], screen[f[3]]);
+	}
+	current.occluders++;
+}
+
+void OcclusionBuffer::rasterizeTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	// both windings are drawn, a box's back faces are farther than its front faces anyway.
+	glm::vec3 v[3] = { a, b, c };
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+	if (area == 0.0f) return;
+	if (area < 0.0f) std::swap(v[1], v[2]);
+
+	int x0 = std::max(0, (int)std::floor(std::min({ v[0].x, v[1].x, v[2].x })));
+	int x1 = std::min(WIDTH - 1, (int)std::ceil(std::max({ v[0].x, v[1].x, v[2].x })));
+	int y0 = std::max(0, (int)std::floor(std::min({ v[0].y, v[1].y, v[2].y })));
+	int y1 = std::min(HEIGHT - 1, (int)std::ceil(std::max({ v[0].y, v[1].y, v[2].y })));
+	if (x0 > x1 || y0 > y1) return;
+	current.triangles++;
+
+	// the whole triangle takes its farthest depth, so it never occludes more than the real surface
+	const float w = std::max({ v[0].z, v[1].z, v[2].z });
+
+	// edge functions E(x, y) = A x + B y + C, non negative inside the counter clockwise triangle
+	float A[3], B[3], C[3];
+	for (int e = 0; e < 3; ++e) {
+		const glm::vec3& p = v[e];
+		const glm::vec3& q = v[(e + 1) % 3];
+		A[e] = p.y - q.y;
+		B[e] = q.x - p.x;
+		C[e] = -(A[e] * p.x + B[e] * p.y);
+	}
+
+	x0 &= ~3; //rows start on a multiple of 4, lanes past x1 fail the edge test
+	for (int y = y0; y <= y1; ++y) {
+		float py = y + 0.5f;
+		float* row = depth.data() + y * WIDTH;
+#ifdef OCCLUSION_SSE
+		const __m128 laneX = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		const __m128 zero = _mm_setzero_ps(), wv = _mm_set1_ps(w);
+		__m128 rowE[3], stepA[3];
+		for (int e = 0; e < 3; ++e) {
+			rowE[e] = _mm_set1_ps(B[e] * py + C[e]);
+			stepA[e] = _mm_set1_ps(A[e]);
+		}
+		for (int x = x0; x <= x1; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneX);
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepA[0], px), rowE[0]), zero);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepA[1], px), rowE[1]), zero));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepA[2], px), rowE[2]), zero));
+			__m128 old = _mm_loadu_ps(row + x);
+			__m128 nearer = _mm_min_ps(old, wv);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+		}
+#else
+		for (int x = x0; x <= x1; ++x) {
+			float px = x + 0.5f;
+			bool inside = A[0] * px + B[0] * py + C[0] >= 0.0f
+				&& A[1] * px + B[1] * py + C[1] >= 0.0f
+				&& A[2] * px + B[2] * py + C[2] >= 0.0f;
+			if (inside) row[x] = std::min(row[x], w);
+		}
+#endif
+	}
+}
+
+bool OcclusionBuffer::TestAABB(const glm::vec3& mn, const glm::vec3& mx) {
+	if (!testing) {
+		current.rasterMs = msSince(phaseBegin);
+		phaseBegin = std::chrono::steady_clock::now();
+		testing = true;
+	}
+	current.tested++;
+	auto result = [&](bool visible) {
+		if (!visible) current.culled++;
+		return visible;
+	};
+
+	glm::vec3 lo(FAR_DEPTH), hi(-FAR_DEPTH);
+	for (int n = 0; n < 8; ++n) {
+		glm::vec3 s;
+		if (!project(boxCorner(mn, mx, n), s)) return result(true);
+		lo = glm::min(lo, s);
+		hi = glm::max(hi, s);
+	}
+	int x0 = std::max(0, (int)std::floor(lo.x)), x1 = std::min(WIDTH - 1, (int)std::ceil(hi.x));
+	int y0 = std::max(0, (int)std::floor(lo.y)), y1 = std::min(HEIGHT - 1, (int)std::ceil(hi.y));
+	if (x0 > x1 || y0 > y1) return result(false); //off screen
+	const float nearest = lo.z;
+
+	// visible as soon as one covered pixel has nothing in front of the box's nearest point
+	for (int y = y0; y <= y1; ++y) {
+		const float* row = depth.data() + y * WIDTH;
+#ifdef OCCLUSION_SSE
+		const __m128 nearestv = _mm_set1_ps(nearest);
+		const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+		const __m128 first = _mm_set1_ps((float)x0), last = _mm_set1_ps((float)x1);
+		for (int x = x0 & ~3; x <= x1; x += 4) {
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+			__m128 covered = _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmple_ps(px, last));
+			__m128 open = _mm_cmpgt_ps(_mm_loadu_ps(row + x), nearestv);
+			if (_mm_movemask_ps(_mm_and_ps(covered, open))) return result(true);
+		}
+#else
+		for (int x = x0; x <= x1; ++x) {
+			if (row[x] > nearest) return result(true);
+		}
+#endif
+	}
+	return result(false);
+}
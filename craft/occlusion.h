@@ -0,0 +1,60 @@
+#pragma once
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <vector>
+#include <chrono>
+#include <glm/glm.hpp>
+
+/*
+a small software depth buffer for culling chunks hidden behind nearer terrain, entirely on the CPU.
+occluders are boxes known to be solid, which are rasterized at low resolution with the farthest depth
+of each triangle, so that the buffer never claims more occlusion than there is.
+a box is then hidden if its nearest point is behind the buffer everywhere its screen rectangle covers.
+depth is the clip space w, the distance along the view direction.
+rows are processed 4 pixels at a time with SSE where available.
+*/
+class OcclusionBuffer {
+public:
+	static constexpr int WIDTH = 128, HEIGHT = 128; //WIDTH must be a multiple of 4
+
+	struct Stats {
+		size_t frames = 0;
+		size_t occluders = 0, triangles = 0; //rasterized
+		size_t tested = 0, culled = 0;
+		double rasterMs = 0.0, testMs = 0.0;
+	};
+
+	// geometry closer than this to the camera is not projected. occluders reaching it are skipped,
+	// and tested boxes reaching it are visible.
+	float nearPlane = 0.1f;
+
+	OcclusionBuffer();
+
+	// clears the buffer for a new frame seen through viewProj.
+	// a frame adds all of its occluders, then tests its boxes. the clock is read when each of the two starts and at End(),
+	// so rasterMs and testMs include whatever the caller does between the calls.
+	void Begin(const glm::mat4& viewProj);
+	void AddOccluder(const glm::vec3& mn, const glm::vec3& mx);
+	// false only if the box is certainly hidden by the occluders added so far, or outside the screen.
+	bool TestAABB(const glm::vec3& mn, const glm::vec3& mx);
+	// closes the frame's statistics.
+	void End();
+
+	float DepthAt(int x, int y) const { return depth[y * WIDTH + x]; }
+	const Stats& LastFrameStats() const { return lastFrame; }
+	const Stats& TotalStats() const { return total; }
+
+private:
+	// x, y in pixels and w the depth of a projected point
+	void rasterizeTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2);
+	bool project(const glm::vec3& p, glm::vec3& out) const;
+
+	glm::mat4 viewProj{ 1.0f };
+	std::chrono::steady_clock::time_point phaseBegin; //of the occluders, or of the tests once testing
+	bool testing = false;
+	std::vector<float> depth; //WIDTH * HEIGHT, row major
+	Stats current, lastFrame, total;
+};
+
+#endif
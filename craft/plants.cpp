@@ -27,11 +27,10 @@ std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>& SmallPlants::Make(PlantT
 
 
 // TREES
-std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>& Trees::Make(TreeType ty) {
-	static int counter = 0;
-	counter = (counter + 1) % 2;
+std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>& Trees::Make(TreeType ty, float r) {
 	if (ty >= protoTypes.size()) throw std::out_of_range("oops! check the number of trees in database and the requested tree type!");
-	return protoTypes[ty][counter];
+	size_t variant = std::min((size_t)(r * protoTypes[ty].size()), protoTypes[ty].size() - 1);
+	return protoTypes[ty][variant];
 }
 
 std::vector<std::vector<std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>>>
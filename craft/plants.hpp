@@ -33,7 +33,8 @@ public:
 	};
 
 	static std::vector<TreeInfo> tbl;
-	static std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>& Make(TreeType ty);
+	// r in [0, 1) picks one of the tree's variants, so the same r always grows the same tree.
+	static std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>& Make(TreeType ty, float r);
 
 	static std::vector<std::vector<std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>>> protoTypes;
 	static std::vector<std::vector<std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>>> initializePrototypes();
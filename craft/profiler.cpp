@@ -0,0 +1,173 @@
+#include "profiler.h"
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+
+namespace Profiler {
+	static constexpr size_t RING_CAPACITY = 1 << 16; //events per thread, 2MB of 32 byte events
+
+	struct ThreadRing {
+		std::vector<Event> events;
+		std::atomic<uint64_t> written{ 0 }; //events ever recorded, the ring holds the last RING_CAPACITY
+		uint32_t tid = 0;
+		uint32_t depth = 0;
+		std::string name;
+	};
+
+	static std::atomic<bool> enabled{ true };
+	static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+	// rings outlive their threads, so a trace still shows threads that have exited.
+	static std::mutex registryMutex;
+	static std::vector<std::unique_ptr<ThreadRing>> registry;
+
+	static ThreadRing& threadRing() {
+		thread_local ThreadRing* ring = nullptr;
+		if (!ring) {
+			std::lock_guard<std::mutex> lock(registryMutex);
+			registry.push_back(std::make_unique<ThreadRing>());
+			ring = registry.back().get();
+			ring->events.resize(RING_CAPACITY);
+			ring->tid = (uint32_t)registry.size();
+			ring->name = "thread " + std::to_string(ring->tid);
+		}
+		return *ring;
+	}
+
+	// frame summaries, main thread only
+	static ThreadRing* mainRing = nullptr;
+	static uint64_t frameBeginNs = 0;
+	static size_t frameCnt = 0;
+	static std::vector<ZoneSummary> lastFrame;
+	static std::map<std::string, ZoneSummary> accumulated;
+
+	void SetEnabled(bool e) { enabled.store(e, std::memory_order_relaxed); }
+	bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	uint64_t NowNs() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	uint32_t& ThreadDepth() {
+		return threadRing().depth;
+	}
+
+	void Record(const char* name, uint64_t beginNs, uint64_t endNs, uint32_t depth) {
+		ThreadRing& ring = threadRing();
+		uint64_t n = ring.written.load(std::memory_order_relaxed);
+		ring.events[n % RING_CAPACITY] = { name, beginNs, endNs, depth };
+		ring.written.store(n + 1, std::memory_order_release);
+	}
+
+	void SetThreadName(const char* name) {
+		ThreadRing& ring = threadRing();
+		std::lock_guard<std::mutex> lock(registryMutex);
+		ring.name = name;
+	}
+
+	void BeginFrame() {
+		mainRing = &threadRing();
+		frameBeginNs = NowNs();
+	}
+
+	static void sortSlowestFirst(std::vector<ZoneSummary>& summary) {
+		std::sort(summary.begin(), summary.end(), [](const ZoneSummary& a, const ZoneSummary& b) { return a.ms > b.ms; });
+	}
+
+	void EndFrame() {
+		if (!mainRing) return;
+		if (IsEnabled()) Record("frame", frameBeginNs, NowNs(), 0);
+
+		// the frame's zones are the most recent events of the main thread's ring
+		lastFrame.clear();
+		uint64_t written = mainRing->written.load(std::memory_order_acquire);
+		for (uint64_t n = written; n > 0 && written - n < RING_CAPACITY; --n) {
+			const Event& e = mainRing->events[(n - 1) % RING_CAPACITY];
+			if (e.endNs < frameBeginNs) break;
+			auto it = std::find_if(lastFrame.begin(), lastFrame.end(), [&e](const ZoneSummary& z) { return std::strcmp(z.name, e.name) == 0; });
+			if (it == lastFrame.end()) it = lastFrame.insert(lastFrame.end(), { e.name, 0.0, 0 });
+			it->ms += (e.endNs - e.beginNs) * 1e-6;
+			it->calls++;
+		}
+		sortSlowestFirst(lastFrame);
+
+		for (const ZoneSummary& z : lastFrame) {
+			ZoneSummary& acc = accumulated.try_emplace(z.name, ZoneSummary{ z.name, 0.0, 0 }).first->second;
+			acc.ms += z.ms;
+			acc.calls += z.calls;
+		}
+		frameCnt++;
+	}
+
+	const std::vector<ZoneSummary>& LastFrameSummary() {
+		return lastFrame;
+	}
+
+	std::vector<ZoneSummary> AverageSummary() {
+		std::vector<ZoneSummary> summary;
+		if (frameCnt == 0) return summary;
+		for (auto& [name, z] : accumulated) summary.push_back({ z.name, z.ms / frameCnt, (uint32_t)(z.calls / frameCnt) });
+		sortSlowestFirst(summary);
+		return summary;
+	}
+
+	size_t FrameCount() {
+		return frameCnt;
+	}
+
+	void PrintSummary(std::ostream& os, const std::vector<ZoneSummary>& summary) {
+		for (const ZoneSummary& z : summary) {
+			os << std::setw(28) << std::left << z.name << std::right << std::fixed << std::setprecision(3)
+				<< std::setw(9) << z.ms << " ms" << std::setw(6) << z.calls << " calls" << '\n';
+		}
+		os << std::defaultfloat << std::flush;
+	}
+
+	static void writeJsonString(std::ostream& os, const std::string& s) {
+		os << '"';
+		for (char c : s) {
+			if (c == '"' || c == '\\') os << '\\';
+			os << c;
+		}
+		os << '"';
+	}
+
+	bool WriteChromeTrace(const std::string& path) {
+		std::ofstream ofs(path);
+		if (!ofs) {
+			std::cout << "ERROR::PROFILER::COULD_NOT_OPEN_TRACE_FILE: " << path << std::endl;
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		size_t cnt = 0;
+		ofs << "{\"traceEvents\":[\n";
+		for (auto& ring : registry) {
+			if (cnt++) ofs << ",\n";
+			ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid << ",\"args\":{\"name\":";
+			writeJsonString(ofs, ring->name);
+			ofs << "}}";
+
+			uint64_t written = ring->written.load(std::memory_order_acquire);
+			uint64_t first = written > RING_CAPACITY ? written - RING_CAPACITY : 0;
+			for (uint64_t n = first; n < written; ++n) {
+				const Event& e = ring->events[n % RING_CAPACITY];
+				ofs << ",\n{\"name\":";
+				writeJsonString(ofs, e.name);
+				ofs << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid << std::fixed << std::setprecision(3)
+					<< ",\"ts\":" << e.beginNs * 1e-3 << ",\"dur\":" << (e.endNs - e.beginNs) * 1e-3 << "}";
+				cnt++;
+			}
+		}
+		ofs << "\n]}\n";
+		std::cout << "wrote " << cnt << " trace events to " << path << std::endl;
+		return ofs.good();
+	}
+}
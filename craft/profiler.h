@@ -0,0 +1,96 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <ostream>
+
+// zones are compiled out entirely with GLCRAFT_PROFILE=0
+#ifndef GLCRAFT_PROFILE
+#define GLCRAFT_PROFILE 1
+#endif
+
+/*
+scoped cpu zones. a zone measures the lifetime of a local object, and on destruction appends
+(name, begin, end, depth) to its thread's ring buffer, so recording takes no lock and never allocates.
+once a ring is full the oldest events are overwritten.
+zone names must be string literals, or otherwise outlive the profiler.
+the main thread marks frames, which are summarized per zone name, and every thread's ring can be
+written out as a chrome trace(chrome://tracing, or ui.perfetto.dev).
+*/
+namespace Profiler {
+	struct Event {
+		const char* name;
+		uint64_t beginNs, endNs; //since the profiler's epoch
+		uint32_t depth; //nesting level inside the thread
+	};
+
+	struct ZoneSummary {
+		const char* name;
+		double ms;
+		uint32_t calls;
+	};
+
+	// zones started while disabled record nothing.
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	// frame boundaries, called from the main thread.
+	void BeginFrame();
+	void EndFrame();
+
+	// main thread zones of the last finished frame, slowest first.
+	const std::vector<ZoneSummary>& LastFrameSummary();
+	// average time per frame of every zone since the start, slowest first.
+	std::vector<ZoneSummary> AverageSummary();
+	size_t FrameCount();
+	void PrintSummary(std::ostream& os, const std::vector<ZoneSummary>& summary);
+
+	// writes the events still held by every thread's ring. other threads keep recording meanwhile,
+	// so their most recent events may be missing or torn.
+	bool WriteChromeTrace(const std::string& path);
+
+	// the calling thread's name in traces
+	void SetThreadName(const char* name);
+
+	uint64_t NowNs();
+	void Record(const char* name, uint64_t beginNs, uint64_t endNs, uint32_t depth);
+	uint32_t& ThreadDepth();
+
+	class Zone {
+	public:
+		explicit Zone(const char* name) : name(name) {
+			if (!IsEnabled()) {
+				this->name = nullptr;
+				return;
+			}
+			depth = ThreadDepth()++;
+			beginNs = NowNs();
+		}
+		~Zone() {
+			if (!name) return;
+			Record(name, beginNs, NowNs(), depth);
+			ThreadDepth()--;
+		}
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		uint64_t beginNs = 0;
+		uint32_t depth = 0;
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if GLCRAFT_PROFILE
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
+
+#endif
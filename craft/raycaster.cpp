@@ -0,0 +1,104 @@
+#include "raycaster.h"
+#include "world.h"
+#include "workers.h"
+#include "profiler.h"
+#include <limits>
+#include <algorithm>
+
+VoxelRaycaster::VoxelRaycaster(World& world) : world(world) {
+	threads = WorkerPool::GetInstance().Threads();
+}
+
+VoxelRaycaster::Hit VoxelRaycaster::Cast(const Ray& ray, float maxDistance) const {
+	ChunkCache cache;
+	return cast(ray, maxDistance, cache);
+}
+
+VoxelRaycaster::Hit VoxelRaycaster::cast(const Ray& ray, float maxDistance, ChunkCache& cache) const {
+	static const int entryFaces[3][2] = { //[axis][stepping in the negative direction]
+		{ Block::Face::LEFT, Block::Face::RIGHT },
+		{ Block::Face::BOTTOM, Block::Face::TOP },
+		{ Block::Face::BACK, Block::Face::FRONT }
+	};
+	Hit result;
+
+	// block i spans [i - 0.5, i + 0.5), so in p the block boundaries are at integers.
+	glm::vec3 p = ray.pos + 0.5f;
+	glm::ivec3 cell = glm::floor(p);
+	glm::ivec3 step;
+	glm::vec3 tMax, tDelta; //ray distance to the next boundary on each axis, and between boundaries
+	for (int a = 0; a < 3; ++a) {
+		if (ray.dir[a] > 0.0f) {
+			step[a] = 1;
+			tMax[a] = (cell[a] + 1 - p[a]) * ray.invDir[a];
+			tDelta[a] = ray.invDir[a];
+		}
+		else if (ray.dir[a] < 0.0f) {
+			step[a] = -1;
+			tMax[a] = (cell[a] - p[a]) * ray.invDir[a];
+			tDelta[a] = -ray.invDir[a];
+		}
+		else {
+			step[a] = 0;
+			tMax[a] = tDelta[a] = std::numeric_limits<float>::infinity();
+		}
+	}
+
+	while (true) {
+		int a = (tMax.x < tMax.y && tMax.x < tMax.z) ? 0 : (tMax.y < tMax.z) ? 1 : 2;
+		float t = tMax[a];
+		if (t > maxDistance) break;
+		glm::ivec3 prev = cell;
+		cell[a] += step[a];
+		tMax[a] += tDelta[a];
+
+		glm::ivec3 chunkIdx = Chunk::BlockToChunkIndex(cell);
+		if (!cache.valid || chunkIdx != cache.idx) {
+			cache.idx = chunkIdx;
+			cache.chunk = world.GetChunkByIndex(chunkIdx);
+			cache.valid = true;
+		}
+		if (!cache.chunk) break; //not streamed in
+
+		glm::ivec3 local = cell - cache.chunk->basepos;
+		BlockDB::BlockType type = cache.chunk->grid[local.x][local.y][local.z];
+		if (type != BlockDB::BlockType::BLOCK_AIR) {
+			result.hit = true;
+			result.block = cell;
+			result.previous = prev;
+			result.face = entryFaces[a][step[a] < 0];
+			result.distance = t;
+			result.type = type;
+			break;
+		}
+	}
+	return result;
+}
+
+size_t VoxelRaycaster::castPackets(const Ray* rays, size_t cnt, float maxDistance, Hit* hits, std::atomic<size_t>& nextPacket) const {
+	size_t hitCnt = 0;
+	ChunkCache cache; //kept across packets, neighbouring packets usually end up in the same chunks
+	for (size_t packet = nextPacket++; packet * PACKET_SIZE < cnt; packet = nextPacket++) {
+		size_t end = std::min(cnt, (packet + 1) * PACKET_SIZE);
+		for (size_t n = packet * PACKET_SIZE; n < end; ++n) {
+			hits[n] = cast(rays[n], maxDistance, cache);
+			hitCnt += hits[n].hit;
+		}
+	}
+	return hitCnt;
+}
+
+size_t VoxelRaycaster::CastBatch(const Ray* rays, size_t cnt, float maxDistance, Hit* hits) const {
+	PROFILE_ZONE("VoxelRaycaster::CastBatch");
+	size_t packets = (cnt + PACKET_SIZE - 1) / PACKET_SIZE;
+	std::atomic<size_t> nextPacket{ 0 }, hitCnt{ 0 };
+	WorkerPool::GetInstance().Run("raycast: packets", std::min<size_t>(std::max(1u, threads), packets), [&](size_t) {
+		hitCnt += castPackets(rays, cnt, maxDistance, hits, nextPacket);
+	});
+	return hitCnt;
+}
+
+size_t VoxelRaycaster::CastBatch(const std::vector<Ray>& rays, float maxDistance, std::vector<Hit>& hits) const {
+	hits.resize(rays.size());
+	return CastBatch(rays.data(), rays.size(), maxDistance, hits.data());
+}
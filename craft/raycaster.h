@@ -0,0 +1,62 @@
+#pragma once
+#ifndef RAYCASTER_H
+#define RAYCASTER_H
+
+#include <vector>
+#include <atomic>
+#include <glm/glm.hpp>
+#include "ray.h"
+#include "blocks.hpp"
+
+class World;
+class Chunk;
+
+/*
+casts rays through the blocks of the loaded chunks(World::visChunks), stepping from block to block
+along the ray(a 3d DDA) until it enters a non air block or has gone maxDistance.
+the block the ray starts in is never hit, so a ray cast from inside a block finds the next one.
+chunks that are not loaded stop the ray, as if it left the world.
+
+Cast() traces one ray. CastBatch() traces many, split into packets of PACKET_SIZE rays
+that the threads of the WorkerPool take in turn. rays of a packet share the chunk the last one ended in,
+so coherent rays(line of sight from one spot, an explosion) rarely look a chunk up.
+both only read chunks, so nothing may modify them while a batch runs.
+*/
+class VoxelRaycaster {
+public:
+	static constexpr size_t PACKET_SIZE = 64;
+
+	struct Hit {
+		bool hit = false;
+		glm::ivec3 block{ 0 }; //world idx of the block hit
+		glm::ivec3 previous{ 0 }; //the empty block the ray came from, where a block placed against the hit face goes
+		int face = -1; //Block::Face the ray entered the block through
+		float distance = 0.0f; //along the ray to the hit face
+		BlockDB::BlockType type = BlockDB::BlockType::BLOCK_AIR;
+	};
+
+	explicit VoxelRaycaster(World& world);
+
+	// threads CastBatch uses at most, including the calling one. defaults to the WorkerPool's.
+	unsigned threads;
+
+	Hit Cast(const Ray& ray, float maxDistance) const;
+	// hits[n] is the hit of rays[n]. returns the number of rays that hit a block.
+	size_t CastBatch(const Ray* rays, size_t cnt, float maxDistance, Hit* hits) const;
+	size_t CastBatch(const std::vector<Ray>& rays, float maxDistance, std::vector<Hit>& hits) const;
+
+private:
+	// the chunk a ray last stepped through
+	struct ChunkCache {
+		glm::ivec3 idx{ 0 };
+		Chunk* chunk = nullptr;
+		bool valid = false;
+	};
+
+	Hit cast(const Ray& ray, float maxDistance, ChunkCache& cache) const;
+	size_t castPackets(const Ray* rays, size_t cnt, float maxDistance, Hit* hits, std::atomic<size_t>& nextPacket) const;
+
+	World& world;
+};
+
+#endif
@@ -1,16 +1,41 @@
 #include "rendering.hpp"
 
 
+MeshStaging::MeshStaging() {
+	vtxdata.reserve(RESERVE_FACES * 4 * 3);
+	uvdata.reserve(RESERVE_FACES * 4 * 3);
+	idxdata.reserve(RESERVE_FACES * 6);
+}
+
+void MeshStaging::Clear() {
+	// clear() keeps the capacity, so the next build does not reallocate.
+	vtxdata.clear();
+	uvdata.clear();
+	idxdata.clear();
+}
+
+MeshStaging& MeshStaging::ThreadLocal(int slot) {
+	static thread_local MeshStaging slots[NUM_SLOTS];
+	assert(slot >= 0 && slot < NUM_SLOTS);
+	return slots[slot];
+}
+
 RenderObject::RenderObject(RenderMode _mode):mode(_mode), isBuilt(false), hasBuffers(false), isRender(true) {
-	const int CHUNK_SIZE = 32;
-	//vtxdata.reserve(CHUNK_SIZE * 4 * 3);
-	//uvdata.reserve(CHUNK_SIZE * 4 * 3);
-	//idxdata.reserve(CHUNK_SIZE * 6);
 }
 
+void RenderObject::BeginStaging(MeshStaging& s) {
+	staging = &s;
+	staging->Clear();
+}
+
+// appends block's mesh and texture data into the staging buffer
+static_assert(BlockDB::BlockTextures::NONE < RenderObject::LIGHT_LAYER_STRIDE, "the light must not change a face's texture");
 
-// appends block's mesh and texture data into internal storage vector
-void RenderObject::PlaceBlockFaceData(BlockDB::BlockType blkTy, glm::f32vec3 pos, unsigned int face) {
+void RenderObject::PlaceBlockFaceData(BlockDB::BlockType blkTy, glm::f32vec3 pos, unsigned int face, int light) {
+	assert(staging != nullptr);
+	std::vector<GLfloat>& vtxdata = staging->vtxdata;
+	std::vector<GLfloat>& uvdata = staging->uvdata;
+	std::vector<GLuint>& idxdata = staging->idxdata;
 	BlockDB::BlockDataRow& row = BlockDB::GetInstance().tbl[blkTy];
 	BlockMeshData& mesh = BlockDB::GetInstance().GetMeshData(row.meshType);
 	// place vertex data. 4 vertices of a square * 3 (xyz)
@@ -27,7 +52,7 @@ void RenderObject::PlaceBlockFaceData(BlockDB::BlockType blkTy, glm::f32vec3 pos
 		{1.0f, 1.0f},
 		{0.0f, 1.0f},
 	};
-	float texf = (float)row.faceTextures[face];
+	float texf = (float)(row.faceTextures[face] + LIGHT_LAYER_STRIDE * (BlockDB::MAX_LIGHT - light));
 	for (int v = 0; v < 4; ++v) {
 		uvdata.push_back(uvFace[v][0]);
 		uvdata.push_back(uvFace[v][1]);
@@ -46,24 +71,67 @@ void RenderObject::PlaceBlockFaceData(BlockDB::BlockType blkTy, glm::f32vec3 pos
 	idxcnt += 6;
 }
 
+void RenderObject::PlaceQuadData(const glm::f32vec3 (&corners)[4], BlockDB::BlockTextures tex, float uRepeat, float vRepeat) {
+	assert(staging != nullptr);
+	const float uvQuad[4][2]{
+		{0.0f, 0.0f},
+		{uRepeat, 0.0f},
+		{uRepeat, vRepeat},
+		{0.0f, vRepeat},
+	};
+	for (int v = 0; v < 4; ++v) {
+		staging->vtxdata.push_back(corners[v].x);
+		staging->vtxdata.push_back(corners[v].y);
+		staging->vtxdata.push_back(corners[v].z);
+		staging->uvdata.push_back(uvQuad[v][0]);
+		staging->uvdata.push_back(uvQuad[v][1]);
+		staging->uvdata.push_back((float)tex);
+	}
+
+	// same triangulation as block faces
+	std::vector<GLuint>& idxdata = staging->idxdata;
+	idxdata.push_back(vtxcnt + 0);
+	idxdata.push_back(vtxcnt + 1);
+	idxdata.push_back(vtxcnt + 3);
+	idxdata.push_back(vtxcnt + 3);
+	idxdata.push_back(vtxcnt + 1);
+	idxdata.push_back(vtxcnt + 2);
+
+	vtxcnt += 4;
+	idxcnt += 6;
+}
 
 void RenderObject::Build() {
 	if (isBuilt) return;
+	if (arena) {
+		if (staging) arena->Upload(staging->vtxdata, staging->uvdata, staging->idxdata, OUT alloc);
+		if (staging) staging->Clear();
+		staging = nullptr;
+		isBuilt = true;
+		return;
+	}
 	CreateBuffers();
 
+	// nothing staged means an empty mesh
+	GLfloat* vtxptr = staging ? staging->vtxdata.data() : nullptr;
+	GLfloat* uvptr = staging ? staging->uvdata.data() : nullptr;
+	GLuint* idxptr = staging ? staging->idxdata.data() : nullptr;
+	size_t vtxsz = staging ? staging->vtxdata.size() : 0;
+	size_t uvsz = staging ? staging->uvdata.size() : 0;
+	size_t idxsz = staging ? staging->idxdata.size() : 0;
+
 	vao.Bind();
-	vbo_pos.BufferData(vtxdata.data(), sizeof(vtxdata[0]) * vtxdata.size());
+	vbo_pos.BufferData(vtxptr, sizeof(GLfloat) * vtxsz);
 	vao.LinkAttrib(vbo_pos, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
-	vbo_uv.BufferData(uvdata.data(), sizeof(uvdata[0]) * uvdata.size());
+	vbo_uv.BufferData(uvptr, sizeof(GLfloat) * uvsz);
 	vao.LinkAttrib(vbo_uv, 1, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
-	ebo.BufferData(idxdata.data(), sizeof(idxdata[0]) * idxdata.size());
+	ebo.BufferData(idxptr, sizeof(GLuint) * idxsz);
 	vao.Unbind();
 	ebo.Unbind();
 
-	// once built, we can dispose of internal storage.
-	vtxdata.clear();
-	uvdata.clear();
-	idxdata.clear();
+	// once built, the staging buffer goes back to its thread for the next build.
+	if (staging) staging->Clear();
+	staging = nullptr;
 	
 	isBuilt = true;
 }
@@ -80,6 +148,7 @@ void RenderObject::CreateBuffers() {
 }
 
 void RenderObject::DeleteBuffers() {
+	if (arena) arena->Free(alloc);
 	if (hasBuffers) {
 		vao.Delete();
 		vbo_pos.Delete();
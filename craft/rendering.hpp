@@ -6,11 +6,30 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <cassert>
 #include <glad/glad.h>
 
 #include "GLObjects.h"
 #include "camera.h" 
 #include "blocks.hpp"
+#include "batching.h"
+
+// CPU-side mesh data of a render object, before it is transferred to GL buffers.
+// staging buffers belong to a thread and are reused by every build on that thread,
+// so they grow to the size of the largest mesh once and are never freed.
+struct MeshStaging {
+	static constexpr int NUM_SLOTS = 3; // a chunk stages its solid, cutout and water meshes at the same time
+	static constexpr size_t RESERVE_FACES = 8192;
+
+	std::vector<GLfloat> vtxdata, uvdata;
+	std::vector<GLuint> idxdata;
+
+	MeshStaging();
+	void Clear();
+
+	// one of the calling thread's staging buffers, slot < NUM_SLOTS.
+	static MeshStaging& ThreadLocal(int slot);
+};
 
 class RenderObject {
 public:
@@ -23,8 +42,16 @@ public:
 	RenderObject() = default;
 	RenderObject(RenderMode _mode);
 
+	// faces placed after this call are written to staging, until Build() uploads them.
+	void BeginStaging(MeshStaging& staging);
 	void Build();
-	void PlaceBlockFaceData(BlockDB::BlockType blkTy, glm::f32vec3 offset, unsigned int face);
+	// light(0 to BlockDB::MAX_LIGHT) is the sky light the face receives, packed into the texture layer:
+	// layer + LIGHT_LAYER_STRIDE * (MAX_LIGHT - light), unpacked by basic.vs and wave.vs.
+	static constexpr int LIGHT_LAYER_STRIDE = 32; //more than the number of block textures
+	void PlaceBlockFaceData(BlockDB::BlockType blkTy, glm::f32vec3 offset, unsigned int face, int light = BlockDB::MAX_LIGHT);
+	// a quad with arbitrary corners, in order around its edge.
+	// the texture repeats uRepeat times along corners[0]->corners[1] and vRepeat times along corners[1]->corners[2].
+	void PlaceQuadData(const glm::f32vec3 (&corners)[4], BlockDB::BlockTextures tex, float uRepeat, float vRepeat);
 	void CreateBuffers();
 	void DeleteBuffers();
 
@@ -47,12 +74,17 @@ public:
 	VBO vbo_pos, vbo_uv;
 	EBO ebo;
 
-	std::vector<GLfloat> vtxdata, uvdata;
-	std::vector<GLuint> idxdata;
+	// not owned. points to a thread's staging buffer between BeginStaging() and Build()
+	MeshStaging* staging = nullptr;
+
+	// when set, the mesh is uploaded to the arena's shared buffers instead of vao/vbo/ebo,
+	// and is drawn by adding alloc to one of the arena's command lists.
+	MeshArena* arena = nullptr;
+	MeshAllocation alloc;
 
     // how much data transferred to GLObjects,
-    // not vtxdata.size() or idxdata.size()
-    // interal storage can actually be empty
+    // not staging->vtxdata.size() or staging->idxdata.size()
+    // staging can actually be detached
 	size_t vtxcnt = 0, idxcnt = 0;
 
 private:
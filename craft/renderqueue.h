@@ -0,0 +1,84 @@
+#pragma once
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "batching.h"
+#include "profiler.h"
+
+/*
+the meshes drawn in a frame, sorted by an integer key and submitted with as few state changes
+and multi draw calls as possible. the key is, from the most significant bit:
+	pass(4 bits) | state(12 bits) | depth(32 bits) | 16 unused bits
+passes run in order. within a pass, items are grouped by state, which stands for the shader and
+uniforms they need, and a group is one multi draw call.
+within a group, opaque and cutout items go front to back so early depth testing rejects hidden
+fragments, transparent items go back to front so they blend over what is behind them.
+*/
+class RenderQueue {
+public:
+	enum Pass : uint8_t {
+		OPAQUE, CUTOUT, TRANSPARENT
+	};
+
+	struct Item {
+		uint64_t key;
+		MeshAllocation alloc;
+	};
+
+	struct Stats {
+		size_t items = 0;
+		size_t stateChanges = 0; //calls to the state callback, one per draw call
+	};
+
+	// depth is the distance to the camera and must not be negative.
+	static uint64_t MakeKey(Pass pass, uint16_t state, float depth) {
+		// non-negative floats order the same as their bit patterns
+		uint32_t depthBits;
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+		if (pass == TRANSPARENT) depthBits = ~depthBits;
+		return ((uint64_t)pass << 60) | ((uint64_t)(state & 0xfff) << 48) | ((uint64_t)depthBits << 16);
+	}
+	static Pass PassOf(uint64_t key) { return (Pass)(key >> 60); }
+	static uint16_t StateOf(uint64_t key) { return (uint16_t)((key >> 48) & 0xfff); }
+
+	void Clear() { items.clear(); }
+	void Push(Pass pass, uint16_t state, float depth, const MeshAllocation& alloc) {
+		if (alloc.indexCnt == 0) return;
+		items.push_back({ MakeKey(pass, state, depth), alloc });
+	}
+
+	void Sort() {
+		std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.key < b.key; });
+	}
+
+	// draws the sorted items. bindState(pass, state) is called before each group of items sharing pass and state.
+	template<class BindStateFn>
+	void Submit(MeshArena& arena, BindStateFn bindState) {
+		static const char* const PASS_ZONES[3] = { "opaque pass", "cutout pass", "transparent pass" };
+		lastFrame = Stats();
+		lastFrame.items = items.size();
+		for (size_t n = 0; n < items.size();) {
+			uint64_t group = items[n].key >> 48;
+			PROFILE_ZONE(PASS_ZONES[PassOf(items[n].key)]);
+			bindState(PassOf(items[n].key), StateOf(items[n].key));
+			lastFrame.stateChanges++;
+			cmds.Clear();
+			for (; n < items.size() && (items[n].key >> 48) == group; ++n) cmds.Add(items[n].alloc);
+			arena.Draw(cmds);
+		}
+	}
+
+	const Stats& LastFrameStats() const { return lastFrame; }
+
+	std::vector<Item> items;
+
+private:
+	DrawCommandList cmds; //reused by every group
+	Stats lastFrame;
+};
+
+#endif
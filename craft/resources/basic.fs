@@ -2,9 +2,11 @@
 out vec4 FragColor;
   
 in vec3 texCoord;
+in float shade;
 
 uniform sampler2DArray tex0;
 void main()
 {
     FragColor = texture(tex0, texCoord);
+    FragColor.rgb *= shade;
 } 
\ No newline at end of file
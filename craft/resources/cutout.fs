@@ -2,11 +2,12 @@
 out vec4 FragColor;
   
 in vec3 texCoord;
+in float shade;
 
 uniform sampler2DArray tex0;
 void main()
 {
     vec4 texColor = texture(tex0, texCoord);
     if(texColor.a < 0.1) discard;
-    FragColor = texColor;
+    FragColor = vec4(texColor.rgb * shade, texColor.a);
 } 
\ No newline at end of file
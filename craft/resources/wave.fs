@@ -2,10 +2,14 @@
 out vec4 FragColor;
   
 in vec3 texCoord;
+in float shade;
 
 uniform sampler2DArray tex0;
 uniform float _Time;
+const float WATER_ALPHA = 0.75; // drawn in the transparent pass, blended over what is behind
 void main()
 {
     FragColor = texture(tex0, vec3(texCoord.x+_Time, texCoord.y, texCoord.z));
+    FragColor.rgb *= shade;
+    FragColor.a *= WATER_ALPHA;
 } 
\ No newline at end of file
@@ -4,13 +4,18 @@ layout (location = 1) in vec3 aTex;
 
 
 out vec3 texCoord; //specify which texture coordinate to assign to vertex
+out float shade; //how much of the texture's color the light lets through
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 proj;
+uniform float dayLight; //the sky's brightness, 0 at night to 1 at noon
 
 void main()
 {
     gl_Position = proj * view * model * vec4(aPos, 1.0); // see how we directly give a vec3 to vec4's constructor
-    texCoord = aTex;
+    // the layer carries the face's light: layer + 32 * (15 - light), see RenderObject::PlaceBlockFaceData
+    float light = 15.0 - floor(aTex.z / 32.0);
+    texCoord = vec3(aTex.xy, mod(aTex.z, 32.0));
+    shade = max(pow(0.8, 15.0 - light * dayLight), 0.04);
 }
\ No newline at end of file
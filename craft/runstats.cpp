@@ -0,0 +1,89 @@
+#include "runstats.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+void RunStats::AddFrame(double ms, int generated, int decorated, int meshed, int prefetched, size_t meshBytes) {
+	frameMs.push_back((float)ms);
+	counts.generated += generated;
+	counts.decorated += decorated;
+	counts.meshed += meshed;
+	counts.prefetched += prefetched;
+	counts.peakMeshBytes = std::max(counts.peakMeshBytes, meshBytes);
+}
+
+RunStats::Summary RunStats::Summarize() const {
+	Summary s = counts;
+	s.frames = frameMs.size();
+	s.peakResidentBytes = PeakResidentBytes();
+	if (frameMs.empty()) return s;
+
+	std::vector<float> sorted = frameMs;
+	std::sort(sorted.begin(), sorted.end());
+	// nearest rank
+	auto percentile = [&sorted](double p) {
+		size_t rank = (size_t)std::ceil(p * sorted.size());
+		return (double)sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+	};
+	double sum = 0.0;
+	for (float ms : sorted) sum += ms;
+	s.meanMs = sum / sorted.size();
+	s.p50Ms = percentile(0.50);
+	s.p90Ms = percentile(0.90);
+	s.p99Ms = percentile(0.99);
+	s.maxMs = sorted.back();
+	return s;
+}
+
+void RunStats::Print(std::ostream& os, const Summary& s) {
+	os << "run: " << s.frames << " frames, frame time mean " << s.meanMs << " ms, p50 " << s.p50Ms << " ms, p90 " << s.p90Ms
+		<< " ms, p99 " << s.p99Ms << " ms, max " << s.maxMs << " ms" << '\n';
+	os << "run: chunks generated " << s.generated << ", decorated " << s.decorated << ", meshed " << s.meshed << ", prefetched " << s.prefetched << '\n';
+	os << "run: peak memory " << s.peakResidentBytes / (1024.0 * 1024.0) << " MB resident, "
+		<< s.peakMeshBytes / (1024.0 * 1024.0) << " MB mesh buffers" << std::endl;
+}
+
+bool RunStats::WriteReport(const std::string& path, const Summary& s) {
+	std::ofstream ofs(path);
+	if (!ofs) {
+		std::cout << "ERROR::RUN_STATS::COULD_NOT_OPEN_REPORT_FILE: " << path << std::endl;
+		return false;
+	}
+	ofs << "frames " << s.frames << '\n'
+		<< "frame_ms_mean " << s.meanMs << '\n'
+		<< "frame_ms_p50 " << s.p50Ms << '\n'
+		<< "frame_ms_p90 " << s.p90Ms << '\n'
+		<< "frame_ms_p99 " << s.p99Ms << '\n'
+		<< "frame_ms_max " << s.maxMs << '\n'
+		<< "chunks_generated " << s.generated << '\n'
+		<< "chunks_decorated " << s.decorated << '\n'
+		<< "chunks_meshed " << s.meshed << '\n'
+		<< "chunks_prefetched " << s.prefetched << '\n'
+		<< "peak_resident_bytes " << s.peakResidentBytes << '\n'
+		<< "peak_mesh_bytes " << s.peakMeshBytes << '\n';
+	return ofs.good();
+}
+
+size_t RunStats::PeakResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+	return pmc.PeakWorkingSetSize;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss; //bytes
+#else
+	return (size_t)usage.ru_maxrss * 1024; //kilobytes
+#endif
+#endif
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifndef RUNSTATS_H
+#define RUNSTATS_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+/*
+per frame measurements of a whole run, summarized for comparing runs of the same input trace, e.g. in CI:
+frame time percentiles, chunk streaming work, and memory high-water marks.
+*/
+class RunStats {
+public:
+	struct Summary {
+		size_t frames = 0;
+		double meanMs = 0.0, p50Ms = 0.0, p90Ms = 0.0, p99Ms = 0.0, maxMs = 0.0;
+		size_t generated = 0, decorated = 0, meshed = 0, prefetched = 0; //chunk streaming tasks
+		size_t peakResidentBytes = 0; //of the process
+		size_t peakMeshBytes = 0; //capacity of the mesh arena's buffers
+	};
+
+	void AddFrame(double ms, int generated, int decorated, int meshed, int prefetched, size_t meshBytes);
+	Summary Summarize() const;
+
+	static void Print(std::ostream& os, const Summary& s);
+	// one "key value" pair per line, easy to diff and parse
+	static bool WriteReport(const std::string& path, const Summary& s);
+
+	// peak resident set size of the process so far, 0 if unknown
+	static size_t PeakResidentBytes();
+
+private:
+	std::vector<float> frameMs;
+	Summary counts; //streaming counts and mesh high-water mark, accumulated as frames are added
+};
+
+#endif
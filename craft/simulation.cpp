@@ -0,0 +1,356 @@
+#include "simulation.h"
+#include "world.h"
+#include "collision.h"
+#include "profiler.h"
+#include <iostream>
+#include <algorithm>
+
+static double steadySeconds() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+glm::vec3 updatePositionWithCollisionCheck(glm::vec3 begin_pos, glm::vec3 end_pos, glm::vec3 box_dims) {
+	return Collision::SlideThroughVoxels(begin_pos, end_pos, box_dims, SolidRows(World::GetInstance()));
+}
+
+Simulation::Simulation(World& world) : water(world), world(world), raycaster(world) {
+	digTicks = (uint64_t)(DIG_SECONDS / TICK);
+	while (digTicks * TICK <= DIG_SECONDS) digTicks++;
+	registerBlockBehaviours();
+}
+
+void Simulation::Reset(const glm::vec3& position) {
+	ticks = 0;
+	accumulator = 0.0;
+	body.SetPose(position, body.yaw, body.pitch);
+	lastPosition = position;
+	picked = {};
+	digging = false;
+	water.Clear();
+	blockTicks.Clear();
+
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	latest = Snapshot{};
+	latest.position = position;
+	previous = latest;
+	dirtyChunks.clear();
+}
+
+void Simulation::SetInput(const Input& in) {
+	std::lock_guard<std::mutex> lock(inputMutex);
+	input = in;
+}
+
+void Simulation::Advance(double dt) {
+	accumulator += dt;
+	while (accumulator >= TICK) {
+		accumulator -= TICK;
+		tick();
+	}
+}
+
+void Simulation::Start() {
+	if (threaded) return;
+	running = true;
+	threaded = true; //before the thread starts, its first clock() reads the threaded clock
+	threadEpoch = steadySeconds() - ticks * TICK - accumulator;
+	thread = std::thread([this]() {
+		Profiler::SetThreadName("simulation");
+		while (running) {
+			// tick n is due once the clock reaches n * TICK
+			double ahead = clock() - ticks * TICK;
+			if (ahead < TICK) {
+				std::this_thread::sleep_for(std::chrono::duration<double>(TICK - ahead));
+				continue;
+			}
+			if (ahead > MAX_CATCH_UP_TICKS * TICK) threadEpoch = threadEpoch + (ahead - TICK);
+			tick();
+		}
+	});
+}
+
+void Simulation::Stop() {
+	if (!threaded) return;
+	running = false;
+	thread.join();
+	threaded = false;
+	// Advance() carries on from where the thread stopped
+	accumulator = std::clamp(steadySeconds() - threadEpoch - ticks * TICK, 0.0, TICK);
+}
+
+double Simulation::clock() const {
+	if (threaded) return steadySeconds() - threadEpoch;
+	return ticks * TICK + accumulator;
+}
+
+Simulation::Snapshot Simulation::View() const {
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	Snapshot view = latest;
+	float alpha = (float)std::clamp((clock() - latest.tick * TICK) / TICK, 0.0, 1.0);
+	view.position = glm::mix(previous.position, latest.position, alpha);
+	return view;
+}
+
+std::vector<glm::ivec3> Simulation::TakeDirtyChunks() {
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	std::vector<glm::ivec3> taken;
+	taken.swap(dirtyChunks);
+	return taken;
+}
+
+double Simulation::MeanTickMs() const {
+	return ticks ? tickMsTotal / ticks : 0.0;
+}
+
+void Simulation::tick() {
+	PROFILE_ZONE("simulation tick");
+	auto begin = std::chrono::steady_clock::now();
+	Input in;
+	{
+		std::lock_guard<std::mutex> lock(inputMutex);
+		in = input;
+	}
+
+	std::lock_guard<std::mutex> worldLock(world.mutex);
+	// movement, then collision from where the last tick ended.
+	// the pick comes in between, so it sees the position the player is heading to.
+	body.SetPose(body.position, in.yaw, in.pitch);
+	if (in.forward) body.ProcessKeyboard(FORWARD, (float)TICK);
+	if (in.backward) body.ProcessKeyboard(BACKWARD, (float)TICK);
+	if (in.left) body.ProcessKeyboard(LEFT, (float)TICK);
+	if (in.right) body.ProcessKeyboard(RIGHT, (float)TICK);
+	{
+		PROFILE_ZONE("raycast");
+		pick(body.position, in.pickDir);
+	}
+	{
+		PROFILE_ZONE("collision");
+		body.position = updatePositionWithCollisionCheck(lastPosition - EYE_OFFSET, body.position - EYE_OFFSET, PLAYER_SIZE) + EYE_OFFSET;
+		lastPosition = body.position;
+	}
+
+	dig(in.mouseHeld);
+	runBlockTicks();
+	entities.Step(world, (float)TICK);
+	settleLandedBlocks();
+	water.Step(ticks);
+	for (const glm::ivec3& chunkIdx : water.TakeChangedChunks()) markChunkDirty(chunkIdx);
+
+	ticks++;
+	publish();
+	tickMsTotal += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void Simulation::publish() {
+	Snapshot s;
+	s.tick = ticks;
+	s.position = body.position;
+	s.selected = picked.hit;
+	s.selectedBlock = picked.block;
+	s.selectedFace = picked.face;
+	if (digging) s.digProgress = (float)std::min(1.0, (ticks - digStartTick) * TICK / DIG_SECONDS);
+	s.entityBoxes.reserve(entities.Size() * 2);
+	for (size_t n = 0; n < entities.Size(); ++n) {
+		s.entityBoxes.push_back(entities.Position(n));
+		s.entityBoxes.push_back(entities.Extent(n));
+	}
+
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	previous = std::move(latest);
+	latest = std::move(s);
+}
+
+void Simulation::pick(const glm::vec3& eye, const glm::vec3& dir) {
+	picked = raycaster.Cast(Ray(eye, dir), PICK_REACH);
+}
+
+void Simulation::dig(bool mouseHeld) {
+	if (!mouseHeld || !picked.hit) {
+		digging = false;
+		return;
+	}
+	if (!digging || picked.block != digBlock) {
+		// the timer restarts whenever the picked block changes while the mouse is held
+		Chunk* ch = world.GetChunkContainingBlock(picked.block);
+		if (ch) {
+			glm::ivec3 bidx = ch->BlockWorldToGridIdx(picked.block);
+			if (ch->grid[bidx.x][bidx.y][bidx.z]) {
+				digBlock = picked.block;
+				digStartTick = ticks;
+				digging = true;
+				blockTicks.Schedule(digBlock, ticks + digTicks, BlockTicks::DIG);
+			}
+		}
+	}
+}
+
+void Simulation::finishDig(const glm::ivec3& blockIdx) {
+	// the player may have let go, or moved on to another block, since this was scheduled
+	if (!digging || blockIdx != digBlock || ticks - digStartTick < digTicks) return;
+	std::cout << "timer goes off" << std::endl;
+	BlockDB::BlockType type;
+	if (GetBlock(digBlock, type)) {
+		SetBlock(digBlock, BlockDB::BlockType::BLOCK_AIR);
+		dropBlock(digBlock, type);
+	}
+	// holding on digs the block that takes its place
+	digStartTick = ticks;
+	blockTicks.Schedule(digBlock, ticks + digTicks, BlockTicks::DIG);
+}
+
+void Simulation::runBlockTicks() {
+	BlockDB& blockDB = BlockDB::GetInstance();
+	BlockTicks::Event event;
+	for (size_t n = 0; n < BlockTicks::MAX_EVENTS_PER_TICK && blockTicks.PopDue(ticks, event); ++n) {
+		if (event.action == BlockTicks::DIG) {
+			finishDig(event.block);
+			continue;
+		}
+		BlockDB::BlockType type;
+		if (GetBlock(event.block, type) && blockDB.tbl[type].onScheduledTick) blockDB.tbl[type].onScheduledTick(*this, event.block);
+	}
+
+	if (ticks % BlockTicks::RANDOM_TICK_INTERVAL) return;
+	blockTicks.SampleRandomTicks(world, randomTicked);
+	for (const glm::ivec3& blockIdx : randomTicked) {
+		// an earlier handler may have changed the block
+		BlockDB::BlockType type;
+		if (GetBlock(blockIdx, type) && blockDB.tbl[type].onRandomTick) blockDB.tbl[type].onRandomTick(*this, blockIdx);
+	}
+}
+
+void Simulation::dropBlock(const glm::ivec3& blockIdx, BlockDB::BlockType type) {
+	// the block pops out as an item, with a little hop
+	glm::vec3 center(blockIdx);
+	if (type != BlockDB::BlockType::BLOCK_WATER) entities.Spawn(EntityStore::ITEM, center - ITEM_SIZE * 0.5f, { 0.0f, 4.0f, 0.0f }, ITEM_SIZE, type);
+}
+
+void Simulation::settleLandedBlocks() {
+	// a falling block becomes a block again where it landed(replacing water or a flower there),
+	// or an item if that place is taken
+	std::vector<EntityStore::Id> landed = entities.Landed();
+	for (EntityStore::Id id : landed) {
+		size_t slot = entities.SlotOf(id);
+		glm::vec3 center = entities.Position(slot) + entities.Extent(slot) * 0.5f;
+		glm::ivec3 blockIdx = glm::floor(center + 0.5f);
+		BlockDB::BlockType type = entities.block[slot];
+		entities.Despawn(id);
+
+		Chunk* ch = world.GetChunkContainingBlock(blockIdx);
+		if (!ch) continue;
+		if (!ch->IsSolid(ch->BlockWorldToGridIdx(blockIdx))) SetBlock(blockIdx, type);
+		else entities.Spawn(EntityStore::ITEM, center - ITEM_SIZE * 0.5f, glm::vec3(0.0f), ITEM_SIZE, type);
+	}
+}
+
+void Simulation::blockChanged(const glm::ivec3& blockIdx) {
+	water.BlockChanged(blockIdx, ticks);
+	static const glm::ivec3 NEIGHBOURS[6] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+	scheduleBlockTick(blockIdx);
+	for (const glm::ivec3& n : NEIGHBOURS) scheduleBlockTick(blockIdx + n);
+}
+
+void Simulation::scheduleBlockTick(const glm::ivec3& blockIdx) {
+	BlockDB::BlockType type;
+	if (!GetBlock(blockIdx, type)) return;
+	const BlockDB::BlockDataRow& row = BlockDB::GetInstance().tbl[type];
+	if (row.onScheduledTick) blockTicks.Schedule(blockIdx, ticks + row.tickDelay, BlockTicks::BLOCK_TICK);
+}
+
+bool Simulation::GetBlock(const glm::ivec3& blockIdx, BlockDB::BlockType& type) {
+	Chunk* ch = world.GetChunkContainingBlock(blockIdx);
+	if (!ch || !ch->initialized) return false;
+	glm::ivec3 bidx = ch->BlockWorldToGridIdx(blockIdx);
+	type = ch->grid[bidx.x][bidx.y][bidx.z];
+	return true;
+}
+
+void Simulation::SetBlock(const glm::ivec3& blockIdx, BlockDB::BlockType type) {
+	BlockEdit edit{ blockIdx, type };
+	SetBlocks(&edit, 1);
+}
+
+void Simulation::SetBlocks(const BlockEdit* edits, size_t count) {
+	// an undecorated chunk would have the edit overwritten by its trees, and not journaled
+	applied.clear();
+	BlockDB::BlockType type;
+	for (size_t n = 0; n < count; ++n) {
+		if (GetBlock(edits[n].block, type)) applied.push_back(edits[n]);
+	}
+	touched.clear();
+	world.ApplyEdits(applied, touched);
+	for (const glm::ivec3& chunkIdx : touched) markChunkDirty(chunkIdx);
+	for (const BlockEdit& edit : applied) blockChanged(edit.block);
+}
+
+int Simulation::SkyLightAt(const glm::ivec3& blockIdx) {
+	Chunk* ch = world.GetChunkContainingBlock(blockIdx);
+	if (!ch || !ch->lit) return 0;
+	glm::ivec3 bidx = ch->BlockWorldToGridIdx(blockIdx);
+	return ch->skyLight[bidx.x][bidx.y][bidx.z];
+}
+
+/// BLOCK BEHAVIOURS
+
+static constexpr int SAND_FALL_DELAY = 2; //ticks
+static constexpr int GRASS_LIGHT = 9; //dirt needs this much sky light above it to grow grass
+static constexpr int FOLIAGE_REACH = 4; //foliage decays without a log this close(in every axis)
+
+static void sandTick(Simulation& sim, const glm::ivec3& blockIdx) {
+	// sand with nothing to rest on falls, as an entity that becomes a block again where it lands(settleLandedBlocks)
+	BlockDB::BlockType below;
+	if (!sim.GetBlock(blockIdx - glm::ivec3(0, 1, 0), below) || BlockDB::GetInstance().collides(below)) return;
+	sim.SetBlock(blockIdx, BlockDB::BlockType::BLOCK_AIR);
+	sim.entities.Spawn(EntityStore::FALLING_BLOCK, glm::vec3(blockIdx) - Simulation::FALLING_BLOCK_SIZE * 0.5f, glm::vec3(0.0f),
+		Simulation::FALLING_BLOCK_SIZE, BlockDB::BlockType::BLOCK_SAND);
+}
+
+static void dirtRandomTick(Simulation& sim, const glm::ivec3& blockIdx) {
+	// grass spreads to dirt under the open sky, from next to it or a block up or down
+	glm::ivec3 above = blockIdx + glm::ivec3(0, 1, 0);
+	BlockDB::BlockType type;
+	if (!sim.GetBlock(above, type) || BlockDB::GetInstance().isOpaqueCube(type) || sim.SkyLightAt(above) < GRASS_LIGHT) return;
+	for (int x = -1; x <= 1; ++x) {
+		for (int y = -1; y <= 1; ++y) {
+			for (int z = -1; z <= 1; ++z) {
+				if (sim.GetBlock(blockIdx + glm::ivec3(x, y, z), type) && type == BlockDB::BlockType::BLOCK_GRASS) {
+					sim.SetBlock(blockIdx, BlockDB::BlockType::BLOCK_GRASS);
+					return;
+				}
+			}
+		}
+	}
+}
+
+static void grassRandomTick(Simulation& sim, const glm::ivec3& blockIdx) {
+	// and dies under a block
+	BlockDB::BlockType above;
+	if (sim.GetBlock(blockIdx + glm::ivec3(0, 1, 0), above) && BlockDB::GetInstance().isOpaqueCube(above)) sim.SetBlock(blockIdx, BlockDB::BlockType::BLOCK_DIRT);
+}
+
+static void foliageRandomTick(Simulation& sim, const glm::ivec3& blockIdx) {
+	// foliage whose tree was cut down decays. a block that can't be read might be a log, so the foliage stays.
+	BlockDB::BlockType type;
+	for (int x = -FOLIAGE_REACH; x <= FOLIAGE_REACH; ++x) {
+		for (int y = -FOLIAGE_REACH; y <= FOLIAGE_REACH; ++y) {
+			for (int z = -FOLIAGE_REACH; z <= FOLIAGE_REACH; ++z) {
+				if (!sim.GetBlock(blockIdx + glm::ivec3(x, y, z), type)) return;
+				if (type == BlockDB::BlockType::BLOCK_BIRCH_LOG || type == BlockDB::BlockType::BLOCK_ELM_LOG) return;
+			}
+		}
+	}
+	sim.SetBlock(blockIdx, BlockDB::BlockType::BLOCK_AIR);
+}
+
+void Simulation::registerBlockBehaviours() {
+	BlockDB& blockDB = BlockDB::GetInstance();
+	blockDB.SetScheduledTick(BlockDB::BlockType::BLOCK_SAND, sandTick, SAND_FALL_DELAY);
+	blockDB.SetRandomTick(BlockDB::BlockType::BLOCK_DIRT, dirtRandomTick);
+	blockDB.SetRandomTick(BlockDB::BlockType::BLOCK_GRASS, grassRandomTick);
+	blockDB.SetRandomTick(BlockDB::BlockType::BLOCK_FOILAGE, foliageRandomTick);
+}
+
+void Simulation::markChunkDirty(const glm::ivec3& chunkIdx) {
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	if (std::find(dirtyChunks.begin(), dirtyChunks.end(), chunkIdx) == dirtyChunks.end()) dirtyChunks.push_back(chunkIdx);
+}
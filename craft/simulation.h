@@ -0,0 +1,148 @@
+#pragma once
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "camera.h"
+#include "entities.h"
+#include "raycaster.h"
+#include "water.h"
+#include "blockticks.h"
+
+class World;
+
+/*
+the game state advanced in ticks of TICK seconds, independent of the frame rate:
+the player's movement and collision, picking and digging blocks, the entities, the flowing water,
+and the blocks' own behaviour(BlockTicks, with the handlers registered in BlockDB).
+the simulation owns every change to the blocks of the world. a tick holds World::mutex,
+which the render thread also holds while it streams, rebuilds and recycles chunks.
+
+the render thread hands over the player's input with SetInput(), and reads back the state of the
+last two ticks with View(), which interpolates the player's position between them.
+the ticks run either
+	- on a thread of their own, in real time: Start() and Stop(),
+	- or on the calling thread, as many as a time step covers: Advance(). replays and fixed step runs
+	  use it so a run is repeated exactly.
+*/
+class Simulation {
+public:
+	static constexpr double TICK = 1.0 / 60.0;
+	// a thread that falls further behind than this skips the missed ticks instead of catching up
+	static constexpr int MAX_CATCH_UP_TICKS = 10;
+	static constexpr double DIG_SECONDS = 2.0; //holding the mouse on a block this long destroys it
+	static constexpr float PICK_REACH = 20.0f; //blocks farther than this from the player can't be picked
+	static inline const glm::vec3 PLAYER_SIZE{ 1.0f, 2.0f, 1.0f };
+	static inline const glm::vec3 EYE_OFFSET{ 0.5f, 1.5f, 0.5f }; //from the minimum corner of the player's AABB
+	// a falling block is a little smaller than a block so it fits down a one block shaft.
+	static inline const glm::vec3 ITEM_SIZE{ 0.25f }, FALLING_BLOCK_SIZE{ 0.98f };
+
+	// the player's intent, sampled by the render thread
+	struct Input {
+		bool forward = false, backward = false, left = false, right = false;
+		float yaw = 0.0f, pitch = 0.0f;
+		glm::vec3 pickDir{ 0.0f, 0.0f, -1.0f }; //the ray under the mouse cursor
+		bool mouseHeld = false;
+	};
+
+	// the state after a tick, for the render thread
+	struct Snapshot {
+		uint64_t tick = 0;
+		glm::vec3 position{ 0.0f }; //of the player's eye
+		bool selected = false; //a block is picked
+		glm::ivec3 selectedBlock{ 0 };
+		int selectedFace = -1;
+		float digProgress = -1.0f; //[0, 1] while digging the picked block, -1 otherwise
+		std::vector<glm::vec3> entityBoxes; //minimum corner and size of every entity, in pairs
+	};
+
+	EntityStore entities;
+	WaterFlow water;
+
+	explicit Simulation(World& world);
+	~Simulation() { Stop(); }
+
+	// puts the player's eye at position, and clears the snapshots.
+	void Reset(const glm::vec3& position);
+	void SetInput(const Input& input);
+
+	// runs the ticks dt seconds cover, on the calling thread.
+	void Advance(double dt);
+	void Start();
+	void Stop();
+	bool IsThreaded() const { return threaded; }
+
+	// the latest snapshot, its position interpolated from the snapshot before by how far the clock is past it.
+	Snapshot View() const;
+	// chunks whose blocks changed since the last call, to be rebuilt
+	std::vector<glm::ivec3> TakeDirtyChunks();
+
+	// mean time a tick took so far, in milliseconds
+	double MeanTickMs() const;
+
+	// for the block tick handlers, during a tick
+	// false if the block's chunk isn't loaded and decorated
+	bool GetBlock(const glm::ivec3& blockIdx, BlockDB::BlockType& type);
+	// changes the block, and lets the blocks and water around it react
+	void SetBlock(const glm::ivec3& blockIdx, BlockDB::BlockType type);
+	// changes many blocks as one batch(World::ApplyEdits), so each chunk they touch is remeshed once. for explosions
+	// and structures. edits to chunks that aren't loaded and decorated are dropped.
+	void SetBlocks(const BlockEdit* edits, size_t count);
+	void SetBlocks(const std::vector<BlockEdit>& edits) { SetBlocks(edits.data(), edits.size()); }
+	// sky light at the block, 0 if its chunk isn't lit
+	int SkyLightAt(const glm::ivec3& blockIdx);
+
+private:
+	void tick();
+	void publish();
+	double clock() const; //seconds of simulated time the render thread is at
+	void pick(const glm::vec3& eye, const glm::vec3& dir);
+	void dig(bool mouseHeld);
+	void finishDig(const glm::ivec3& blockIdx);
+	void runBlockTicks();
+	void scheduleBlockTick(const glm::ivec3& blockIdx);
+	static void registerBlockBehaviours();
+	void dropBlock(const glm::ivec3& blockIdx, BlockDB::BlockType type);
+	void settleLandedBlocks();
+	void markChunkDirty(const glm::ivec3& chunkIdx);
+	// every block the simulation changes(SetBlocks) goes through here, so the blocks and water around it follow
+	void blockChanged(const glm::ivec3& blockIdx);
+
+	World& world;
+	VoxelRaycaster raycaster;
+
+	// tick state, owned by whichever thread runs the ticks
+	uint64_t ticks = 0;
+	double accumulator = 0.0; //time Advance() was given that no tick used yet
+	Camera body; //the player's eye and orientation
+	glm::vec3 lastPosition{ 0.0f };
+	VoxelRaycaster::Hit picked;
+	bool digging = false;
+	glm::ivec3 digBlock{ 0 };
+	uint64_t digStartTick = 0;
+	uint64_t digTicks; //the first whole number of ticks longer than DIG_SECONDS
+	BlockTicks blockTicks;
+	std::vector<glm::ivec3> randomTicked; //reused
+	std::vector<BlockEdit> applied; //reused by SetBlocks
+	std::vector<glm::ivec3> touched;
+	double tickMsTotal = 0.0;
+
+	mutable std::mutex inputMutex;
+	Input input;
+
+	mutable std::mutex snapshotMutex;
+	Snapshot previous, latest;
+	std::vector<glm::ivec3> dirtyChunks;
+
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> threaded{ false }; //the thread runs the ticks. unlike thread.joinable(), safe to read from the thread itself
+	std::atomic<double> threadEpoch{ 0.0 }; //steady clock seconds at which the thread's clock read 0
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "streaming.h"
+#include "world.h"
+#include "profiler.h"
+#include <limits>
+
+void ChunkStreamer::Request(const p3i& idx) {
+	for (const Task& t : pending) {
+		if (t.idx == idx) return;
+	}
+	pending.push_back({ idx, 0.0f });
+}
+
+ChunkStreamer::Stage ChunkStreamer::stageOf(World& world, const p3i& idx) {
+	Chunk* chunk = world.visChunks.Find(idx);
+	if (!chunk) return GENERATE;
+	if (!chunk->initialized) return DECORATE;
+	if (!chunk->isBuilt) return MESH;
+	return DONE;
+}
+
+bool ChunkStreamer::isReady(World& world, const p3i& idx, Stage stage) {
+	if (stage == GENERATE) return true;
+
+	// decoration writes into any of the 26 neighbours, and meshing reads them.
+	// so decorating waits for the neighbours to exist, and meshing waits for them to be decorated.
+	// neighbours outside the window will never be streamed and are not waited for.
+	auto [x, y, z] = idx;
+	for (int dx = -1; dx <= 1; ++dx) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dz = -1; dz <= 1; ++dz) {
+				p3i nidx{ x + dx, y + dy, z + dz };
+				if (!world.IsInViewWindow(nidx)) continue;
+				Chunk* neighbour = world.visChunks.Find(nidx);
+				if (!neighbour) return false;
+				if (stage == MESH && !neighbour->initialized) return false;
+			}
+		}
+	}
+	return true;
+}
+
+void ChunkStreamer::runStage(World& world, const p3i& idx, Stage stage) {
+	switch (stage) {
+	case GENERATE: {
+		PROFILE_ZONE("stream: generate");
+		world.LoadChunk(idx);
+		break;
+	}
+	case DECORATE: {
+		PROFILE_ZONE("stream: decorate");
+		world.DecorateChunk(*world.visChunks.Find(idx));
+		break;
+	}
+	case MESH: {
+		PROFILE_ZONE("stream: mesh");
+		world.visChunks.Find(idx)->Build();
+		break;
+	}
+	case DONE:
+		break;
+	}
+}
+
+void ChunkStreamer::prioritize(World& world, const glm::vec3& cameraPos, const Frustum& frustum) {
+	// drop chunks that left the window before they were finished
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [&world](const Task& t) {
+		return !world.IsInViewWindow(t.idx);
+	}), pending.end());
+
+	for (Task& t : pending) {
+		auto [x, y, z] = t.idx;
+		glm::vec3 mn = glm::vec3(x * Chunk::SZ, y * Chunk::HEIGHT, z * Chunk::SZ) - 0.5f;
+		glm::vec3 mx = mn + glm::vec3(Chunk::SZ, Chunk::HEIGHT, Chunk::SZ);
+		t.priority = glm::length(0.5f * (mn + mx) - cameraPos);
+		if (!frustum.TestAABB(mn, mx)) t.priority += outOfViewPenalty;
+	}
+	std::sort(pending.begin(), pending.end(), [](const Task& a, const Task& b) { return a.priority < b.priority; });
+}
+
+void ChunkStreamer::run(World& world, const glm::vec3& cameraPos, const Frustum& frustum, double budget, size_t taskLimit) {
+	PROFILE_ZONE("ChunkStreamer::Run");
+	auto begin = std::chrono::steady_clock::now();
+	lastFrame = Stats();
+	prioritize(world, cameraPos, frustum);
+	size_t tasks = 0;
+	auto spent = [&]() {
+		if (taskLimit != 0) return tasks >= taskLimit;
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count() >= budget;
+	};
+
+	while (!pending.empty()) {
+		// run the nearest task that is ready, then start over from the nearest,
+		// because finishing a stage can make nearer chunks ready.
+		bool progressed = false;
+		for (size_t n = 0; n < pending.size(); ++n) {
+			Stage stage = stageOf(world, pending[n].idx);
+			if (stage == DONE) {
+				pending.erase(pending.begin() + n--);
+				continue;
+			}
+			if (!isReady(world, pending[n].idx, stage)) continue;
+
+			runStage(world, pending[n].idx, stage);
+			tasks++;
+			if (stage == GENERATE) lastFrame.generated++;
+			else if (stage == DECORATE) lastFrame.decorated++;
+			else if (stage == MESH) lastFrame.meshed++;
+			if (stageOf(world, pending[n].idx) == DONE) pending.erase(pending.begin() + n);
+			progressed = true;
+			break;
+		}
+		if (!progressed) break;
+		if (spent()) break;
+	}
+
+	// background work with whatever budget is left
+	size_t n = 0;
+	for (; n < prefetch.size(); ++n) {
+		if (spent()) break;
+		PROFILE_ZONE("stream: prefetch");
+		if (world.PrefetchChunk(prefetch[n])) lastFrame.prefetched++;
+		tasks++;
+	}
+	prefetch.erase(prefetch.begin(), prefetch.begin() + n);
+
+	lastFrame.pending = pending.size();
+	lastFrame.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void ChunkStreamer::Run(World& world, const glm::vec3& cameraPos, const Frustum& frustum) {
+	run(world, cameraPos, frustum, budgetMs, taskBudget);
+}
+
+void ChunkStreamer::Flush(World& world, const glm::vec3& cameraPos, const Frustum& frustum) {
+	run(world, cameraPos, frustum, std::numeric_limits<double>::infinity(), 0);
+}
+
+//-------- ChunkPrefetcher
+
+void ChunkPrefetcher::Update(const glm::vec3& pos, const glm::vec3& dir, float dt) {
+	if (hasHistory && dt > 0.0f) {
+		// exponential smoothing, so a single jittery frame does not swing the prediction
+		glm::vec3 v = (pos - position) / dt;
+		float alpha = std::min(1.0f, dt / 0.25f);
+		velocity = glm::mix(velocity, v, alpha);
+	}
+	position = pos;
+	front = dir;
+	hasHistory = true;
+}
+
+void ChunkPrefetcher::Predict(World& world, int maxAhead, std::vector<p3i>& out) const {
+	out.clear();
+	float speed = glm::length(velocity);
+	if (speed < minSpeed) return;
+
+	const glm::ivec3 center = world.centerChunkIdx;
+	glm::ivec3 considered[2] = { center, center }; //consecutive samples mostly fall in the same chunk
+	auto consider = [&](const glm::vec3& p, int path) {
+		glm::ivec3 c = Chunk::WorldToChunkIndex(p);
+		c.x = std::clamp(c.x, center.x - maxAhead, center.x + maxAhead);
+		c.z = std::clamp(c.z, center.z - maxAhead, center.z + maxAhead);
+		c.y = std::clamp(c.y, center.y - maxAhead, center.y + maxAhead);
+		if (c == considered[path]) return;
+		considered[path] = c;
+		for (int i = c.x - world.viewRadius; i <= c.x + world.viewRadius; ++i) {
+			for (int k = c.z - world.viewRadius; k <= c.z + world.viewRadius; ++k) {
+				for (int j = c.y - world.viewHeightRadius; j <= c.y + world.viewHeightRadius; ++j) {
+					p3i idx{ i, j, k };
+					if (world.IsInViewWindow(idx) || world.allChunks.Find(idx)) continue;
+					if (std::find(out.begin(), out.end(), idx) != out.end()) continue;
+					out.push_back(idx);
+				}
+			}
+		}
+	};
+
+	// where the camera goes if it keeps moving, and where it goes if it turns to where it is looking.
+	for (float t = sampleSec; t <= lookaheadSec; t += sampleSec) {
+		consider(position + velocity * t, 0);
+		consider(position + front * (speed * t), 1);
+	}
+}
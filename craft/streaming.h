@@ -0,0 +1,120 @@
+#pragma once
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <vector>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "chunkindex.h"
+#include "frustum.h"
+
+class World;
+
+/*
+brings chunks of the visible window up to a renderable state a little at a time.
+a chunk passes three stages, each one a task for the scheduler:
+	GENERATE	terrain from the world maps
+	DECORATE	trees and flowers, which may spill into horizontal neighbours, then replayed edits
+	MESH		faces, which are culled against horizontal neighbours
+a stage only runs once the neighbours inside the window have finished the stage before it.
+every frame the pending chunks are ordered by distance to the camera, chunks outside the view frustum
+counting as farther away, and tasks run nearest-first until the frame's time budget is spent.
+*/
+class ChunkStreamer {
+public:
+	using p3i = ChunkIndex::p3i;
+
+	enum Stage {
+		GENERATE, DECORATE, MESH, DONE
+	};
+
+	struct Task {
+		p3i idx;
+		float priority; //smaller runs first
+	};
+
+	struct Stats {
+		int generated = 0, decorated = 0, meshed = 0, prefetched = 0;
+		size_t pending = 0; //chunks still waiting after the frame
+		double elapsedMs = 0.0;
+	};
+
+	// time spent on streaming per frame. at least one task runs every frame regardless.
+	double budgetMs = 4.0;
+	// if not 0, the budget is this many tasks per frame instead of budgetMs, so the work done in a frame
+	// does not depend on the machine. replayed runs use it to stay deterministic.
+	size_t taskBudget = 0;
+
+	// a chunk behind the camera waits as if it were this many blocks farther away.
+	float outOfViewPenalty = 64.0f;
+
+	// requests idx to be streamed in. requesting a chunk twice has no effect.
+	void Request(const p3i& idx);
+	void Clear() { pending.clear(); prefetch.clear(); }
+
+	// chunks to generate ahead of time, most urgent first. replaces the previous list.
+	// they only run with the budget left after every ready task of the view window.
+	void SetPrefetch(const std::vector<p3i>& chunks) { prefetch = chunks; }
+	size_t Pending() const { return pending.size(); }
+
+	// runs tasks until the budget is spent or nothing is ready.
+	void Run(World& world, const glm::vec3& cameraPos, const Frustum& frustum);
+	// runs every pending task, regardless of the budget.
+	void Flush(World& world, const glm::vec3& cameraPos, const Frustum& frustum);
+
+	const Stats& LastFrameStats() const { return lastFrame; }
+
+private:
+	static Stage stageOf(World& world, const p3i& idx);
+	static bool isReady(World& world, const p3i& idx, Stage stage);
+	static void runStage(World& world, const p3i& idx, Stage stage);
+	void prioritize(World& world, const glm::vec3& cameraPos, const Frustum& frustum);
+	// taskLimit 0 means the budget is in milliseconds
+	void run(World& world, const glm::vec3& cameraPos, const Frustum& frustum, double budget, size_t taskLimit);
+
+	std::vector<Task> pending;
+	std::vector<p3i> prefetch;
+	Stats lastFrame;
+};
+
+/*
+guesses which chunks are about to enter the view window from the camera's motion.
+the camera's velocity is smoothed over frames and extrapolated, along with its look direction,
+over the next few seconds. chunks of the windows around the extrapolated positions that are
+not generated yet are handed to the streamer as background work.
+*/
+class ChunkPrefetcher {
+public:
+	using p3i = ChunkIndex::p3i;
+
+	struct Stats {
+		size_t needed = 0; //chunks that entered the view window
+		size_t ready = 0; //of those, chunks that were already generated
+		float HitRate() const { return needed ? (float)ready / needed : 0.0f; }
+	};
+
+	float lookaheadSec = 2.0f;
+	float sampleSec = 0.25f;
+	float minSpeed = 1.0f; //blocks per second. slower cameras are not predicted.
+
+	// feeds the current camera state, once per frame. dt is the frame's time step, so replays and fixed step runs
+	// predict the same path whatever the machine's speed.
+	void Update(const glm::vec3& position, const glm::vec3& front, float dt);
+
+	// chunks around the predicted path that do not exist in world yet, earliest first.
+	// predictions are clamped to maxAhead chunks from the current window center.
+	void Predict(World& world, int maxAhead, std::vector<p3i>& out) const;
+
+	void RecordNeed(bool wasReady) { stats.needed++; if (wasReady) stats.ready++; }
+	void ResetStats() { stats = Stats(); }
+	const Stats& GetStats() const { return stats; }
+
+	glm::vec3 velocity{ 0.0f };
+
+private:
+	glm::vec3 position{ 0.0f }, front{ 0.0f, 0.0f, -1.0f };
+	bool hasHistory = false;
+	Stats stats;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+/*
+the tests are small executables that CHECK what they expect and return the number of failed checks,
+so ctest reports any of them failing. they run headless, on the CPU side of the code they test.
+*/
+namespace Check {
+	inline int& Failures() {
+		static int failures = 0;
+		return failures;
+	}
+}
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::cout << "ERROR::TEST::CHECK_FAILED: " << #cond << " at " << __FILE__ << ":" << __LINE__ << std::endl; \
+			Check::Failures()++; \
+		} \
+	} while (0)
+
+#endif
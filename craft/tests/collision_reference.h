@@ -0,0 +1,129 @@
+#pragma once
+#ifndef COLLISION_REFERENCE_H
+#define COLLISION_REFERENCE_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "../collision.h"
+
+/*
+the collision solver as it was before it walked the voxels directly, kept to check the new one against:
+the solid blocks of the broadphase box gathered into a vector, every box swept, and the entries sorted.
+ties in the sort go to the box gathered first, which is what the voxel walk does. the old std::sort left them unspecified.
+*/
+namespace CollisionReference {
+	using namespace Collision;
+
+	inline Collision::Collision GetFirstHit(glm::vec3 start_pos, glm::vec3 end_pos, glm::vec3 box_dim, const std::vector<AABB>& boxes) {
+		glm::vec3 velocity = end_pos - start_pos;
+		using entry_pair = std::pair<float, EntryEvent>;
+		std::vector<entry_pair> entry_events;
+		for (const auto& box : boxes) {
+			// distances
+			float x_entry, y_entry, z_entry;
+			float x_exit, y_exit, z_exit;
+			// time, as proportion of velocity
+			float xt_entry, yt_entry, zt_entry;
+			float xt_exit, yt_exit, zt_exit;
+
+			if (velocity.x > 0.0f) {
+				x_entry = box.start.x - (start_pos.x + box_dim.x);
+				x_exit = (box.start.x + box.scale.x) - start_pos.x;
+			}
+			else {
+				x_entry = (box.start.x + box.scale.x) - start_pos.x;
+				x_exit = box.start.x - (start_pos.x + box_dim.x);
+			}
+			if (velocity.y > 0.0f) {
+				y_entry = box.start.y - (start_pos.y + box_dim.y);
+				y_exit = (box.start.y + box.scale.y) - start_pos.y;
+			}
+			else {
+				y_entry = (box.start.y + box.scale.y) - start_pos.y;
+				y_exit = box.start.y - (start_pos.y + box_dim.y);
+			}
+			if (velocity.z > 0.0f) {
+				z_entry = box.start.z - (start_pos.z + box_dim.z);
+				z_exit = (box.start.z + box.scale.z) - start_pos.z;
+			}
+			else {
+				z_entry = (box.start.z + box.scale.z) - start_pos.z;
+				z_exit = box.start.z - (start_pos.z + box_dim.z);
+			}
+			if (velocity.x == 0.0f) {
+				if (start_pos.x >= box.start.x + box.scale.x || start_pos.x + box_dim.x <= box.start.x) xt_entry = std::numeric_limits<float>::infinity();
+				else xt_entry = -std::numeric_limits<float>::infinity();
+				xt_exit = std::numeric_limits<float>::infinity();
+			}
+			else {
+				xt_entry = x_entry / velocity.x;
+				xt_exit = x_exit / velocity.x;
+			}
+			if (velocity.y == 0.0f) {
+				if (start_pos.y >= box.start.y + box.scale.y || start_pos.y + box_dim.y <= box.start.y) yt_entry = std::numeric_limits<float>::infinity();
+				else yt_entry = -std::numeric_limits<float>::infinity();
+				yt_exit = std::numeric_limits<float>::infinity();
+			}
+			else {
+				yt_entry = y_entry / velocity.y;
+				yt_exit = y_exit / velocity.y;
+			}
+			if (velocity.z == 0.0f) {
+				if (start_pos.z >= box.start.z + box.scale.z || start_pos.z + box_dim.z <= box.start.z) zt_entry = std::numeric_limits<float>::infinity();
+				else zt_entry = -std::numeric_limits<float>::infinity();
+				zt_exit = std::numeric_limits<float>::infinity();
+			}
+			else {
+				zt_entry = z_entry / velocity.z;
+				zt_exit = z_exit / velocity.z;
+			}
+			float entryTime = std::max({ xt_entry, yt_entry, zt_entry });
+			float exitTime = std::min({ xt_exit, yt_exit, zt_exit });
+			if (entryTime >= exitTime || entryTime < -0.0f || entryTime > 1.0f || exitTime < 0.0f) continue;
+			entry_events.push_back({ entryTime, { x_entry, y_entry, z_entry, xt_entry, yt_entry, zt_entry, box.blkTy } });
+		}
+
+		Collision::Collision col;
+		col.vel = velocity;
+		if (entry_events.empty()) {
+			col.time = -1.0f;
+			col.stop_pos = end_pos;
+			col.normal = { 0.0f, 0.0f, 0.0f };
+			col.remain_vel = { 0.0f, 0.0f, 0.0f };
+			return col;
+		}
+		std::stable_sort(entry_events.begin(), entry_events.end(), [](const entry_pair& a, const entry_pair& b) { return a.first < b.first; });
+		auto [entryTime, entry] = entry_events[0];
+		col.time = entryTime;
+		col.stop_pos = start_pos + velocity * entryTime;
+		col.remain_vel = velocity * (1.0f - entryTime);
+		col.normal = CollisionCheck::GetHitNormal(entry);
+		float dotp = col.normal.x * col.remain_vel.x + col.normal.y * col.remain_vel.y + col.normal.z * col.remain_vel.z;
+		col.remain_vel = col.remain_vel - dotp * col.normal;
+		return col;
+	}
+
+	// the old updatePositionWithCollisionCheck, over isSolid(x, y, z) instead of the world
+	template<typename IsSolid>
+	glm::vec3 Slide(glm::vec3 begin, glm::vec3 end, glm::vec3 box_dim, IsSolid&& isSolid) {
+		CollisionCheck checker(begin, end, box_dim);
+		AABB swAABB = checker.ComputeBroadphaseAABB();
+		std::vector<AABB> colliders;
+		int endx = (int)(swAABB.start.x + swAABB.scale.x + 0.5f);
+		int endy = (int)(swAABB.start.y + swAABB.scale.y + 0.5f);
+		int endz = (int)(swAABB.start.z + swAABB.scale.z + 0.5f);
+		for (int x = (int)(swAABB.start.x - 0.5f); x <= endx; ++x) {
+			for (int y = (int)(swAABB.start.y - 0.5f); y <= endy; ++y) {
+				for (int z = (int)(swAABB.start.z - 0.5f); z <= endz; ++z) {
+					if (isSolid(x, y, z)) colliders.push_back({ { x - 0.5f, y - 0.5f, z - 0.5f }, { 1.0f, 1.0f, 1.0f }, BlockDB::BlockType::BLOCK_COUNT });
+				}
+			}
+		}
+		Collision::Collision col = GetFirstHit(begin, end, box_dim, colliders);
+		for (int sweep = 1; sweep < 3; ++sweep) col = GetFirstHit(col.stop_pos, col.stop_pos + col.remain_vel, box_dim, colliders);
+		return col.stop_pos + col.remain_vel;
+	}
+}
+
+#endif
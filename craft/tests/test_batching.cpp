@@ -0,0 +1,114 @@
+#include "check.h"
+#include "../batching.h"
+#include "../headlessgl.h"
+
+/*
+the CPU side of batched chunk drawing: the range allocator behind the arena's buffers,
+the command lists, and the arena's bookkeeping over HeadlessGL.
+*/
+
+static void testRangeAllocator() {
+	RangeAllocator ranges(100);
+	size_t a, b, c, d;
+	CHECK(ranges.Allocate(30, OUT a) && a == 0);
+	CHECK(ranges.Allocate(30, OUT b) && b == 30);
+	CHECK(ranges.Allocate(30, OUT c) && c == 60);
+	CHECK(ranges.Used() == 90);
+	CHECK(!ranges.Allocate(20, OUT d)); //only 10 left
+
+	// first fit reuses the hole, and freeing merges the ranges back
+	ranges.Free(b, 30);
+	CHECK(ranges.Allocate(20, OUT d) && d == 30);
+	ranges.Free(d, 20);
+	ranges.Free(a, 30);
+	CHECK(ranges.FreeRanges().size() == 2);
+	CHECK(ranges.FreeRanges()[0].offset == 0 && ranges.FreeRanges()[0].size == 60);
+	ranges.Free(c, 30);
+	CHECK(ranges.FreeRanges().size() == 1 && ranges.FreeRanges()[0].size == 100);
+	CHECK(ranges.Used() == 0);
+
+	// growing appends free space, merged with a free range at the end
+	CHECK(ranges.Allocate(100, OUT a) && a == 0);
+	ranges.Grow(150);
+	CHECK(ranges.Capacity() == 150);
+	CHECK(ranges.Allocate(50, OUT b) && b == 100);
+	ranges.Free(a, 100);
+	ranges.Free(b, 50);
+	ranges.Grow(200);
+	CHECK(ranges.FreeRanges().size() == 1 && ranges.FreeRanges()[0].size == 200);
+}
+
+static void testDrawCommandList() {
+	DrawCommandList cmds;
+	cmds.Add(MeshAllocation{ 10, 4, 6, 6 });
+	cmds.Add(MeshAllocation{}); //empty meshes are not drawn
+	cmds.Add(MeshAllocation{ 100, 8, 12, 12 });
+	CHECK(cmds.size() == 2);
+	CHECK(cmds.counts[0] == 6 && cmds.counts[1] == 12);
+	CHECK((size_t)cmds.offsets[0] == 6 * sizeof(GLuint) && (size_t)cmds.offsets[1] == 12 * sizeof(GLuint));
+	CHECK(cmds.baseVertices[0] == 10 && cmds.baseVertices[1] == 100);
+	cmds.Clear();
+	CHECK(cmds.empty());
+}
+
+// a quad of 4 vertices and 6 indices, relative to its first vertex
+static void quad(std::vector<GLfloat>& vtx, std::vector<GLfloat>& uv, std::vector<GLuint>& idx, size_t quads) {
+	vtx.assign(quads * 4 * 3, 0.0f);
+	uv.assign(quads * 4 * 3, 0.0f);
+	idx.clear();
+	for (GLuint q = 0; q < quads; ++q) {
+		for (GLuint i : { 0u, 1u, 2u, 2u, 3u, 0u }) idx.push_back(4 * q + i);
+	}
+}
+
+static void testMeshArena() {
+	MeshArena& arena = MeshArena::GetInstance();
+	std::vector<GLfloat> vtx, uv;
+	std::vector<GLuint> idx;
+	MeshAllocation first, second, empty;
+
+	quad(vtx, uv, idx, 1);
+	arena.Upload(vtx, uv, idx, OUT first);
+	quad(vtx, uv, idx, 2);
+	arena.Upload(vtx, uv, idx, OUT second);
+	quad(vtx, uv, idx, 0);
+	arena.Upload(vtx, uv, idx, OUT empty);
+	CHECK(first.vertexCnt == 4 && first.indexCnt == 6);
+	CHECK(second.vertexCnt == 8 && second.indexCnt == 12);
+	CHECK(second.firstVertex == first.firstVertex + 4 && second.firstIndex == first.firstIndex + 6);
+	CHECK(empty.indexCnt == 0);
+
+	// a mesh bigger than the free space grows the buffers, and the meshes already there keep their place
+	quad(vtx, uv, idx, MeshArena::INITIAL_VERTICES / 4);
+	MeshAllocation big;
+	arena.Upload(vtx, uv, idx, OUT big);
+	CHECK(arena.VertexCapacity() >= MeshArena::INITIAL_VERTICES + 12);
+	CHECK(big.firstVertex >= second.firstVertex + 8);
+	CHECK(second.firstVertex == first.firstVertex + 4);
+
+	// one call draws every mesh of a list
+	GLuint program = glCreateProgram();
+	glLinkProgram(program);
+	glUseProgram(program);
+	DrawCommandList cmds;
+	cmds.Add(first), cmds.Add(second), cmds.Add(empty), cmds.Add(big);
+	arena.Draw(cmds);
+	arena.Draw(DrawCommandList());
+	arena.EndFrame();
+	CHECK(arena.LastFrameStats().drawCalls == 1);
+	CHECK(arena.LastFrameStats().commands == 3);
+	HeadlessGL::GetInstance().EndFrame();
+	CHECK(HeadlessGL::GetInstance().LastFrameStats().drawCommands == 3);
+
+	arena.Free(first), arena.Free(second), arena.Free(big);
+	CHECK(first.indexCnt == 0 && second.indexCnt == 0);
+}
+
+int main() {
+	HeadlessGL::GetInstance().Install();
+	testRangeAllocator();
+	testDrawCommandList();
+	testMeshArena();
+	CHECK(HeadlessGL::GetInstance().TotalStats().errors == 0);
+	return Check::Failures();
+}
@@ -0,0 +1,143 @@
+#include <random>
+#include <cstring>
+#include "check.h"
+#include "collision_reference.h"
+#include "../world.h"
+#include "../camera.h"
+#include "../headlessgl.h"
+
+/*
+Collision::SlideThroughVoxels against the solver it replaced(collision_reference.h), bit for bit, on random motions
+through random voxels, plus a few motions whose outcome is known, and the rows SolidRows reads from the world
+against its blocks.
+*/
+
+// the game defines the camera in main.cpp
+Camera Camera::MainCamera = Camera(glm::vec3(0.0f, 4.0f, 0.0f));
+
+static unsigned worldSeed;
+
+// about a third of the blocks are solid, differently for every motion
+static bool randomSolid(int x, int y, int z) {
+	unsigned h = (unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^ (unsigned)z * 83492791u ^ worldSeed;
+	h ^= h >> 13;
+	h *= 0x5bd1e995;
+	h ^= h >> 15;
+	return h % 100 < 35;
+}
+
+// the rows of 32 blocks along z SlideThroughVoxels reads, from a test of one block
+template<typename IsSolid>
+static auto rowsOf(IsSolid isSolid) {
+	return [isSolid](int x, int y, int z) {
+		uint32_t row = 0;
+		for (int i = 0; i < 32; ++i) row |= (uint32_t)isSolid(x, y, z + i) << i;
+		return row;
+	};
+}
+
+static void testRegression() {
+	constexpr int MOTIONS = 300000;
+	const glm::vec3 box(1.0f, 2.0f, 1.0f); //the player
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> place(-40.0f, 40.0f), move(-1.5f, 1.5f), side(-0.5f, 0.5f);
+	size_t collided = 0, differ = 0;
+	for (int n = 0; n < MOTIONS; ++n) {
+		worldSeed = rng();
+		glm::vec3 begin(place(rng), place(rng), place(rng));
+		// starts touching block faces, and starts on the block grid, where ties between blocks happen
+		if (n % 4 == 1) begin = glm::round(begin) + glm::vec3(side(rng) > 0.0f ? 0.5f : -0.5f, 0.0f, 0.0f);
+		if (n % 4 == 2) begin = glm::round(begin) + 0.5f;
+		glm::vec3 vel(move(rng), move(rng), move(rng));
+		if (n % 5 == 0) vel.y = 0.0f;
+		if (n % 7 == 0) vel.x = 0.0f;
+		if (n % 11 == 0) vel *= 8.0f; //reaching across several blocks
+		glm::vec3 end = begin + vel;
+
+		glm::vec3 expected = CollisionReference::Slide(begin, end, box, randomSolid);
+		glm::vec3 actual = Collision::SlideThroughVoxels(begin, end, box, rowsOf(randomSolid));
+		if (expected != end) collided++;
+		if (std::memcmp(&expected, &actual, sizeof(expected)) != 0) {
+			if (differ < 10) {
+				std::cout << "ERROR::TEST::COLLISION_DIFFERS: from (" << begin.x << ", " << begin.y << ", " << begin.z << ") to ("
+					<< end.x << ", " << end.y << ", " << end.z << "): (" << expected.x << ", " << expected.y << ", " << expected.z
+					<< ") expected, (" << actual.x << ", " << actual.y << ", " << actual.z << ") found" << std::endl;
+			}
+			differ++;
+		}
+	}
+	std::cout << "collision: " << MOTIONS << " motions, " << collided << " collided, " << differ << " differ" << std::endl;
+	CHECK(collided > 0);
+	CHECK(differ == 0);
+}
+
+static void testKnownMotions() {
+	const glm::vec3 box(1.0f, 2.0f, 1.0f);
+	// a floor of blocks at y = 0, whose top is at y = 0.5, and a wall at x = 3
+	auto floorAndWall = rowsOf([](int x, int y, int z) { return y == 0 || x == 3; });
+	glm::vec3 contacts;
+
+	// falling onto the floor stops on its top
+	glm::vec3 end = Collision::SlideThroughVoxels({ 0.0f, 2.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, box, floorAndWall, &contacts);
+	CHECK(end == glm::vec3(0.0f, 0.5f, 0.0f));
+	CHECK(contacts == glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// falling diagonally slides along the floor
+	end = Collision::SlideThroughVoxels({ 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.5f }, box, floorAndWall, &contacts);
+	CHECK(end == glm::vec3(1.0f, 0.5f, 0.5f));
+	CHECK(contacts == glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// walking into the wall stops against it, and keeps the movement along it
+	end = Collision::SlideThroughVoxels({ 0.0f, 0.5f, 0.0f }, { 3.0f, 0.5f, 1.0f }, box, floorAndWall, &contacts);
+	CHECK(end == glm::vec3(1.5f, 0.5f, 1.0f));
+	CHECK(contacts == glm::vec3(-1.0f, 0.0f, 0.0f));
+
+	// falling into the corner of the floor and the wall stops on both
+	end = Collision::SlideThroughVoxels({ 1.0f, 1.5f, 0.0f }, { 2.0f, 0.0f, 0.0f }, box, floorAndWall, &contacts);
+	CHECK(end == glm::vec3(1.5f, 0.5f, 0.0f));
+	CHECK(contacts.x == -1.0f && contacts.y == 1.0f && contacts.z == 0.0f);
+
+	// nothing in the way
+	end = Collision::SlideThroughVoxels({ 0.0f, 5.0f, 0.0f }, { -2.0f, 6.0f, 1.0f }, box, floorAndWall, &contacts);
+	CHECK(end == glm::vec3(-2.0f, 6.0f, 1.0f));
+	CHECK(contacts == glm::vec3(0.0f));
+}
+
+// rows starting anywhere in a chunk, and reaching into the next one or past the loaded chunks
+static void testSolidRows() {
+	HeadlessGL::GetInstance().Install();
+	World& world = World::GetInstance();
+	// the terrain's surface is in the chunks at y = 0
+	Camera::MainCamera.SetPose({ 0.0f, 16.0f, 0.0f }, 0.0f, 0.0f);
+	world.CreateInitialChunks(Camera::MainCamera.position);
+	auto isSolid = [&](int x, int y, int z) {
+		glm::ivec3 block(x, y, z);
+		Chunk* chunk = world.GetChunkByIndex(Chunk::BlockToChunkIndex(block));
+		return chunk && chunk->IsSolid(block - chunk->basepos);
+	};
+
+	std::mt19937 rng(7);
+	const int reach = (world.viewRadius + 1) * Chunk::SZ;
+	std::uniform_int_distribution<int> across(-reach, reach), up(-8, 40);
+	SolidRows solidRows(world);
+	size_t solid = 0, differ = 0;
+	for (int n = 0; n < 20000; ++n) {
+		int x = across(rng), y = up(rng), z = across(rng);
+		uint32_t row = solidRows(x, y, z);
+		for (int i = 0; i < 32; ++i) {
+			bool expected = isSolid(x, y, z + i);
+			solid += expected;
+			differ += expected != (bool)((row >> i) & 1u);
+		}
+	}
+	std::cout << "solid rows: " << solid << " solid blocks, " << differ << " differ" << std::endl;
+	CHECK(solid > 0);
+	CHECK(differ == 0);
+}
+
+int main() {
+	testKnownMotions();
+	testRegression();
+	testSolidRows();
+	return Check::Failures();
+}
@@ -0,0 +1,101 @@
+#include <cstdio>
+#include "check.h"
+#include "../world.h"
+#include "../camera.h"
+#include "../headlessgl.h"
+
+/*
+player edits survive a reload whichever order the chunks are decorated in. a tree of chunk b reaches into chunk a,
+the player cuts one of its leaves in a and puts granite where another one was, and the edits are saved.
+after the reload, a's journal is replayed when a is decorated, and b's tree must not grow back over it,
+whether b is decorated after a or before it.
+*/
+
+// the game defines the camera in main.cpp
+Camera Camera::MainCamera = Camera(glm::vec3(0.0f, 4.0f, 0.0f));
+
+static const char* SAVE_PATH = "test_edit_reload.edits";
+
+using BlockType = BlockDB::BlockType;
+
+struct Spill {
+	glm::ivec3 a, b; //chunk indices
+	std::vector<std::pair<glm::ivec3, BlockType>> blocks; //grid index in a, and the block b's plants put there
+};
+
+static Chunk& generated(World& world, const glm::ivec3& idx) {
+	world.PrefetchChunk({ idx.x, idx.y, idx.z });
+	return *world.allChunks.Find(idx);
+}
+
+// decorates b before its neighbour a at the surface of the chunks around the origin, until its plants reach into a
+static bool findSpill(World& world, Spill& spill) {
+	for (int i = -6; i <= 6; i += 3) {
+		for (int k = -6; k <= 6; ++k) {
+			spill.b = { i, 0, k }, spill.a = { i + 1, 0, k };
+			Chunk& a = generated(world, spill.a);
+			Chunk& b = generated(world, spill.b);
+			if (a.initialized || b.initialized) continue;
+			std::vector<BlockType> before(&a.grid[0][0][0], &a.grid[0][0][0] + ChunkEditJournal::VOLUME);
+			world.DecorateChunk(b);
+			spill.blocks.clear();
+			for (int n = 0; n < ChunkEditJournal::VOLUME; ++n) {
+				BlockType now = (&a.grid[0][0][0])[n];
+				if (now == before[n] || now == BlockType::BLOCK_AIR) continue;
+				spill.blocks.push_back({ { n / (Chunk::HEIGHT * Chunk::SZ), n / Chunk::SZ % Chunk::HEIGHT, n % Chunk::SZ }, now });
+			}
+			if (spill.blocks.size() >= 3) return true;
+		}
+	}
+	return false;
+}
+
+// a fresh copy of a and b, as after restarting the game: the old ones are recycled when the window moves far away
+static void reload(World& world, const glm::vec3& farAway) {
+	glm::vec3 pos = farAway;
+	world.UpdateChunks(pos, 1.0f / 60.0f);
+	HeadlessGL::GetInstance().EndFrame();
+	CHECK(world.LoadEdits(SAVE_PATH));
+}
+
+static void checkOrder(World& world, const Spill& spill, bool aFirst, const glm::vec3& farAway) {
+	reload(world, farAway);
+	Chunk& a = generated(world, spill.a);
+	Chunk& b = generated(world, spill.b);
+	CHECK(!a.initialized && !b.initialized);
+	world.DecorateChunk(aFirst ? a : b);
+	world.DecorateChunk(aFirst ? b : a);
+
+	const glm::ivec3 &cut = spill.blocks[0].first, &placed = spill.blocks[1].first, &kept = spill.blocks[2].first;
+	CHECK(a.grid[cut.x][cut.y][cut.z] == BlockType::BLOCK_AIR);
+	CHECK(a.grid[placed.x][placed.y][placed.z] == BlockType::BLOCK_GRANITE);
+	// what the player left alone still grows back
+	CHECK(a.grid[kept.x][kept.y][kept.z] == spill.blocks[2].second);
+	std::cout << "edit reload: " << (aFirst ? "a" : "b") << " decorated first" << std::endl;
+}
+
+int main() {
+	HeadlessGL::GetInstance().Install();
+	World& world = World::GetInstance();
+	world.SetViewDistance(1, 1);
+
+	Spill spill;
+	bool found = findSpill(world, spill);
+	CHECK(found);
+	if (!found) return Check::Failures();
+
+	Chunk& a = *world.allChunks.Find(spill.a);
+	world.DecorateChunk(a);
+	std::vector<BlockEdit> edits = {
+		{ a.basepos + spill.blocks[0].first, BlockType::BLOCK_AIR },
+		{ a.basepos + spill.blocks[1].first, BlockType::BLOCK_GRANITE },
+	};
+	std::vector<glm::ivec3> touched;
+	world.ApplyEdits(edits, touched);
+	CHECK(world.SaveEdits(SAVE_PATH));
+
+	checkOrder(world, spill, true, { 100000.0f, 0.0f, 0.0f });
+	checkOrder(world, spill, false, { -100000.0f, 0.0f, 0.0f });
+	std::remove(SAVE_PATH);
+	return Check::Failures();
+}
@@ -0,0 +1,108 @@
+#include <random>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include "check.h"
+#include "../occlusion.h"
+
+/*
+the occlusion buffer may let hidden boxes through, but must never cull a box that can be seen.
+besides a few hand placed boxes, random scenes check that the center of every culled box
+is behind an occluder along the line of sight.
+*/
+
+static const glm::vec3 EYE(0.0f);
+
+static glm::mat4 viewProj(const glm::vec3& front) {
+	return glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 500.0f) * glm::lookAt(EYE, EYE + front, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// distance along dir(normalized) at which the ray from EYE enters the box, or -1 if it misses
+static float rayEnter(const glm::vec3& dir, const glm::vec3& mn, const glm::vec3& mx) {
+	float enter = 0.0f, exit = std::numeric_limits<float>::infinity();
+	for (int a = 0; a < 3; ++a) {
+		if (dir[a] == 0.0f) {
+			if (EYE[a] < mn[a] || EYE[a] > mx[a]) return -1.0f;
+			continue;
+		}
+		float t0 = (mn[a] - EYE[a]) / dir[a], t1 = (mx[a] - EYE[a]) / dir[a];
+		enter = std::max(enter, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+	return enter <= exit ? enter : -1.0f;
+}
+
+static void testWall() {
+	OcclusionBuffer buffer;
+	buffer.Begin(viewProj({ 0.0f, 0.0f, -1.0f }));
+	buffer.AddOccluder({ -50.0f, -50.0f, -12.0f }, { 50.0f, 50.0f, -10.0f });
+	CHECK(!buffer.TestAABB({ -1.0f, -1.0f, -30.0f }, { 1.0f, 1.0f, -28.0f })); //behind the wall
+	CHECK(buffer.TestAABB({ -1.0f, -1.0f, -8.0f }, { 1.0f, 1.0f, -6.0f })); //in front of it
+	CHECK(buffer.TestAABB({ -1.0f, -1.0f, -11.0f }, { 1.0f, 1.0f, -9.0f })); //sticking out of it
+	CHECK(buffer.TestAABB({ -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f })); //around the camera
+	CHECK(!buffer.TestAABB({ 200.0f, -1.0f, -20.0f }, { 202.0f, 1.0f, -18.0f })); //off screen
+	buffer.End();
+	CHECK(buffer.LastFrameStats().occluders == 1);
+	CHECK(buffer.LastFrameStats().tested == 5);
+	CHECK(buffer.LastFrameStats().culled == 2);
+}
+
+static void testPartialCover() {
+	// a box reaching past the edge of the wall on screen can be seen
+	OcclusionBuffer buffer;
+	buffer.Begin(viewProj({ 0.0f, 0.0f, -1.0f }));
+	buffer.AddOccluder({ -2.0f, -2.0f, -12.0f }, { 2.0f, 2.0f, -10.0f });
+	CHECK(!buffer.TestAABB({ -1.0f, -1.0f, -30.0f }, { 1.0f, 1.0f, -28.0f }));
+	CHECK(buffer.TestAABB({ 0.0f, -1.0f, -30.0f }, { 20.0f, 1.0f, -28.0f }));
+	// occluders reaching behind the camera are skipped
+	buffer.AddOccluder({ -50.0f, -50.0f, -20.0f }, { 50.0f, 50.0f, 5.0f });
+	CHECK(buffer.TestAABB({ 0.0f, -1.0f, -30.0f }, { 20.0f, 1.0f, -28.0f }));
+	buffer.End();
+	CHECK(buffer.LastFrameStats().occluders == 1);
+}
+
+static void testConservative() {
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f), size(0.5f, 8.0f), dist(2.0f, 60.0f);
+	OcclusionBuffer buffer;
+	size_t culled = 0, wrong = 0;
+	for (int scene = 0; scene < 200; ++scene) {
+		glm::vec3 front = glm::normalize(glm::vec3(unit(rng), unit(rng) * 0.5f, unit(rng)));
+		buffer.Begin(viewProj(front));
+		// occluders in front of the camera, from walls and slabs to cubes
+		std::vector<std::pair<glm::vec3, glm::vec3>> occluders;
+		for (int n = 0; n < 8; ++n) {
+			glm::vec3 center = EYE + glm::normalize(front + 0.4f * glm::vec3(unit(rng), unit(rng), unit(rng))) * dist(rng);
+			glm::vec3 half = glm::vec3(size(rng), size(rng), size(rng)) * 0.5f;
+			occluders.push_back({ center - half, center + half });
+			buffer.AddOccluder(center - half, center + half);
+		}
+		for (int n = 0; n < 200; ++n) {
+			glm::vec3 center = EYE + glm::normalize(front + 0.4f * glm::vec3(unit(rng), unit(rng), unit(rng))) * dist(rng) * 1.5f;
+			glm::vec3 half(size(rng) * 0.25f);
+			if (buffer.TestAABB(center - half, center + half)) continue;
+			culled++;
+			// hidden means something is in the way of the center
+			glm::vec3 dir = glm::normalize(center - EYE);
+			float reach = glm::length(center - EYE);
+			bool blocked = std::any_of(occluders.begin(), occluders.end(), [&](const auto& o) {
+				float t = rayEnter(dir, o.first, o.second);
+				return t >= 0.0f && t < reach;
+			});
+			// boxes off screen are culled too
+			glm::vec4 clip = viewProj(front) * glm::vec4(center, 1.0f);
+			bool onScreen = clip.w > 0.0f && std::abs(clip.x) < clip.w && std::abs(clip.y) < clip.w;
+			if (onScreen && !blocked) wrong++;
+		}
+		buffer.End();
+	}
+	std::cout << "occlusion: " << culled << " of " << 200 * 200 << " random boxes culled, " << wrong << " of them visible" << std::endl;
+	CHECK(culled > 0);
+	CHECK(wrong == 0);
+}
+
+int main() {
+	testWall();
+	testPartialCover();
+	testConservative();
+	return Check::Failures();
+}
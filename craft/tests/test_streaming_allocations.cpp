@@ -0,0 +1,65 @@
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include "check.h"
+#include "../world.h"
+#include "../camera.h"
+#include "../headlessgl.h"
+
+/*
+steady state streaming must not allocate: once the chunk pool, the mesh staging buffers and the arena have grown
+to the size of the view window, generating, decorating, meshing and recycling a chunk reuses what is there.
+every allocation of the process is counted, then the camera flies back and forth over the same stretch of terrain,
+which keeps evicting chunks and streaming them back in.
+*/
+
+// the game defines the camera in main.cpp
+Camera Camera::MainCamera = Camera(glm::vec3(0.0f, 4.0f, 0.0f));
+
+static std::atomic<size_t> allocations{ 0 };
+
+void* operator new(size_t size) {
+	allocations++;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+// flies from x = 0 to x = distance and back, streaming every frame until nothing is left to do.
+// returns the number of chunks generated on the way.
+static int flyRoundTrip(World& world, float distance, float step) {
+	int generated = 0;
+	auto frame = [&](float x) {
+		Camera::MainCamera.position.x = x;
+		world.UpdateChunks(Camera::MainCamera.position, 1.0f / 60.0f);
+		generated += world.streamer.LastFrameStats().generated;
+		HeadlessGL::GetInstance().EndFrame();
+	};
+	for (float x = 0.0f; x < distance; x += step) frame(x);
+	for (float x = distance; x > 0.0f; x -= step) frame(x);
+	for (int n = 0; n < 200; ++n) frame(0.0f);
+	return generated;
+}
+
+int main() {
+	HeadlessGL::GetInstance().Install();
+	World& world = World::GetInstance();
+	world.streamer.taskBudget = 8;
+	Camera::MainCamera.SetPose({ 0.0f, 72.0f, 0.0f }, 0.0f, 0.0f);
+	world.CreateInitialChunks(Camera::MainCamera.position);
+
+	// far enough to recycle every chunk of the window on the way
+	const float distance = (2 * (world.viewRadius + World::CACHE_MARGIN) + 2) * Chunk::SZ;
+	// the first trips grow the pool, the staging buffers and the arena's free lists to their high-water marks
+	for (int n = 0; n < 4; ++n) flyRoundTrip(world, distance, 0.5f);
+
+	allocations = 0;
+	int generated = flyRoundTrip(world, distance, 0.5f);
+	size_t counted = allocations;
+	std::cout << "streaming allocations: " << counted << " while generating " << generated << " chunks, "
+		<< world.chunkPool.Capacity() << " pooled chunks" << std::endl;
+	CHECK(generated > 0);
+	CHECK(counted == 0);
+	return Check::Failures();
+}
@@ -0,0 +1,68 @@
+#include "visibility.h"
+#include "world.h"
+
+// unit steps in the order of Block::Face
+static const glm::ivec3 FACE_DIRS[6] = {
+	{ 0, 0, 1 }, { 1, 0, 0 }, { 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }
+};
+static const int OPPOSITE_FACE[6] = {
+	Block::Face::BACK, Block::Face::LEFT, Block::Face::FRONT, Block::Face::RIGHT, Block::Face::BOTTOM, Block::Face::TOP
+};
+
+int ChunkVisibility::slotOf(const glm::ivec3& idx) const {
+	glm::ivec3 r = idx - origin;
+	if (r.x < 0 || r.x >= width || r.z < 0 || r.z >= width || r.y < 0 || r.y >= height) return -1;
+	return (r.x * height + r.y) * width + r.z;
+}
+
+void ChunkVisibility::Update(World& world, const glm::vec3& cameraPos, const Frustum& frustum) {
+	auto begin = std::chrono::steady_clock::now();
+	origin = world.centerChunkIdx - glm::ivec3(world.viewRadius, world.viewHeightRadius, world.viewRadius);
+	width = 2 * world.viewRadius + 1;
+	height = 2 * world.viewHeightRadius + 1;
+	reached.assign((size_t)width * height * width, 0);
+	lastFrame = Stats();
+
+	// a camera outside the window, e.g. while it is recentering vertically, sees everything
+	glm::ivec3 start = Chunk::WorldToChunkIndex(cameraPos);
+	culling = slotOf(start) >= 0;
+	if (culling) {
+		queue.clear();
+		queue.push_back({ start, -1, 0 });
+		reached[slotOf(start)] = 1;
+		for (size_t head = 0; head < queue.size(); ++head) {
+			Node node = queue[head];
+			Chunk* chunk = world.visChunks.Find(node.idx);
+			bool open = !chunk || !chunk->isBuilt;
+
+			for (int d = 0; d < 6; ++d) {
+				if (node.travelled >> OPPOSITE_FACE[d] & 1) continue;
+				if (node.entryFace >= 0 && !open && !chunk->FacesConnected(node.entryFace, d)) continue;
+				glm::ivec3 next = node.idx + FACE_DIRS[d];
+				int slot = slotOf(next);
+				if (slot < 0 || reached[slot]) continue;
+				glm::vec3 mn = glm::vec3(next.x * Chunk::SZ, next.y * Chunk::HEIGHT, next.z * Chunk::SZ) - 0.5f;
+				if (!frustum.TestAABB(mn, mn + glm::vec3(Chunk::SZ, Chunk::HEIGHT, Chunk::SZ))) continue;
+
+				reached[slot] = 1;
+				queue.push_back({ next, OPPOSITE_FACE[d], node.travelled | (1 << d) });
+			}
+		}
+		lastFrame.reached = queue.size();
+		lastFrame.culled = reached.size() - queue.size();
+	}
+
+	lastFrame.frames = 1;
+	lastFrame.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+	total.frames++;
+	total.reached += lastFrame.reached;
+	total.culled += lastFrame.culled;
+	total.ms += lastFrame.ms;
+}
+
+bool ChunkVisibility::IsVisible(const p3i& idx) const {
+	if (!culling) return true;
+	auto [x, y, z] = idx;
+	int slot = slotOf({ x, y, z });
+	return slot < 0 || reached[slot];
+}
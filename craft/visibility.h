@@ -0,0 +1,56 @@
+#pragma once
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+
+#include <vector>
+#include <chrono>
+#include <glm/glm.hpp>
+#include "chunkindex.h"
+#include "frustum.h"
+
+class World;
+
+/*
+cave culling. a breadth first search over the chunks of the view window, starting at the camera's chunk.
+the search steps from a chunk into a neighbour only if
+	- the neighbour is inside the view frustum,
+	- the step does not go back against a direction already taken on the way there,
+	- the face the chunk was entered through connects to the face it leaves through(Chunk::faceConnectivity).
+chunks the search never reaches are enclosed by opaque blocks as seen from the camera, and are not drawn.
+chunks that are not meshed yet are treated as empty, so the search passes through them.
+*/
+class ChunkVisibility {
+public:
+	using p3i = ChunkIndex::p3i;
+
+	struct Stats {
+		size_t frames = 0;
+		size_t reached = 0, culled = 0; //chunks of the window
+		double ms = 0.0;
+	};
+
+	void Update(World& world, const glm::vec3& cameraPos, const Frustum& frustum);
+	// chunks outside the window searched in the last update count as visible.
+	bool IsVisible(const p3i& idx) const;
+
+	const Stats& LastFrameStats() const { return lastFrame; }
+	const Stats& TotalStats() const { return total; }
+
+private:
+	struct Node {
+		glm::ivec3 idx;
+		int entryFace; //-1 for the camera's chunk
+		int travelled; //bit d is set if the path went in direction d
+	};
+
+	int slotOf(const glm::ivec3& idx) const; //-1 if outside the window
+
+	std::vector<uint8_t> reached;
+	std::vector<Node> queue;
+	glm::ivec3 origin{ 0 }; //smallest chunk index of the window
+	int width = 0, height = 0;
+	bool culling = false;
+	Stats lastFrame, total;
+};
+
+#endif
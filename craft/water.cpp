@@ -0,0 +1,210 @@
+#include "water.h"
+#include "world.h"
+#include "chunkindex.h"
+#include "profiler.h"
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+static const glm::ivec3 NEIGHBOURS[6] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 } };
+static constexpr int SIDES = 4; //the first four neighbours are beside the block
+static const glm::ivec3 UP{ 0, 1, 0 }, DOWN{ 0, -1, 0 };
+
+bool WaterFlow::floodable(BlockDB::BlockType ty) {
+	return ty == BlockDB::BlockType::BLOCK_AIR || (ty != BlockDB::BlockType::BLOCK_WATER && !BlockDB::GetInstance().collides(ty));
+}
+
+uint64_t WaterFlow::keyOf(const glm::ivec3& blockIdx) {
+	return ChunkIndex::PackKey(blockIdx.x, blockIdx.y, blockIdx.z);
+}
+
+glm::ivec3 WaterFlow::blockOf(uint64_t key) {
+	// the 21 bit fields of ChunkIndex::PackKey, sign extended
+	auto field = [key](int shift) { return (int)((int64_t)(key << (43 - shift)) >> 43); };
+	return glm::ivec3(field(42), field(21), field(0));
+}
+
+Chunk* WaterFlow::chunkOf(const glm::ivec3& blockIdx) {
+	glm::ivec3 idx = Chunk::BlockToChunkIndex(blockIdx);
+	if (idx != cachedIdx) {
+		cachedIdx = idx;
+		cached = world.allChunks.Find(idx);
+	}
+	// undecorated chunks would have their water overwritten by trees and replayed edits
+	return cached && cached->initialized ? cached : nullptr;
+}
+
+void WaterFlow::BlockChanged(const glm::ivec3& blockIdx, uint64_t tick) {
+	cachedIdx = glm::ivec3(INT32_MIN); //chunks may have been recycled since the last call
+	Chunk* ch = chunkOf(blockIdx);
+	if (!ch) return;
+	// whatever replaced the water, or water placed as a block, is not flowing water
+	levels.erase(keyOf(blockIdx));
+	schedule(blockIdx, tick + FLOW_DELAY);
+	for (const glm::ivec3& n : NEIGHBOURS) schedule(blockIdx + n, tick + FLOW_DELAY);
+}
+
+void WaterFlow::schedule(const glm::ivec3& blockIdx, uint64_t tick) {
+	if (!scheduled.insert(keyOf(blockIdx)).second) return; //already due, no later than this
+	queue.push_back({ tick, blockIdx });
+}
+
+int WaterFlow::LevelAt(const glm::ivec3& blockIdx) {
+	Chunk* ch = chunkOf(blockIdx);
+	if (!ch) return 0;
+	glm::ivec3 bidx = ch->BlockWorldToGridIdx(blockIdx);
+	if (ch->grid[bidx.x][bidx.y][bidx.z] != BlockDB::BlockType::BLOCK_WATER) return 0;
+	auto it = levels.find(keyOf(blockIdx));
+	return it == levels.end() ? SOURCE_LEVEL : it->second;
+}
+
+void WaterFlow::Step(uint64_t tick) {
+	PROFILE_ZONE("WaterFlow::Step");
+	auto begin = std::chrono::steady_clock::now();
+	cachedIdx = glm::ivec3(INT32_MIN);
+	lastStep = Stats{};
+	while (!queue.empty() && queue.front().tick <= tick && lastStep.updates < MAX_UPDATES_PER_TICK) {
+		glm::ivec3 blockIdx = queue.front().block;
+		queue.pop_front();
+		scheduled.erase(keyOf(blockIdx));
+		update(blockIdx, tick);
+		lastStep.updates++;
+	}
+	lastStep.pending = queue.size();
+	lastStep.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void WaterFlow::update(const glm::ivec3& blockIdx, uint64_t tick) {
+	using BlockType = BlockDB::BlockType;
+	Chunk* ch = chunkOf(blockIdx);
+	if (!ch) return;
+	glm::ivec3 bidx = ch->BlockWorldToGridIdx(blockIdx);
+	BlockType type = ch->grid[bidx.x][bidx.y][bidx.z];
+	int level = LevelAt(blockIdx);
+	if (level == SOURCE_LEVEL || (type != BlockType::BLOCK_WATER && !floodable(type))) return;
+
+	int want = LevelAt(blockIdx + UP) > 0 ? FALLING_LEVEL : 0;
+	for (int s = 0; s < SIDES; ++s) {
+		glm::ivec3 side = blockIdx + NEIGHBOURS[s];
+		int l = LevelAt(side);
+		if (l <= 1 || l - 1 <= want) continue;
+		// water that can still fall runs down, not sideways. it falls into flowing water too, which keeps it from piling up.
+		if (l != SOURCE_LEVEL) {
+			Chunk* below = chunkOf(side + DOWN);
+			if (!below) continue;
+			glm::ivec3 b = below->BlockWorldToGridIdx(side + DOWN);
+			int lb = LevelAt(side + DOWN);
+			if (floodable(below->grid[b.x][b.y][b.z]) || (lb > 0 && lb < SOURCE_LEVEL)) continue;
+		}
+		want = l - 1;
+	}
+	if (want == level) return;
+
+	// LevelAt() and chunkOf() above may have moved the cache to another chunk
+	ch = chunkOf(blockIdx);
+	if (want == 0) {
+		levels.erase(keyOf(blockIdx));
+		ch->DestroyBlockAt(bidx);
+	}
+	else {
+		levels[keyOf(blockIdx)] = (uint8_t)want;
+		if (type != BlockType::BLOCK_WATER) ch->PlaceBlockAt(bidx, BlockType::BLOCK_WATER);
+	}
+	lastStep.changed++;
+	markChanged(blockIdx);
+	for (const glm::ivec3& n : NEIGHBOURS) schedule(blockIdx + n, tick + FLOW_DELAY);
+}
+
+void WaterFlow::markChanged(const glm::ivec3& blockIdx) {
+	// the faces of a neighbouring chunk next to the block change with it
+	glm::ivec3 chunkIdx = Chunk::BlockToChunkIndex(blockIdx);
+	for (int n = -1; n < 6; ++n) {
+		glm::ivec3 idx = n < 0 ? chunkIdx : Chunk::BlockToChunkIndex(blockIdx + NEIGHBOURS[n]);
+		if (n >= 0 && idx == chunkIdx) continue;
+		if (n >= 0) {
+			Chunk* nbr = world.allChunks.Find(idx);
+			if (!nbr) continue;
+			nbr->requiresRebuild = true;
+		}
+		if (std::find(changedChunks.begin(), changedChunks.end(), idx) == changedChunks.end()) changedChunks.push_back(idx);
+	}
+}
+
+std::vector<glm::ivec3> WaterFlow::TakeChangedChunks() {
+	std::vector<glm::ivec3> taken;
+	taken.swap(changedChunks);
+	return taken;
+}
+
+void WaterFlow::Clear() {
+	queue.clear();
+	scheduled.clear();
+	changedChunks.clear();
+	lastStep = Stats{};
+}
+
+// save file: "GLCW" | u32 version | u32 level count | count * (i32 x, i32 y, i32 z, u8 level)
+//	| u32 update count | count * (i32 x, i32 y, i32 z)
+static constexpr char WATER_MAGIC[4] = { 'G', 'L', 'C', 'W' };
+static constexpr uint32_t WATER_VERSION = 1;
+
+bool WaterFlow::Save(const std::string& path) const {
+	std::ofstream ofs(path, std::ios::binary);
+	if (!ofs) {
+		std::cout << "ERROR::WATER::COULD_NOT_OPEN_SAVE_FILE: " << path << std::endl;
+		return false;
+	}
+
+	uint32_t cnt = (uint32_t)levels.size();
+	ofs.write(WATER_MAGIC, sizeof(WATER_MAGIC));
+	ofs.write(reinterpret_cast<const char*>(&WATER_VERSION), sizeof(WATER_VERSION));
+	ofs.write(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+	for (auto& [key, level] : levels) {
+		glm::ivec3 block = blockOf(key);
+		int32_t xyz[3] = { block.x, block.y, block.z };
+		ofs.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+		ofs.write(reinterpret_cast<const char*>(&level), sizeof(level));
+	}
+	cnt = (uint32_t)queue.size();
+	ofs.write(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+	for (const Scheduled& s : queue) {
+		int32_t xyz[3] = { s.block.x, s.block.y, s.block.z };
+		ofs.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+	}
+	return ofs.good();
+}
+
+bool WaterFlow::Load(const std::string& path, uint64_t tick) {
+	std::ifstream ifs(path, std::ios::binary);
+	if (!ifs) return false; // nothing saved yet
+
+	char magic[4];
+	uint32_t version = 0, cnt = 0;
+	ifs.read(magic, sizeof(magic));
+	ifs.read(reinterpret_cast<char*>(&version), sizeof(version));
+	ifs.read(reinterpret_cast<char*>(&cnt), sizeof(cnt));
+	if (!ifs || !std::equal(magic, magic + 4, WATER_MAGIC) || version != WATER_VERSION) {
+		std::cout << "ERROR::WATER::INVALID_SAVE_FILE: " << path << std::endl;
+		return false;
+	}
+
+	std::unordered_map<uint64_t, uint8_t> loaded;
+	std::vector<glm::ivec3> updates;
+	int32_t xyz[3];
+	for (uint32_t n = 0; n < cnt; ++n) {
+		uint8_t level;
+		if (!ifs.read(reinterpret_cast<char*>(xyz), sizeof(xyz)) || !ifs.read(reinterpret_cast<char*>(&level), sizeof(level))) break;
+		loaded[keyOf({ xyz[0], xyz[1], xyz[2] })] = level;
+	}
+	if (ifs && ifs.read(reinterpret_cast<char*>(&cnt), sizeof(cnt))) {
+		for (uint32_t n = 0; n < cnt && ifs.read(reinterpret_cast<char*>(xyz), sizeof(xyz)); ++n) updates.push_back({ xyz[0], xyz[1], xyz[2] });
+	}
+	if (!ifs) {
+		std::cout << "ERROR::WATER::CORRUPTED_SAVE_FILE: " << path << std::endl;
+		return false;
+	}
+	levels = std::move(loaded);
+	for (const glm::ivec3& block : updates) schedule(block, tick + FLOW_DELAY);
+	return true;
+}
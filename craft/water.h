@@ -0,0 +1,97 @@
+#pragma once
+#ifndef WATER_H
+#define WATER_H
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <string>
+#include <glm/glm.hpp>
+#include "blocks.hpp"
+
+class World;
+class Chunk;
+
+/*
+flowing water, as a cellular automaton that only visits the cells scheduled for an update.
+a cell is scheduled when a block next to it changes(BlockChanged(), called for every edit the simulation makes),
+and when the flow changes a neighbour of it. nothing else is ever scanned, so a lake that is left alone costs nothing,
+however many chunks are loaded.
+
+every water block has a level. generated water, and water placed as a block, is a source(SOURCE_LEVEL) and never
+drains. the levels of the water the flow adds are kept here, by world block position, and the blocks are BLOCK_WATER.
+updating a cell recomputes its level from its neighbours:
+	- water above it makes it FALLING_LEVEL,
+	- water beside it, that is a source or rests on a source or a block it can't flow into, makes it that level - 1,
+	- otherwise it is dry.
+so water runs down first, spreads SOURCE_LEVEL - 1 blocks across the ground, and drains once its source is cut off.
+when the level changes, the cell's neighbours are scheduled FLOW_DELAY ticks later.
+
+Step() runs the updates that are due, at most MAX_UPDATES_PER_TICK. the rest wait for the next tick.
+the chunks the flow changed, and their neighbours that show the changed blocks, are collected for remeshing.
+*/
+class WaterFlow {
+public:
+	static constexpr int SOURCE_LEVEL = 8;
+	static constexpr int FALLING_LEVEL = SOURCE_LEVEL - 1;
+	static constexpr uint64_t FLOW_DELAY = 5; //ticks
+	static constexpr size_t MAX_UPDATES_PER_TICK = 1024;
+
+	struct Stats {
+		size_t updates = 0; //cells visited
+		size_t changed = 0; //cells whose level changed
+		size_t pending = 0; //cells scheduled after the step
+		double ms = 0.0;
+	};
+
+	explicit WaterFlow(World& world) : world(world) {}
+
+	// the block at blockIdx changed at tick: it and its neighbours are updated FLOW_DELAY ticks later
+	void BlockChanged(const glm::ivec3& blockIdx, uint64_t tick);
+	// runs the updates due at tick
+	void Step(uint64_t tick);
+	// 0 if there is no water at blockIdx, or its chunk isn't loaded
+	int LevelAt(const glm::ivec3& blockIdx);
+	// chunks whose blocks the flow changed since the last call, each once
+	std::vector<glm::ivec3> TakeChangedChunks();
+	size_t Pending() const { return queue.size(); }
+	// forgets the scheduled updates. the water already in the world stays, its levels too.
+	void Clear();
+
+	// the flowed water's levels and the scheduled updates, next to the edits(World::SaveEdits), which hold the water blocks.
+	// without them the flowed water would come back as sources. the loaded updates are scheduled FLOW_DELAY ticks after tick.
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path, uint64_t tick);
+
+	const Stats& LastStepStats() const { return lastStep; }
+
+private:
+	struct Scheduled {
+		uint64_t tick;
+		glm::ivec3 block;
+	};
+
+	// water replaces air, and washes away what doesn't block it(flowers)
+	static bool floodable(BlockDB::BlockType ty);
+	static uint64_t keyOf(const glm::ivec3& blockIdx);
+	static glm::ivec3 blockOf(uint64_t key);
+	// the chunk holding the block, if it is decorated. the last chunk found is cached.
+	Chunk* chunkOf(const glm::ivec3& blockIdx);
+	void schedule(const glm::ivec3& blockIdx, uint64_t tick);
+	void update(const glm::ivec3& blockIdx, uint64_t tick);
+	void markChanged(const glm::ivec3& blockIdx);
+
+	World& world;
+	// every update is FLOW_DELAY ticks out, so appending keeps the queue in tick order
+	std::deque<Scheduled> queue;
+	std::unordered_set<uint64_t> scheduled; //keys of the blocks in queue
+	std::unordered_map<uint64_t, uint8_t> levels; //water blocks that aren't sources
+	std::vector<glm::ivec3> changedChunks;
+	glm::ivec3 cachedIdx{ INT32_MIN };
+	Chunk* cached = nullptr;
+	Stats lastStep;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "workers.h"
+#include "profiler.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool() {
+	unsigned helpers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	workers.reserve(helpers);
+	for (unsigned n = 0; n < helpers; ++n) workers.emplace_back([this]() { work(); });
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) worker.join();
+}
+
+void WorkerPool::run(const char* name, size_t count, JobFn fn, void* ctx) {
+	std::lock_guard<std::mutex> runLock(runMutex);
+	count = std::min<size_t>(count, Threads());
+	if (count == 0) return;
+	if (count > 1) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobName = name, jobFn = fn, jobCtx = ctx;
+			nextJob = 1, jobEnd = count;
+			pending = count - 1;
+		}
+		wake.notify_all();
+	}
+	{
+		PROFILE_ZONE(name);
+		fn(ctx, 0);
+	}
+	if (count > 1) {
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return pending == 0; });
+	}
+}
+
+void WorkerPool::work() {
+	Profiler::SetThreadName("worker");
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this]() { return stopping || nextJob < jobEnd; });
+		if (stopping) return;
+		size_t n = nextJob++;
+		[[maybe_unused]] const char* name = jobName; //read by the zone below, which GLCRAFT_PROFILE=0 compiles out
+		JobFn fn = jobFn;
+		void* ctx = jobCtx;
+		lock.unlock();
+		{
+			PROFILE_ZONE(name);
+			fn(ctx, n);
+		}
+		lock.lock();
+		if (--pending == 0) done.notify_one();
+	}
+}
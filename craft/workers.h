@@ -0,0 +1,61 @@
+#pragma once
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <type_traits>
+
+/*
+threads started once and shared by everything that splits work across the cores(batched raycasts, entity steps),
+so a parallel call costs a wakeup instead of creating and joining threads every time.
+Run() hands out job indices: the calling thread runs job(0), and the pool's threads(named "worker" in traces) the rest.
+jobs usually take their share of the work from an atomic counter, so the number of jobs only limits the parallelism.
+runs from several threads are serialized, and a job must not call Run() itself.
+*/
+class WorkerPool {
+public:
+	static WorkerPool& GetInstance() {
+		static WorkerPool instance;
+		return instance;
+	}
+
+	// the pool's threads and the calling one
+	unsigned Threads() const { return (unsigned)workers.size() + 1; }
+
+	// runs job(n) for n in [0, count), at most Threads() at once, and returns once all of them are done.
+	// count is clamped to Threads(). nothing is allocated. each job is a profiler zone called name, on the thread
+	// that runs it, so name must be a string literal.
+	template<class Job>
+	void Run(const char* name, size_t count, Job&& job) {
+		run(name, count, [](void* ctx, size_t n) { (*static_cast<std::remove_reference_t<Job>*>(ctx))(n); }, &job);
+	}
+
+	~WorkerPool();
+
+private:
+	using JobFn = void(*)(void* ctx, size_t n);
+
+	WorkerPool();
+	WorkerPool(WorkerPool const& other) = delete;
+	WorkerPool& operator=(WorkerPool const& other) = delete;
+
+	void run(const char* name, size_t count, JobFn fn, void* ctx);
+	void work();
+
+	std::vector<std::thread> workers;
+	std::mutex runMutex; //one run at a time
+	std::mutex mutex; //guards the run's state below
+	std::condition_variable wake, done;
+	const char* jobName = nullptr;
+	JobFn jobFn = nullptr;
+	void* jobCtx = nullptr;
+	size_t nextJob = 0, jobEnd = 0; //jobs [nextJob, jobEnd) are not taken yet
+	size_t pending = 0; //jobs of the pool's threads not finished yet
+	bool stopping = false;
+};
+
+#endif
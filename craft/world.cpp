@@ -1,4 +1,5 @@
 #include "world.h"
+#include "profiler.h"
 
 /* AliceOfSNU 2024 */
 
@@ -36,16 +37,53 @@ Chunk::Chunk() :blockCnt(0), isBuilt(false), requiresRebuild(false), initialized
 	solidRenderObj = RenderObject(RenderObject::RenderMode::OPAQUE);
 	cutoutRenderObj = RenderObject(RenderObject::RenderMode::CUTOUT);
 	waterRenderObj = RenderObject(RenderObject::RenderMode::OPAQUE);
+	solidRenderObj.arena = cutoutRenderObj.arena = waterRenderObj.arena = &MeshArena::GetInstance();
 	std::fill(&grid[0][0][0], &grid[0][0][0] + sizeof(grid)/sizeof(grid[0][0][0]), BlockType::BLOCK_AIR);
+	std::fill(&solid[0][0], &solid[0][0] + SZ * HEIGHT, 0u);
+	std::fill(&skyLight[0][0][0], &skyLight[0][0][0] + sizeof(skyLight), (uint8_t)0);
+	lit = false;
 };
 
 Chunk::Chunk(const ivec3& pos, const ivec3& cidx) : blockCnt(0), isBuilt(false), requiresRebuild(false), initialized(false), basepos(pos), chunkIdx(cidx) {
 	solidRenderObj = RenderObject(RenderObject::RenderMode::OPAQUE);
 	cutoutRenderObj = RenderObject(RenderObject::RenderMode::CUTOUT);
 	waterRenderObj = RenderObject(RenderObject::RenderMode::OPAQUE);
+	solidRenderObj.arena = cutoutRenderObj.arena = waterRenderObj.arena = &MeshArena::GetInstance();
 	std::fill(&grid[0][0][0], &grid[0][0][0] + sizeof(grid)/sizeof(grid[0][0][0]), BlockType::BLOCK_AIR);
+	std::fill(&solid[0][0], &solid[0][0] + SZ * HEIGHT, 0u);
+	std::fill(&skyLight[0][0][0], &skyLight[0][0][0] + sizeof(skyLight), (uint8_t)0);
+	lit = false;
 };
 
+void Chunk::Reset(const ivec3& pos, const ivec3& cidx) {
+	// GL buffers are usually gone already, because chunks leave the view before they are recycled.
+	solidRenderObj.DeleteBuffers();
+	cutoutRenderObj.DeleteBuffers();
+	waterRenderObj.DeleteBuffers();
+	blockCnt = 0;
+	isBuilt = false, requiresRebuild = false, initialized = false;
+	basepos = pos;
+	chunkIdx = cidx;
+	std::fill(&grid[0][0][0], &grid[0][0][0] + sizeof(grid)/sizeof(grid[0][0][0]), BlockType::BLOCK_AIR);
+	std::fill(&solid[0][0], &solid[0][0] + SZ * HEIGHT, 0u);
+	std::fill(&skyLight[0][0][0], &skyLight[0][0][0] + sizeof(skyLight), (uint8_t)0);
+	lit = false;
+}
+
+void Chunk::UpdateSolidity() {
+	static_assert(SZ == 32, "a row of solid must be one uint32_t");
+	BlockDB& blockDB = BlockDB::GetInstance();
+	bool collides[BlockType::BLOCK_COUNT];
+	for (int t = 0; t < BlockType::BLOCK_COUNT; ++t) collides[t] = blockDB.collides((BlockType)t);
+	for (int i = 0; i < SZ; ++i) {
+		for (int j = 0; j < HEIGHT; ++j) {
+			uint32_t row = 0;
+			for (int k = 0; k < SZ; ++k) row |= (uint32_t)collides[grid[i][j][k]] << k;
+			solid[i][j] = row;
+		}
+	}
+}
+
 void Chunk::Build() {
 
 	//Building a chunk twice is an error, because we could be wasting computation.
@@ -61,6 +99,22 @@ void Chunk::Build() {
 	Chunk* ip_chk = World::GetInstance().GetChunkByIndex(chunkIdx + Chunk::ivec3{ 1, 0, 0 });
 	Chunk* kn_chk = World::GetInstance().GetChunkByIndex(chunkIdx - Chunk::ivec3{ 0, 0, 1 });
 	Chunk* kp_chk = World::GetInstance().GetChunkByIndex(chunkIdx + Chunk::ivec3{ 0, 0, 1 });
+	Chunk* jn_chk = World::GetInstance().GetChunkByIndex(chunkIdx - Chunk::ivec3{ 0, 1, 0 });
+	Chunk* jp_chk = World::GetInstance().GetChunkByIndex(chunkIdx + Chunk::ivec3{ 0, 1, 0 });
+	// a face is lit by the block it faces, which may be in a neighbour. cutout blocks are lit by their own.
+	auto lightOf = [&](int x, int y, int z) -> int {
+		const Chunk* c = this;
+		if (x < 0) c = in_chk, x += SZ;
+		else if (x >= SZ) c = ip_chk, x -= SZ;
+		else if (y < 0) c = jn_chk, y += HEIGHT;
+		else if (y >= HEIGHT) c = jp_chk, y -= HEIGHT;
+		else if (z < 0) c = kn_chk, z += SZ;
+		else if (z >= SZ) c = kp_chk, z -= SZ;
+		return c && c->lit ? c->skyLight[x][y][z] : BlockDB::MAX_LIGHT;
+	};
+	solidRenderObj.BeginStaging(MeshStaging::ThreadLocal(0));
+	cutoutRenderObj.BeginStaging(MeshStaging::ThreadLocal(1));
+	waterRenderObj.BeginStaging(MeshStaging::ThreadLocal(2));
 	//vtxCnt = 0, idxCnt = 0;
 	for (int i = 0; i < SZ; ++i) { //x dir
 		for (int j = 0; j < HEIGHT; ++j) { //y dir
@@ -77,40 +131,40 @@ void Chunk::Build() {
 				switch (blockData.renderType) {
 				case BlockDB::RenderType::SOLID:
 					// place left and right
-					if (i == 0 && (!in_chk || !blockDB.isSolidCube(in_chk->grid[SZ-1][j][k])))		solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT);
-					else if(i > 0 && !blockDB.isSolidCube(grid[i - 1][j][k]))						solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::LEFT);
-					if (i == SZ - 1 && (!ip_chk || !blockDB.isSolidCube(ip_chk->grid[0][j][k])))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT);
-					else if(i < SZ - 1 && !blockDB.isSolidCube(grid[i + 1][j][k]))					solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::RIGHT);
+					if (i == 0 && (!in_chk || !blockDB.isSolidCube(in_chk->grid[SZ-1][j][k])))		solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT, lightOf(i - 1, j, k));
+					else if(i > 0 && !blockDB.isSolidCube(grid[i - 1][j][k]))						solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT, lightOf(i - 1, j, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::LEFT);
+					if (i == SZ - 1 && (!ip_chk || !blockDB.isSolidCube(ip_chk->grid[0][j][k])))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT, lightOf(i + 1, j, k));
+					else if(i < SZ - 1 && !blockDB.isSolidCube(grid[i + 1][j][k]))					solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT, lightOf(i + 1, j, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::RIGHT);
 					// place top and bottom
-					if (j == 0 || j > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j - 1][k]))						solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BOTTOM);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BOTTOM);
-					if (j == HEIGHT - 1 || j < HEIGHT - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j + 1][k]))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::TOP);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::TOP);
+					if (j == 0 || j > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j - 1][k]))						solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BOTTOM, lightOf(i, j - 1, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BOTTOM);
+					if (j == HEIGHT - 1 || j < HEIGHT - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j + 1][k]))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::TOP, lightOf(i, j + 1, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::TOP);
 					
 					// place back and front
-					if (k == 0 && (!kn_chk || !blockDB.isSolidCube(kn_chk->grid[i][j][SZ - 1])))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK);
-					else if(k > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k - 1]))		solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BACK);
-					if (k == SZ - 1 && (!kp_chk || !blockDB.isSolidCube(kp_chk->grid[i][j][0])))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT);
-					else if( k < SZ - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k + 1]))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::FRONT);
+					if (k == 0 && (!kn_chk || !blockDB.isSolidCube(kn_chk->grid[i][j][SZ - 1])))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK, lightOf(i, j, k - 1));
+					else if(k > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k - 1]))		solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK, lightOf(i, j, k - 1));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BACK);
+					if (k == SZ - 1 && (!kp_chk || !blockDB.isSolidCube(kp_chk->grid[i][j][0])))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT, lightOf(i, j, k + 1));
+					else if( k < SZ - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k + 1]))	solidRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT, lightOf(i, j, k + 1));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::FRONT);
 					break;
 				case BlockDB::RenderType::WATER_RENDER:
 					// place left and right
-					if (i == 0 && (!in_chk || !blockDB.isSolidCube(in_chk->grid[SZ - 1][j][k])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT);
-					else if (i > 0 && !blockDB.isSolidCube(grid[i - 1][j][k]))						waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::LEFT);
-					if (i == SZ - 1 && (!ip_chk || !blockDB.isSolidCube(ip_chk->grid[0][j][k])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT);
-					else if (i < SZ - 1 && !blockDB.isSolidCube(grid[i + 1][j][k]))					waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::RIGHT);
+					if (i == 0 && (!in_chk || !blockDB.isSolidCube(in_chk->grid[SZ - 1][j][k])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT, lightOf(i - 1, j, k));
+					else if (i > 0 && !blockDB.isSolidCube(grid[i - 1][j][k]))						waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::LEFT, lightOf(i - 1, j, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::LEFT);
+					if (i == SZ - 1 && (!ip_chk || !blockDB.isSolidCube(ip_chk->grid[0][j][k])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT, lightOf(i + 1, j, k));
+					else if (i < SZ - 1 && !blockDB.isSolidCube(grid[i + 1][j][k]))					waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::RIGHT, lightOf(i + 1, j, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::RIGHT);
 					// place top and bottom
-					if (j == 0 || j > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j - 1][k]))						waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BOTTOM);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BOTTOM);
-					if (j == HEIGHT - 1 || j < HEIGHT - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j + 1][k]))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::TOP);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::TOP);
+					if (j == 0 || j > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j - 1][k]))						waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BOTTOM, lightOf(i, j - 1, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BOTTOM);
+					if (j == HEIGHT - 1 || j < HEIGHT - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j + 1][k]))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::TOP, lightOf(i, j + 1, k));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::TOP);
 
 					// place back and front
-					if (k == 0 && (!kn_chk || !blockDB.isSolidCube(kn_chk->grid[i][j][SZ - 1])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK);
-					else if (k > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k - 1]))		waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BACK);
-					if (k == SZ - 1 && (!kp_chk || !blockDB.isSolidCube(kp_chk->grid[i][j][0])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT);
-					else if (k < SZ - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k + 1]))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT);//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::FRONT);
+					if (k == 0 && (!kn_chk || !blockDB.isSolidCube(kn_chk->grid[i][j][SZ - 1])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK, lightOf(i, j, k - 1));
+					else if (k > 0 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k - 1]))		waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::BACK, lightOf(i, j, k - 1));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::BACK);
+					if (k == SZ - 1 && (!kp_chk || !blockDB.isSolidCube(kp_chk->grid[i][j][0])))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT, lightOf(i, j, k + 1));
+					else if (k < SZ - 1 && !BlockDB::GetInstance().isSolidCube(grid[i][j][k + 1]))	waterRenderObj.PlaceBlockFaceData(blkTy, pos, Block::Face::FRONT, lightOf(i, j, k + 1));//idxCnt += block->PlaceFaceData(vtxdata, uvdata, idxdata, INOUT vtxCnt, Block::Face::FRONT);
 					break;
 				case BlockDB::RenderType::CUTOUT:
 					// place all faces, without culling
 					for (int f = 0; f < blockData.numFaces(); ++f) {
-						cutoutRenderObj.PlaceBlockFaceData(grid[i][j][k], pos, f);
+						cutoutRenderObj.PlaceBlockFaceData(grid[i][j][k], pos, f, lightOf(i, j, k));
 					}
 					break;
 				}
@@ -123,11 +177,82 @@ void Chunk::Build() {
 	solidRenderObj.Build();
 	cutoutRenderObj.Build();
 	waterRenderObj.Build();
+	BuildOccluders();
+	BuildVisibility();
 	isBuilt = true;
 	requiresRebuild = false;
 
 }
 
+void Chunk::BuildVisibility() {
+	// flood fill every region of non opaque blocks, and connect all chunk faces the region touches.
+	static thread_local std::vector<uint8_t> visited;
+	static thread_local std::vector<int> stack;
+	BlockDB& blockDB = BlockDB::GetInstance();
+	auto index = [](int i, int j, int k) { return (i * HEIGHT + j) * SZ + k; };
+	visited.assign(SZ * HEIGHT * SZ, 0);
+	faceConnectivity = 0;
+
+	for (int start = 0; start < SZ * HEIGHT * SZ; ++start) {
+		int si = start / (HEIGHT * SZ), sj = (start / SZ) % HEIGHT, sk = start % SZ;
+		if (visited[start] || blockDB.isOpaqueCube(grid[si][sj][sk])) continue;
+
+		int faces = 0;
+		visited[start] = 1;
+		stack.push_back(start);
+		while (!stack.empty()) {
+			int n = stack.back();
+			stack.pop_back();
+			int i = n / (HEIGHT * SZ), j = (n / SZ) % HEIGHT, k = n % SZ;
+			if (i == 0) faces |= 1 << Block::Face::LEFT;
+			if (i == SZ - 1) faces |= 1 << Block::Face::RIGHT;
+			if (j == 0) faces |= 1 << Block::Face::BOTTOM;
+			if (j == HEIGHT - 1) faces |= 1 << Block::Face::TOP;
+			if (k == 0) faces |= 1 << Block::Face::BACK;
+			if (k == SZ - 1) faces |= 1 << Block::Face::FRONT;
+
+			const int nbr[6][3] = { {i - 1, j, k}, {i + 1, j, k}, {i, j - 1, k}, {i, j + 1, k}, {i, j, k - 1}, {i, j, k + 1} };
+			for (auto& [ni, nj, nk] : nbr) {
+				if (ni < 0 || ni >= SZ || nj < 0 || nj >= HEIGHT || nk < 0 || nk >= SZ) continue;
+				int m = index(ni, nj, nk);
+				if (visited[m] || blockDB.isOpaqueCube(grid[ni][nj][nk])) continue;
+				visited[m] = 1;
+				stack.push_back(m);
+			}
+		}
+
+		for (int a = 0; a < 6; ++a) {
+			if (!(faces >> a & 1)) continue;
+			for (int b = 0; b < 6; ++b) {
+				if (faces >> b & 1) faceConnectivity |= 1ull << (a * 6 + b);
+			}
+		}
+	}
+}
+
+void Chunk::BuildOccluders() {
+	BlockDB& blockDB = BlockDB::GetInstance();
+	for (int ci = 0; ci < OCCLUDER_CELLS; ++ci) {
+		for (int ck = 0; ck < OCCLUDER_CELLS; ++ck) {
+			int bestLo = 0, bestHi = 0, runLo = 0;
+			for (int j = 0; j <= HEIGHT; ++j) {
+				bool opaque = j < HEIGHT;
+				for (int i = ci * OCCLUDER_CELL_SZ; opaque && i < (ci + 1) * OCCLUDER_CELL_SZ; ++i) {
+					for (int k = ck * OCCLUDER_CELL_SZ; opaque && k < (ck + 1) * OCCLUDER_CELL_SZ; ++k) {
+						opaque = blockDB.isOpaqueCube(grid[i][j][k]);
+					}
+				}
+				if (opaque) continue;
+				// layer j ends the run [runLo, j)
+				if (j - runLo > bestHi - bestLo) bestLo = runLo, bestHi = j;
+				runLo = j + 1;
+			}
+			occluderLo[ci][ck] = (uint8_t)bestLo;
+			occluderHi[ci][ck] = (uint8_t)bestHi;
+		}
+	}
+}
+
 void Chunk::ReBuild() {
 	if (!requiresRebuild) return;
 
@@ -149,8 +274,21 @@ void Chunk::ReBuild() {
 
 void Chunk::DestroyBlockAt(const Chunk::ivec3& bidx) {
 	// deleting a block makes it air!
+	BlockType before = grid[bidx.x][bidx.y][bidx.z];
 	grid[bidx.x][bidx.y][bidx.z] = BlockType::BLOCK_AIR;
+	solid[bidx.x][bidx.y] &= ~(1u << bidx.z);
 	requiresRebuild = true;//requires rebuild.
+	if (lit) World::GetInstance().light.BlockChanged(*this, bidx, before, BlockType::BLOCK_AIR);
+	if (initialized) World::GetInstance().RecordEdit(*this, bidx, BlockType::BLOCK_AIR);
+}
+
+void Chunk::PlaceBlockAt(const Chunk::ivec3& bidx, const BlockDB::BlockType blkTy) {
+	BlockType before = grid[bidx.x][bidx.y][bidx.z];
+	grid[bidx.x][bidx.y][bidx.z] = blkTy;
+	solid[bidx.x][bidx.y] = (solid[bidx.x][bidx.y] & ~(1u << bidx.z)) | ((uint32_t)BlockDB::GetInstance().collides(blkTy) << bidx.z);
+	requiresRebuild = true;
+	if (lit) World::GetInstance().light.BlockChanged(*this, bidx, before, blkTy);
+	if (initialized) World::GetInstance().RecordEdit(*this, bidx, blkTy);
 }
 
 bool Chunk::TestAABB(vec3 worldpos) {
@@ -178,6 +316,11 @@ Chunk::ivec3 Chunk::WorldToChunkIndex(vec3 worldpos) {
 	return currChunkIdx;
 }
 
+Chunk::ivec3 Chunk::BlockToChunkIndex(const ivec3& worldIdx) {
+	//rounds toward negative infinity, so blocks at negative positions map to the right chunk
+	return ivec3(ChunkIndex::FloorDiv(worldIdx.x, SZ), ChunkIndex::FloorDiv(worldIdx.y, HEIGHT), ChunkIndex::FloorDiv(worldIdx.z, SZ));
+}
+
 Chunk::ivec3 Chunk::BlockWorldToGridIdx(const ivec3& worldIdx) {
 	//converts global world-space idx of a block to the local grid idx inside this chunk.
 	//in fact, the computation is chunk-agnostic, nontheless the function is not static
@@ -198,23 +341,24 @@ Chunk::ivec3 Chunk::BlockGridToWorldIdx(const ivec3& gridIdx) {
 	return Chunk::ivec3{ basepos.x + gridIdx.x, basepos.y + gridIdx.y, basepos.z + gridIdx.z };
 }
 
-void Chunk::PlaceBlockAtCompileTime(const ivec3& blockIdx, const BlockDB::BlockType blkTy) {
-	glm::ivec3 cidx = chunkIdx;
-	glm::ivec3 bidx{ blockIdx.x, blockIdx.y, blockIdx.z };
-	while (bidx.x < 0) cidx.x--, bidx.x += Chunk::SZ;
-	while (bidx.x >= Chunk::SZ) cidx.x++, bidx.x -= Chunk::SZ;
-	while (bidx.y < 0) cidx.y--, bidx.y += Chunk::HEIGHT;
-	while (bidx.y >= Chunk::HEIGHT) cidx.y++, bidx.y -= Chunk::HEIGHT;
-	while (bidx.z < 0) cidx.z--, bidx.z += Chunk::SZ;
-	while (bidx.z >= Chunk::SZ) cidx.z++, bidx.z -= Chunk::SZ;
-	if (cidx != chunkIdx) {
-		Chunk* ck = World::GetInstance().GetChunkByIndex(cidx);
-		if (!ck) return;
-		return ck->PlaceBlockAtCompileTime(bidx, blkTy);
+/// CHUNK POOL
+
+Chunk* ChunkPool::Acquire(const glm::ivec3& pos, const glm::ivec3& chunkIdx) {
+	if (freeList.empty()) {
+		blocks.emplace_back(new Chunk[CHUNKS_PER_BLOCK]);
+		Chunk* block = blocks.back().get();
+		freeList.reserve(Capacity());
+		for (size_t n = CHUNKS_PER_BLOCK; n-- > 0;) freeList.push_back(&block[n]);
 	}
-	grid[bidx.x][bidx.y][bidx.z] = blkTy;
-	requiresRebuild = true;
-	return;
+	Chunk* chunk = freeList.back();
+	freeList.pop_back();
+	chunk->Reset(pos, chunkIdx);
+	return chunk;
+}
+
+void ChunkPool::Release(Chunk* chunk) {
+	if (!chunk) return;
+	freeList.push_back(chunk);
 }
 
 /// Noise Generator
@@ -392,7 +536,7 @@ void TerrainGeneration::GenerateMap(pii basepos, OUT BiomeMap_t& biomeMp, OUT La
 	return;
 }
 
-void TerrainGeneration::FindOrCreateMap(pii basepos, OUT BiomeMap_t& biomeMp, OUT LandscapeMap_t& lscapeMp) {
+void TerrainGeneration::FindOrCreateMap(pii basepos, OUT const BiomeMap_t*& biomeMp, OUT const LandscapeMap_t*& lscapeMp) {
 	//1. get the map base position
 	//base position is in world space
 	pii mapbase = { floor(static_cast<float>(basepos.first) / WS_MAP_SPAN) * WS_MAP_SPAN,floor(static_cast<float>(basepos.second) / WS_MAP_SPAN) * WS_MAP_SPAN };
@@ -400,18 +544,16 @@ void TerrainGeneration::FindOrCreateMap(pii basepos, OUT BiomeMap_t& biomeMp, OU
 	//mapbase.second -= MAP_SIZE / 2;
 	
 	//2. check cache
-	if (biomeMap.count(mapbase)) {
-		biomeMp = biomeMap[mapbase];
-		lscapeMp = landscapeMap[mapbase];
-		return;
+	auto bit = biomeMap.find(mapbase);
+	if (bit == biomeMap.end()) {
+		//3. create map if not exist, directly into the cache
+		GenerateMap(mapbase, OUT biomeMap[mapbase], OUT landscapeMap[mapbase]);
+		bit = biomeMap.find(mapbase);
 	}
 
-	//3. create map if not exist
-	GenerateMap(mapbase, OUT biomeMp, OUT lscapeMp);
-
-	//4. cache the map 
-	biomeMap[mapbase] = biomeMp;
-	landscapeMap[mapbase] = lscapeMp;
+	//4. hand out the cached maps. maps are never evicted, so the pointers stay valid.
+	biomeMp = &bit->second;
+	lscapeMp = &landscapeMap[mapbase];
 	return;
 }
 
@@ -435,37 +577,46 @@ void TerrainGeneration::GenerateTerrainHeightsFromMap(Chunk* chunk, const Landsc
 
 	for (int i = 0; i < Chunk::SZ; ++i) {
 		for (int k = 0; k < Chunk::SZ; ++k) {
-			int x = chunk->basepos.x + i, z = chunk->basepos.z + k;
-
-			MapGen::vec2i xzb = biomeMp.WorldToMapPoint(x, z);
-			MapGen::vec2f xzls = lscapeMp.WorldToMapPointF(x, z);
-
-			//1. sample from perlin noise and interpolate
-			LandscapeData lsdata = lscapeMp.SamplePointSubpixel(xzls.x, xzls.y);
-			float alpha = lsdata.roughness;
-			int scale = lsdata.maxAbsScale;
-			float fn = fastNoise.samplePoint(x, z), sn = slowNoise.samplePoint(x, z);
-			float h = alpha * fn + (1.0f - alpha) * sn;
-
-			//2. invert elevation if ocean
-			bool isOcean = biomeMp.data[xzb.x][xzb.y].biomeType == BiomeType::SHALLOW_OCEAN || biomeMp.data[xzb.x][xzb.y].biomeType == BiomeType::DEEP_OCEAN;
-			if (isOcean)
-				chunk->blockHeight[i][k] = std::min(-1, static_cast<int>(scale * (-1.0f + h)));
-			else {
-				chunk->blockHeight[i][k] = scale * (1.0f + h);
-			}
+			chunk->blockHeight[i][k] = columnHeight(chunk->basepos.x + i, chunk->basepos.z + k, lscapeMp, biomeMp);
 		}
 	}
 
 	return;
 }
 
+int TerrainGeneration::columnHeight(int x, int z, const LandscapeMap_t& lscapeMp, const BiomeMap_t& biomeMp) {
+	MapGen::vec2i xzb = biomeMp.WorldToMapPoint(x, z);
+	MapGen::vec2f xzls = lscapeMp.WorldToMapPointF(x, z);
+
+	//1. sample from perlin noise and interpolate
+	LandscapeData lsdata = lscapeMp.SamplePointSubpixel(xzls.x, xzls.y);
+	float alpha = lsdata.roughness;
+	int scale = lsdata.maxAbsScale;
+	float fn = fastNoise.samplePoint(x, z), sn = slowNoise.samplePoint(x, z);
+	float h = alpha * fn + (1.0f - alpha) * sn;
+
+	//2. invert elevation if ocean
+	bool isOcean = biomeMp.data[xzb.x][xzb.y].biomeType == BiomeType::SHALLOW_OCEAN || biomeMp.data[xzb.x][xzb.y].biomeType == BiomeType::DEEP_OCEAN;
+	if (isOcean)
+		return std::min(-1, static_cast<int>(scale * (-1.0f + h)));
+	return scale * (1.0f + h);
+}
+
+void TerrainGeneration::SampleColumn(int x, int z, OUT int& height, OUT BiomeType& biome) {
+	const BiomeMap_t* biomeMp;
+	const LandscapeMap_t* lscapeMp;
+	FindOrCreateMap({ x, z }, OUT biomeMp, OUT lscapeMp);
+	MapGen::vec2i xz = biomeMp->WorldToMapPoint(x, z);
+	biome = biomeMp->data[xz.x][xz.y].biomeType;
+	height = columnHeight(x, z, *lscapeMp, *biomeMp);
+}
+
 void TerrainGeneration::ReplaceSurface(Chunk* chunk) {
 	for (int i = 0; i < Chunk::SZ; ++i) {
 		for (int k = 0; k < Chunk::SZ; ++k) {
 			//double roughness = 0.5 + roughnessNoise.samplePoint(i + chunk->basepos.x + 0.5, k + chunk->basepos.z + 0.5);
 			//1. get replacement data for biome
-			BiomeDB::BiomeDataRow biome = BiomeDB::GetInstance().biomes[chunk->blockBiome[i][k]];
+			const BiomeDB::BiomeDataRow& biome = BiomeDB::GetInstance().biomes[chunk->blockBiome[i][k]];
 			bool isOcean = chunk->blockBiome[i][k] == BiomeType::DEEP_OCEAN || chunk->blockBiome[i][k] == BiomeType::SHALLOW_OCEAN;
 			if (isOcean) continue; //do not replace surface for ocean floors
 
@@ -503,6 +654,17 @@ float TerrainGeneration::simpleNoiseFn(int ix, int iy) {
 }
 
 void TerrainGeneration::GenerateBiomass(Chunk& chunk) {
+	// each plant is one batch of edits, and may reach into the neighbours. the chunks aren't meshed yet,
+	// so the chunks touched are left to the streamer. plants are regenerated with the chunk, so they aren't journaled,
+	// even where they reach into a neighbour that is already decorated. there they leave alone the blocks the
+	// neighbour's journal holds, which it replayed before this chunk was decorated(see ApplyEdits).
+	std::vector<BlockEdit> edits;
+	std::vector<glm::ivec3> touched;
+	auto plant = [&](const glm::ivec3& basepos, const std::vector<std::pair<glm::ivec3, BlockDB::BlockType>>& blocks) {
+		edits.clear();
+		for (auto& [rpos, blkType] : blocks) edits.push_back({ chunk.basepos + basepos + rpos, blkType });
+		World::GetInstance().ApplyEdits(edits, touched, false);
+	};
 	for (int i = 0; i < Chunk::SZ; ++i) {
 		for (int k = 0; k < Chunk::SZ; ++k) {
 			//1. get which biome
@@ -515,6 +677,7 @@ void TerrainGeneration::GenerateBiomass(Chunk& chunk) {
 			int bi = chunk.basepos.x + i, bk = chunk.basepos.z + k;
 			glm::ivec3 basepos{ i, top + 1, k };
 			float r = simpleNoiseFn(bi, bk); // create a flower with probability ~0.05
+			float variant = simpleNoiseFn(bk, bi); // which tree grows here, fixed by the position so regeneration grows it again
 
 			switch (biome) {
 			case BiomeType::GRASSLAND: //GRASSLAND -> FLOWERS
@@ -522,17 +685,11 @@ void TerrainGeneration::GenerateBiomass(Chunk& chunk) {
 				if (r > 0.97) {
 					// generate flowers
 					float s = simpleNoiseFn((bi+bk)/20, (bi-bk)/20);
-					auto flower = SmallPlants::Make(SmallPlants::RandomPlant(s));
-					for (auto& [rpos, blkType] : flower) {
-						chunk.PlaceBlockAtCompileTime(basepos + rpos, blkType);
-					}
+					plant(basepos, SmallPlants::Make(SmallPlants::RandomPlant(s)));
 				}
 				else if (r > 0.94) {
 					// generate trees
-					auto tree = Trees::Make(Trees::ELM);
-					for (auto& [rpos, blkType] : tree) {
-						chunk.PlaceBlockAtCompileTime(basepos + rpos, blkType);
-					}
+					plant(basepos, Trees::Make(Trees::ELM, variant));
 				}
 				break;
 				
@@ -540,10 +697,7 @@ void TerrainGeneration::GenerateBiomass(Chunk& chunk) {
 			case BiomeType::TUNDRA: //SNOWLAND -> SPRUCE
 				if (r > 0.97) {
 					// generate trees
-					auto tree = Trees::Make(Trees::BIRCH);
-					for (auto& [rpos, blkType] : tree) {
-						chunk.PlaceBlockAtCompileTime(basepos + rpos, blkType);
-					}
+					plant(basepos, Trees::Make(Trees::BIRCH, variant));
 				}
 				break;
 
@@ -555,27 +709,26 @@ void TerrainGeneration::GenerateBiomass(Chunk& chunk) {
 }
 
 void TerrainGeneration::Generate(Chunk* chunk) {
-	BiomeMap_t biomeMp;
-	LandscapeMap_t lscapeMp;
-	auto begin = std::chrono::steady_clock::now();
+	// the maps are not copied: a default constructed Map allocates its whole data array.
+	const BiomeMap_t* biomeMp;
+	const LandscapeMap_t* lscapeMp;
+	PROFILE_ZONE("TerrainGeneration::Generate");
 	FindOrCreateMap({ chunk->basepos.x, chunk->basepos.z }, OUT biomeMp, OUT lscapeMp);
-	GenerateBiomeFromMap(chunk, biomeMp);
-	GenerateTerrainHeightsFromMap(chunk, lscapeMp, biomeMp);
+	GenerateBiomeFromMap(chunk, *biomeMp);
+	GenerateTerrainHeightsFromMap(chunk, *lscapeMp, *biomeMp);
 	GenerateRocks(chunk);
 	ReplaceSurface(chunk);
-	auto end = std::chrono::steady_clock::now();
-	auto timeus = std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
-	std::cout << "gen chunk @ " << chunk->basepos.x << "," << chunk->basepos.y << "," << chunk->basepos.z << " time:" << timeus << std::endl;
+	chunk->UpdateSolidity();
 
 	//GenerateBiomass(*chunk);
 }
 
 /// WORLD FUNCTIONS
 Chunk* World::findOrCreateChunk(const p3i& chunkIdx) {
-	if (allChunks.count(chunkIdx)) return allChunks[chunkIdx];
+	if (Chunk* chunk = allChunks.Find(chunkIdx)) return chunk;
 
 	//if the chunk doesn't exist, create it!
-	Chunk* chunk = new Chunk(
+	Chunk* chunk = chunkPool.Acquire(
 		glm::ivec3(
 			Chunk::SZ * std::get<0>(chunkIdx),
 			Chunk::HEIGHT * std::get<1>(chunkIdx),
@@ -587,11 +740,29 @@ Chunk* World::findOrCreateChunk(const p3i& chunkIdx) {
 	//populate the chunk with blocks data
 	worldgen.Generate(chunk);
 
-	allChunks[chunkIdx] = chunk;
+	allChunks.Insert(chunkIdx, chunk);
 
 	return chunk;
 }
 
+void World::recycleDistantChunks() {
+	// chunks left far behind go back to the pool, their edits are kept in the journal.
+	const int reach = viewRadius + CACHE_MARGIN, heightReach = viewHeightRadius + CACHE_MARGIN;
+	recycleList.clear();
+	for (auto& [cidx, chunk] : allChunks) {
+		auto [i, j, k] = cidx;
+		if (i < centerChunkIdx.x - reach || i > centerChunkIdx.x + reach ||
+			k < centerChunkIdx.z - reach || k > centerChunkIdx.z + reach ||
+			j < centerChunkIdx.y - heightReach || j > centerChunkIdx.y + heightReach) {
+			recycleList.push_back(cidx);
+		}
+	}
+	for (p3i& cidx : recycleList) {
+		chunkPool.Release(allChunks.Find(cidx));
+		allChunks.Erase(cidx);
+	}
+}
+
 World::World(glm::vec3 spawnPoint) {
 	// initialize worldgen
 	worldgen = TerrainGeneration();
@@ -601,46 +772,39 @@ World::World(glm::vec3 spawnPoint) {
 
 void World::CreateInitialChunks(glm::vec3 spawnPoint){
 	centerChunkIdx = Chunk::WorldToChunkIndex(spawnPoint);
-	// generate initial blocks
-	for (int i = centerChunkIdx.x - HVIS_WORLD_SZ; i <= centerChunkIdx.x + HVIS_WORLD_SZ; ++i) {
-		for (int k = centerChunkIdx.z - HVIS_WORLD_SZ; k <= centerChunkIdx.z + HVIS_WORLD_SZ; ++k) {
-			for (int j = -HVIS_WORLD_HEIGHT; j <= HVIS_WORLD_HEIGHT; ++j) {
-				Chunk* chunk = visChunks[{i, j, k}] = findOrCreateChunk({ i, j, k });
-			}
-		}
-	}
-
-	// late initialization
-	for (int i = centerChunkIdx.x - HVIS_WORLD_SZ; i <= centerChunkIdx.x + HVIS_WORLD_SZ; ++i) {
-		for (int k = centerChunkIdx.z - HVIS_WORLD_SZ; k <= centerChunkIdx.z + HVIS_WORLD_SZ; ++k) {
-			for (int j = -HVIS_WORLD_HEIGHT; j <= HVIS_WORLD_HEIGHT; ++j) {
-				Chunk* chunk = visChunks[{i, j, k}];
-				if (!chunk) continue;
-				if (!chunk->initialized) {
-					worldgen.GenerateBiomass(*chunk);
-					std::cout << "biomass " << i << "," << j << "," << k << std::endl;
-					chunk->initialized = true;
-				}
-			}
-		}
-	}
-
-	for (auto& [cidx, chunk] : visChunks) {
-		if (!chunk->isBuilt) chunk->Build();
-	}
-
+	// the whole window is streamed in before the first frame, regardless of the budget.
+	requestViewWindow();
+	streamer.Flush(*this, spawnPoint, cameraFrustum());
+	prefetcher.ResetStats(); //the spawn window is never ready ahead of time
 }
 
 Chunk* World::CurrentChunk(const glm::vec3& position) {
 	glm::ivec3 currChunkIdx = Chunk::WorldToChunkIndex(position);
-	return visChunks[{currChunkIdx.x, currChunkIdx.y, currChunkIdx.z}];
+	return visChunks.Find(currChunkIdx);
 }
 
 Chunk* World::GetChunkByIndex(const glm::ivec3& idx) {
-	if (visChunks.count({ idx.x, idx.y, idx.z })) {
-		return visChunks[{idx.x, idx.y, idx.z}];
-	}
-	return nullptr;
+	return visChunks.Find(idx);
+}
+
+uint32_t SolidRows::operator()(int x, int y, int z) {
+	glm::ivec3 chunkIdx = Chunk::BlockToChunkIndex({ x, y, z });
+	glm::ivec3 local = glm::ivec3(x, y, z) - chunkIdx * glm::ivec3(Chunk::SZ, Chunk::HEIGHT, Chunk::SZ);
+	uint32_t row = 0;
+	if (Chunk* chunk = chunkAt(chunkIdx)) row = chunk->SolidRow(local.x, local.y) >> local.z;
+	if (local.z == 0) return row;
+	if (Chunk* next = chunkAt(chunkIdx + glm::ivec3(0, 0, 1))) row |= next->SolidRow(local.x, local.y) << (Chunk::SZ - local.z);
+	return row;
+}
+
+Chunk* SolidRows::chunkAt(const glm::ivec3& chunkIdx) {
+	if (cachedIdx[0] == chunkIdx) return cached[0];
+	if (cachedIdx[1] == chunkIdx) return cached[1];
+	cachedIdx[replace] = chunkIdx;
+	cached[replace] = world.GetChunkByIndex(chunkIdx);
+	Chunk* chunk = cached[replace];
+	replace ^= 1;
+	return chunk;
 }
 
 Chunk* World::GetChunkContainingBlock(const glm::ivec3& worldpos) {
@@ -648,71 +812,261 @@ Chunk* World::GetChunkContainingBlock(const glm::ivec3& worldpos) {
 	int cy = (worldpos.y >= 0 ? (int)(worldpos.y / Chunk::HEIGHT) : (int)((worldpos.y+1) / Chunk::HEIGHT) - 1);
 	int cz = (worldpos.z >= 0 ? (int)(worldpos.z / Chunk::SZ) : (int)((worldpos.z+1) / Chunk::SZ) - 1);
 	
-	if (allChunks.count({cx, cy, cz})) return allChunks[{cx, cy, cz}];
-	else return nullptr;
+	return allChunks.Find(cx, cy, cz);
 }
 
 
-void World::Build() {
-	//if any visible chunk has modifications,
-	//rebuild it.
-	for (auto& [cidx, chunk] : visChunks) {
-		if (chunk->requiresRebuild) {
+void World::Build(const std::vector<glm::ivec3>& edited) {
+	//chunks that were never built are left to the streamer.
+	for (const glm::ivec3& cidx : edited) {
+		Chunk* chunk = visChunks.Find(cidx);
+		if (chunk && chunk->isBuilt && chunk->requiresRebuild) {
 			std::cout << "rebuilding " << chunk->basepos.x << "," << chunk->basepos.y << "," << chunk->basepos.z << std::endl;
 			chunk->ReBuild();
 		}
 	}
+	// and the ones whose light changed, with those edits or with a newly lit neighbour
+	for (const glm::ivec3& cidx : light.TakeRelit()) {
+		Chunk* chunk = visChunks.Find(cidx);
+		if (chunk && chunk->isBuilt && chunk->requiresRebuild) chunk->ReBuild();
+	}
 }
 
-void World::UpdateChunks(glm::vec3& playerPosition) {
+void World::UpdateChunks(glm::vec3& playerPosition, float dt) {
 
+	// the window recenters once the player is more than one chunk off center.
+	// with a radius of one there is no room for slack, so it recenters on every chunk crossed.
 	glm::ivec3 cijk = Chunk::WorldToChunkIndex(playerPosition);
-	int ci = cijk.x, ck = cijk.z;
-	if (ci > centerChunkIdx.x + 1 || ci < centerChunkIdx.x - 1
-		|| ck > centerChunkIdx.z + 1 || ck < centerChunkIdx.z - 1) {
+	int slack = viewRadius > 1 ? 1 : 0, heightSlack = viewHeightRadius > 1 ? 1 : 0;
+	if (std::abs(cijk.x - centerChunkIdx.x) > slack || std::abs(cijk.z - centerChunkIdx.z) > slack
+		|| std::abs(cijk.y - centerChunkIdx.y) > heightSlack) {
 		centerChunkIdx = cijk;
+		requestViewWindow();
+		recycleDistantChunks();
+	}
 
-		// iterate over visible chunks
-		std::vector<p3i> to_remove{};
-		for (auto& [cidx, chunk] : visChunks) {
-			auto [i, j, k] = cidx;
-			// if moved out of view
-			if (i < ci - HVIS_WORLD_SZ || i > ci + HVIS_WORLD_SZ ||
-				k < ck - HVIS_WORLD_SZ || k > ck + HVIS_WORLD_SZ) {
-				// VAO's and VBO's memory can be freed
-				chunk->isBuilt = false;
-				chunk->solidRenderObj.DeleteBuffers();
-				chunk->cutoutRenderObj.DeleteBuffers();
-
-				to_remove.push_back(cidx);
-			}
-		}
+	// prefetched chunks stay within CACHE_MARGIN of the window, so they are not recycled before they are needed.
+	prefetcher.Update(playerPosition, Camera::MainCamera.front, dt);
+	prefetcher.Predict(*this, CACHE_MARGIN, prefetchList);
+	streamer.SetPrefetch(prefetchList);
 
-		// iterate over chunks that needs to be rendered, finding them and 
-		for (int i = ci - HVIS_WORLD_SZ; i <= ci + HVIS_WORLD_SZ; ++i) {
-			for (int k = ck - HVIS_WORLD_SZ; k <= ck + HVIS_WORLD_SZ; ++k) {
-				for (int j = -HVIS_WORLD_HEIGHT; j <= HVIS_WORLD_HEIGHT; ++j) {
-					if (!visChunks.count({ i, j, k })) {
-						Chunk* chunk = visChunks[{i, j, k}] = findOrCreateChunk({ i, j, k });
-					}
+	// generation, decoration and meshing are spread over frames, nearest chunks first.
+	streamer.Run(*this, playerPosition, cameraFrustum());
+	{
+		PROFILE_ZONE("TerrainLod::Update");
+		lod.Update(worldgen, centerChunkIdx, viewRadius);
+	}
+}
+
+void World::requestViewWindow() {
+	// iterate over chunks that needs to be rendered, requesting the ones not yet in the window.
+	// the window is toroidal, so a slot holding a different chunk holds one that moved out of view.
+	for (int i = centerChunkIdx.x - viewRadius; i <= centerChunkIdx.x + viewRadius; ++i) {
+		for (int k = centerChunkIdx.z - viewRadius; k <= centerChunkIdx.z + viewRadius; ++k) {
+			for (int j = centerChunkIdx.y - viewHeightRadius; j <= centerChunkIdx.y + viewHeightRadius; ++j) {
+				auto& [slotIdx, slotChunk] = visChunks.SlotFor({ i, j, k });
+				if (slotChunk && slotIdx == p3i{ i, j, k }) {
+					if (!slotChunk->isBuilt) streamer.Request({ i, j, k });
+					continue;
 				}
+				if (slotChunk) {
+					unloadChunk(*slotChunk);
+					slotChunk = nullptr;
+				}
+				prefetcher.RecordNeed(allChunks.Find(i, j, k) != nullptr);
+				streamer.Request({ i, j, k });
 			}
 		}
+	}
+}
 
-		for (p3i& rmvidx : to_remove) {
-			visChunks.erase(rmvidx);
-		}
+void World::unloadChunk(Chunk& chunk) {
+	// VAO's and VBO's memory can be freed
+	chunk.isBuilt = false;
+	chunk.solidRenderObj.DeleteBuffers();
+	chunk.cutoutRenderObj.DeleteBuffers();
+	chunk.waterRenderObj.DeleteBuffers();
+}
 
-		// 'late initialization' and build.
-		// 'late initialization' involves generation that requires adjacent chunks to be already built.
-		for (auto& [cidx, chunk] : visChunks) {
-			if (!chunk->initialized) {
-				worldgen.GenerateBiomass(*chunk);
-				chunk->initialized = true;
-			}
+void World::SetViewDistance(int radius, int heightRadius) {
+	radius = std::max(1, radius);
+	heightRadius = std::max(1, heightRadius);
+	if (radius == viewRadius && heightRadius == viewHeightRadius) return;
+
+	// the toroidal window maps chunks to different slots once resized, so it is emptied and refilled.
+	// chunks stay in allChunks, so the ones still in view only need to be meshed again.
+	for (auto& [cidx, chunk] : visChunks) unloadChunk(*chunk);
+	viewRadius = radius, viewHeightRadius = heightRadius;
+	visChunks.Resize(2 * viewRadius + 1, 2 * viewHeightRadius + 1);
+	streamer.Clear();
+	if (allChunks.size() == 0) return; //not started yet, CreateInitialChunks will fill the window
+
+	requestViewWindow();
+	recycleDistantChunks();
+}
+
+bool World::IsInViewWindow(const p3i& idx) const {
+	auto [i, j, k] = idx;
+	return i >= centerChunkIdx.x - viewRadius && i <= centerChunkIdx.x + viewRadius
+		&& k >= centerChunkIdx.z - viewRadius && k <= centerChunkIdx.z + viewRadius
+		&& j >= centerChunkIdx.y - viewHeightRadius && j <= centerChunkIdx.y + viewHeightRadius;
+}
+
+Chunk* World::LoadChunk(const p3i& idx) {
+	Chunk* chunk = findOrCreateChunk(idx);
+	visChunks.Insert(idx, chunk);
+	return chunk;
+}
+
+bool World::PrefetchChunk(const p3i& idx) {
+	if (allChunks.Find(idx)) return false;
+	findOrCreateChunk(idx);
+	return true;
+}
+
+void World::DecorateChunk(Chunk& chunk) {
+	// 'late initialization' involves generation that requires adjacent chunks to be already generated.
+	if (chunk.initialized) return;
+	worldgen.GenerateBiomass(chunk);
+	ReplayEdits(chunk);
+	light.Seed(chunk);
+	chunk.initialized = true;
+}
+
+/// BLOCK EDITS
+
+void World::ApplyEdits(const BlockEdit* edits, size_t count, std::vector<glm::ivec3>& touched, bool journal) {
+	PROFILE_ZONE("World::ApplyEdits");
+	auto touch = [&touched](Chunk& chunk) {
+		chunk.requiresRebuild = true;
+		if (std::find(touched.begin(), touched.end(), chunk.chunkIdx) == touched.end()) touched.push_back(chunk.chunkIdx);
+	};
+	// a neighbour's mesh shows the blocks on this chunk's x and z borders(Chunk::Build), not the ones above or below
+	static const glm::ivec3 SIDES[4] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+	// grouped by chunk, in order within a chunk, so a block edited twice ends up as the later edit says
+	editOrder.clear();
+	for (size_t n = 0; n < count; ++n) {
+		glm::ivec3 cidx = Chunk::BlockToChunkIndex(edits[n].block);
+		editOrder.push_back({ ChunkIndex::PackKey(cidx.x, cidx.y, cidx.z), (uint32_t)n });
+	}
+	std::sort(editOrder.begin(), editOrder.end());
+
+	BlockDB& blockDB = BlockDB::GetInstance();
+	lightChanges.clear();
+	for (size_t first = 0, last = 0; first < editOrder.size(); first = last) {
+		while (last < editOrder.size() && editOrder[last].first == editOrder[first].first) last++;
+		Chunk* chunk = allChunks.Find(Chunk::BlockToChunkIndex(edits[editOrder[first].second].block));
+		if (!chunk) continue;
+		// as in RecordEdit, only edits to decorated chunks are journaled
+		ChunkEditJournal* chunkJournal = journal && chunk->initialized ? &editJournals[{ chunk->chunkIdx.x, chunk->chunkIdx.y, chunk->chunkIdx.z }] : nullptr;
+		// a decorated chunk has replayed its journal already, and what the player did there wins over the
+		// plants of a neighbour decorated after it
+		const ChunkEditJournal* keep = nullptr;
+		if (!journal && chunk->initialized) {
+			auto it = editJournals.find({ chunk->chunkIdx.x, chunk->chunkIdx.y, chunk->chunkIdx.z });
+			if (it != editJournals.end()) keep = &it->second;
 		}
-		for (auto& [cidx, chunk] : visChunks) {
-			if (!chunk->isBuilt)chunk->Build();
+		bool changed = false;
+		int borders = 0; //bit s is set if an edited block lies on the border towards SIDES[s]
+		for (size_t n = first; n < last; ++n) {
+			const BlockEdit& edit = edits[editOrder[n].second];
+			glm::ivec3 bidx = chunk->BlockWorldToGridIdx(edit.block);
+			BlockDB::BlockType before = chunk->grid[bidx.x][bidx.y][bidx.z];
+			if (before == edit.type || (keep && keep->Covers(bidx.x, bidx.y, bidx.z))) continue;
+			chunk->grid[bidx.x][bidx.y][bidx.z] = edit.type;
+			chunk->solid[bidx.x][bidx.y] = (chunk->solid[bidx.x][bidx.y] & ~(1u << bidx.z)) | ((uint32_t)blockDB.collides(edit.type) << bidx.z);
+			if (chunk->lit) lightChanges.push_back({ chunk, bidx, before, edit.type });
+			if (chunkJournal) chunkJournal->Record(bidx.x, bidx.y, bidx.z, edit.type);
+			changed = true;
+			borders |= (bidx.x == 0) | (bidx.x == Chunk::SZ - 1) << 1 | (bidx.z == 0) << 2 | (bidx.z == Chunk::SZ - 1) << 3;
+		}
+		if (!changed) continue;
+		if (chunkJournal && chunkJournal->NeedsCompaction()) chunkJournal->Compact(chunk->grid);
+		touch(*chunk);
+		for (int s = 0; s < 4; ++s) {
+			if (!((borders >> s) & 1)) continue;
+			if (Chunk* nbr = allChunks.Find(chunk->chunkIdx + SIDES[s])) touch(*nbr);
 		}
 	}
-}
\ No newline at end of file
+	// once every block is in place, so the light doesn't spread through blocks about to be filled in
+	light.BlocksChanged(lightChanges.data(), lightChanges.size());
+}
+
+Frustum World::cameraFrustum() {
+	return Frustum(Camera::MainCamera.GetPerspectiveMatrix() * Camera::MainCamera.GetViewMatrix());
+}
+
+/// EDIT JOURNAL
+static_assert(Chunk::SZ == ChunkEditJournal::SZ && Chunk::HEIGHT == ChunkEditJournal::HEIGHT, "edit journal must match chunk dimensions");
+
+void World::RecordEdit(Chunk& chunk, const glm::ivec3& bidx, BlockDB::BlockType blkTy) {
+	ChunkEditJournal& journal = editJournals[{ chunk.chunkIdx.x, chunk.chunkIdx.y, chunk.chunkIdx.z }];
+	journal.Record(bidx.x, bidx.y, bidx.z, blkTy);
+	if (journal.NeedsCompaction()) journal.Compact(chunk.grid);
+}
+
+void World::ReplayEdits(Chunk& chunk) {
+	// edits are replayed after decoration, so that they win over regenerated trees and flowers.
+	auto it = editJournals.find({ chunk.chunkIdx.x, chunk.chunkIdx.y, chunk.chunkIdx.z });
+	if (it == editJournals.end()) return;
+	it->second.Replay(chunk.grid);
+	chunk.UpdateSolidity();
+}
+
+// save file: "GLCE" | u32 version | u32 journal count | count * (i32 x, i32 y, i32 z, journal)
+static constexpr char EDITS_MAGIC[4] = { 'G', 'L', 'C', 'E' };
+static constexpr uint32_t EDITS_VERSION = 1;
+
+bool World::SaveEdits(const std::string& path) {
+	std::ofstream ofs(path, std::ios::binary);
+	if (!ofs) {
+		std::cout << "ERROR::WORLD::COULD_NOT_OPEN_SAVE_FILE: " << path << std::endl;
+		return false;
+	}
+
+	uint32_t cnt = 0;
+	for (auto& [cidx, journal] : editJournals) if (!journal.empty()) cnt++;
+	ofs.write(EDITS_MAGIC, sizeof(EDITS_MAGIC));
+	ofs.write(reinterpret_cast<const char*>(&EDITS_VERSION), sizeof(EDITS_VERSION));
+	ofs.write(reinterpret_cast<const char*>(&cnt), sizeof(cnt));
+
+	size_t bytes = sizeof(EDITS_MAGIC) + sizeof(EDITS_VERSION) + sizeof(cnt);
+	for (auto& [cidx, journal] : editJournals) {
+		if (journal.empty()) continue;
+		int32_t xyz[3] = { std::get<0>(cidx), std::get<1>(cidx), std::get<2>(cidx) };
+		ofs.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+		journal.Write(ofs);
+		bytes += sizeof(xyz) + journal.SerializedSize();
+	}
+	std::cout << "saved edits of " << cnt << " chunks, " << bytes << " bytes (full grids: " << (size_t)cnt * ChunkEditJournal::VOLUME << " bytes)" << std::endl;
+	return ofs.good();
+}
+
+bool World::LoadEdits(const std::string& path) {
+	std::ifstream ifs(path, std::ios::binary);
+	if (!ifs) return false; // nothing saved yet
+
+	char magic[4];
+	uint32_t version = 0, cnt = 0;
+	ifs.read(magic, sizeof(magic));
+	ifs.read(reinterpret_cast<char*>(&version), sizeof(version));
+	ifs.read(reinterpret_cast<char*>(&cnt), sizeof(cnt));
+	if (!ifs || !std::equal(magic, magic + 4, EDITS_MAGIC) || version != EDITS_VERSION) {
+		std::cout << "ERROR::WORLD::INVALID_SAVE_FILE: " << path << std::endl;
+		return false;
+	}
+
+	std::map<p3i, ChunkEditJournal> loaded;
+	for (uint32_t n = 0; n < cnt; ++n) {
+		int32_t xyz[3];
+		ChunkEditJournal journal;
+		if (!ifs.read(reinterpret_cast<char*>(xyz), sizeof(xyz)) || !journal.Read(ifs)) {
+			std::cout << "ERROR::WORLD::CORRUPTED_SAVE_FILE: " << path << std::endl;
+			return false;
+		}
+		loaded[{ xyz[0], xyz[1], xyz[2] }] = std::move(journal);
+	}
+	editJournals = std::move(loaded);
+	return true;
+}
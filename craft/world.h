@@ -18,12 +18,23 @@
 #include <map>
 #include <iostream>
 #include <chrono>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <limits>
 #include "GLObjects.h"
 #include "map.h"
 #include "layers.h"
 #include "rendering.hpp"
 #include "blocks.hpp"
 #include "plants.hpp"
+#include "edits.h"
+#include "chunkindex.h"
+#include "streaming.h"
+#include "frustum.h"
+#include "lod.h"
+#include "light.h"
 
 using pii = std::pair<int, int>;
 using namespace MapGen;
@@ -63,6 +74,16 @@ public:
 	using BlockType = BlockDB::BlockType;
 	static constexpr int SZ = 32, HEIGHT = 32; //a chunk is SZ*HEIGHT*SZ large. the y coordinate is up.
 	BlockType grid[SZ][HEIGHT][SZ]; //the blocks are conveniently stored in a 3d array.
+	//bit z of solid[x][y] is set if the block at grid[x][y][z] collides(BlockDB::collides), so a row of 32 blocks
+	//along z is one word. kept up to date by the block manipulation functions, and by UpdateSolidity() after
+	//anything that writes grid directly.
+	uint32_t solid[SZ][HEIGHT];
+	bool IsSolid(const ivec3& bidx) const { return (solid[bidx.x][bidx.y] >> bidx.z) & 1u; }
+	uint32_t SolidRow(int x, int y) const { return solid[x][y]; }
+	void UpdateSolidity();
+
+	uint8_t skyLight[SZ][HEIGHT][SZ]; //0 to BlockDB::MAX_LIGHT, written by the World's LightEngine
+	bool lit; //skyLight is valid, set when the chunk is seeded
 	
 	int blockHeight[SZ][SZ]; //the number of blocks in each column
 	BiomeType blockBiome[SZ][SZ]; //the biome type for each column
@@ -74,6 +95,17 @@ public:
 	ivec3 chunkIdx; //unique integer index for this chunk.
 
 	bool isBuilt, requiresRebuild, initialized;
+
+	//occluders for software occlusion culling, updated on every build.
+	//the chunk's columns are split into OCCLUDER_CELLS x OCCLUDER_CELLS cells, and each cell keeps
+	//its longest run of layers [occluderLo, occluderHi) that are opaque across the whole cell.
+	static constexpr int OCCLUDER_CELLS = 4, OCCLUDER_CELL_SZ = SZ / OCCLUDER_CELLS;
+	uint8_t occluderLo[OCCLUDER_CELLS][OCCLUDER_CELLS], occluderHi[OCCLUDER_CELLS][OCCLUDER_CELLS];
+
+	//which pairs of the six faces(Block::Face) see each other through non opaque blocks, updated on every build.
+	//bit a * 6 + b is set if faces a and b are connected.
+	uint64_t faceConnectivity;
+	bool FacesConnected(int a, int b) const { return (faceConnectivity >> (a * 6 + b)) & 1; }
 	/*
 	* The vertices of a cube are always numbered as below:
 	* 
@@ -90,21 +122,38 @@ public:
 	Chunk();
 	Chunk(const ivec3& pos, const ivec3& chunkIdx);
 
+	//returns the chunk to its just-constructed state at a new position, so its memory can be reused.
+	void Reset(const ivec3& pos, const ivec3& chunkIdx);
+
 	//main functions
 	void Build();
 	void ReBuild();
+	void BuildOccluders();
+	void BuildVisibility();
 
 	//manipulation
 	void DestroyBlockAt(const ivec3& bidx);
-	void PlaceBlockAtCompileTime(const ivec3& bidx, const BlockDB::BlockType blkTy);
+	void PlaceBlockAt(const ivec3& bidx, const BlockDB::BlockType blkTy);
 	
 	//utils
 	//testing worldpos lies inside this chunk's boundary
 	bool TestAABB(vec3 worldpos);
 	ivec3 FindBlockIndex(vec3 worldpos);
 	static ivec3 WorldToChunkIndex(vec3 worldpos);
+	static ivec3 BlockToChunkIndex(const ivec3& worldIdx); //index of the chunk holding the block at world idx
 	ivec3 BlockWorldToGridIdx(const ivec3& worldidx);
 	ivec3 BlockGridToWorldIdx(const ivec3& grididx);
+	//calls fn(mn, mx) with the world space box of every non empty occluder.
+	template<class Fn> void ForEachOccluder(Fn fn) const {
+		for (int ci = 0; ci < OCCLUDER_CELLS; ++ci) {
+			for (int ck = 0; ck < OCCLUDER_CELLS; ++ck) {
+				if (occluderHi[ci][ck] <= occluderLo[ci][ck]) continue;
+				vec3 mn = vec3(basepos) + vec3(ci * OCCLUDER_CELL_SZ, occluderLo[ci][ck], ck * OCCLUDER_CELL_SZ) - 0.5f;
+				vec3 mx = vec3(basepos) + vec3((ci + 1) * OCCLUDER_CELL_SZ, occluderHi[ci][ck], (ck + 1) * OCCLUDER_CELL_SZ) - 0.5f;
+				fn(mn, mx);
+			}
+		}
+	}
 	//ivec3 ChunkToWorldCoordinate(ivec3 chunkpos);
 
 	RenderObject solidRenderObj;
@@ -114,6 +163,27 @@ public:
 };
 
 
+/*
+chunks are large(a 32^3 grid) and are created and dropped constantly while the player moves,
+so they are allocated in blocks and recycled instead of new/delete-ing each one.
+*/
+class ChunkPool {
+public:
+	static constexpr size_t CHUNKS_PER_BLOCK = 32;
+
+	//returns a reset chunk. only allocates when every slot is in use.
+	Chunk* Acquire(const glm::ivec3& pos, const glm::ivec3& chunkIdx);
+	//the chunk must not be referenced anywhere after release.
+	void Release(Chunk* chunk);
+
+	size_t Capacity() const { return blocks.size() * CHUNKS_PER_BLOCK; }
+	size_t InUse() const { return Capacity() - freeList.size(); }
+
+private:
+	std::vector<std::unique_ptr<Chunk[]>> blocks;
+	std::vector<Chunk*> freeList;
+};
+
 class FractalNoise2D {
 public:
 	double persistance;
@@ -168,9 +238,9 @@ public:
 	/// thus, to properly index the map, use the utility function provided by the returned map.
 	/// </summary>
 	/// <param name="basepos">the world x-z position. the coordinates must be divisible by the returned map's scale</param>
-	/// <param name="biomeMp">OUT biome map containing the query position</param>
-	/// <param name="biomeMp">OUT landscape map containing the query position</param>
-	void FindOrCreateMap(pii basepos, OUT BiomeMap_t& biomeMp, OUT LandscapeMap_t& lscapeMp);
+	/// <param name="biomeMp">OUT biome map containing the query position, owned by the cache</param>
+	/// <param name="biomeMp">OUT landscape map containing the query position, owned by the cache</param>
+	void FindOrCreateMap(pii basepos, OUT const BiomeMap_t*& biomeMp, OUT const LandscapeMap_t*& lscapeMp);
 	
 	/// <summary>
 	/// Uses Voronoi zoom to go from the maximum resolution 4x4 of biome map
@@ -191,6 +261,17 @@ public:
 	/// <param name="biomeMp">used to invert elevation to negative number for ocean</param>
 	void GenerateTerrainHeightsFromMap(Chunk* chunk, const LandscapeMap_t lscapeMp, const BiomeMap_t biomeMp);
 
+	/// <summary>
+	/// terrain height and biome of a single block column, the same values Generate() writes
+	/// to a chunk's blockHeight and blockBiome, without filling a voxel grid.
+	/// used to draw distant terrain.
+	/// </summary>
+	/// <param name="x">world x position of the column</param>
+	/// <param name="z">world z position of the column</param>
+	/// <param name="height">OUT height of the topmost terrain block</param>
+	/// <param name="biome">OUT biome of the column</param>
+	void SampleColumn(int x, int z, OUT int& height, OUT BiomeType& biome);
+
 	/// <summary>
 	/// Replaces top few blocks of terrain with biome-specific surface blocks.
 	/// For instance, snowland gets 4 soil blocks and 1 snow-covered soil at the top
@@ -204,18 +285,33 @@ public:
 protected:
 	void GenerateMap(pii basepos, OUT BiomeMap_t& biomeMp, OUT LandscapeMap_t& lscapeMp);
 	float simpleNoiseFn(int ix, int iy);
+	int columnHeight(int x, int z, const LandscapeMap_t& lscapeMp, const BiomeMap_t& biomeMp);
 };
 
 class World {
 public:
 	using p3i = std::tuple<int, int, int>;
 	using pii = std::pair<int, int>;
-	std::map<p3i, Chunk*> allChunks;
-	std::map<p3i, Chunk*> visChunks;
+	static constexpr int DEFAULT_VIEW_RADIUS = 3, DEFAULT_VIEW_HEIGHT_RADIUS = 1;
+	static constexpr int CACHE_MARGIN = 2; //chunks this far outside the visible window stay in memory, farther ones are recycled.
+
+	//the view window spans centerChunkIdx +- viewRadius chunks horizontally and +- viewHeightRadius vertically.
+	//change them with SetViewDistance().
+	int viewRadius = DEFAULT_VIEW_RADIUS, viewHeightRadius = DEFAULT_VIEW_HEIGHT_RADIUS;
+
+	ChunkIndex::ChunkHashMap allChunks;
+	ChunkIndex::ChunkWindow visChunks{ 2 * DEFAULT_VIEW_RADIUS + 1, 2 * DEFAULT_VIEW_HEIGHT_RADIUS + 1 };
+	std::map<p3i, ChunkEditJournal> editJournals; //blocks changed after generation, kept even if the chunk is not loaded.
 	TerrainGeneration worldgen;
+	ChunkPool chunkPool;
+	ChunkStreamer streamer;
+	ChunkPrefetcher prefetcher;
+	TerrainLod lod; //distant terrain outside the view window
+	LightEngine light{ *this };
 	glm::ivec3 centerChunkIdx{ 0,0,0 };
-
-	static constexpr int VIS_WORLD_SZ = 7, HVIS_WORLD_SZ = 3, VIS_WORLD_HEIGHT = 3, HVIS_WORLD_HEIGHT = 1;
+	//held by the simulation tick while it reads and edits blocks, and by the render thread
+	//while it streams, rebuilds and recycles chunks.
+	std::mutex mutex;
 
 	static World& GetInstance() {
 		static World instance = World({0.0f, 1.0f, 0.0f});
@@ -226,13 +322,71 @@ public:
 	Chunk* CurrentChunk(const glm::vec3& position); //Pointer to current chunk.
 	Chunk* GetChunkByIndex(const glm::ivec3& idx);
 	Chunk* GetChunkContainingBlock(const glm::ivec3& worldIdx);
-	void UpdateChunks(glm::vec3& playerPosition);
-	void Build();
+	void UpdateChunks(glm::vec3& playerPosition, float dt); //dt: the frame's time step
+	void Build(const std::vector<glm::ivec3>& edited); //rebuilds the built chunks among edited
+
+	//streaming
+	//resizes the view window. chunks that fall outside are unloaded, new ones are streamed in over the next frames.
+	void SetViewDistance(int radius, int heightRadius);
+	bool IsInViewWindow(const p3i& idx) const;
+	Chunk* LoadChunk(const p3i& idx); //finds or generates the chunk and places it in the view window.
+	void DecorateChunk(Chunk& chunk); //trees, flowers and replayed edits. runs once per chunk.
+	bool PrefetchChunk(const p3i& idx); //generates the chunk without placing it in the view window. false if it already existed.
+
+	//block edits
+	//applies the edits in order, a chunk at a time: the blocks, their solidity, the edit journal, and the light once for all of them.
+	//edits to chunks that don't exist are dropped. the chunks to remesh are appended to touched, each once, with their
+	//requiresRebuild set: the edited ones, and the neighbours whose meshes show an edited block on their border.
+	//journal is false for edits worldgen reproduces by itself(decoration), which must not end up in the save file.
+	//such edits skip the blocks of decorated chunks that their journal holds, so they don't undo replayed edits.
+	void ApplyEdits(const BlockEdit* edits, size_t count, std::vector<glm::ivec3>& touched, bool journal = true);
+	void ApplyEdits(const std::vector<BlockEdit>& edits, std::vector<glm::ivec3>& touched, bool journal = true) {
+		ApplyEdits(edits.data(), edits.size(), touched, journal);
+	}
+
+	//edit journal
+	//only edits to initialized chunks are recorded, generation itself is reproduced by worldgen.
+	void RecordEdit(Chunk& chunk, const glm::ivec3& bidx, BlockDB::BlockType blkTy);
+	void ReplayEdits(Chunk& chunk);
+	bool SaveEdits(const std::string& path);
+	bool LoadEdits(const std::string& path);
 
 private:
 	World(glm::vec3 centerPoint);
 	World(World const& other) = delete;
 	World& operator=(World const& other) = delete;
 	Chunk* findOrCreateChunk(const p3i& chunkIdx);
+	void recycleDistantChunks();
+	void requestViewWindow();
+	void unloadChunk(Chunk& chunk);
+	Frustum cameraFrustum();
+	std::vector<p3i> recycleList; //reused across calls to avoid allocating
+	std::vector<p3i> prefetchList;
+	std::vector<std::pair<uint64_t, uint32_t>> editOrder; //(chunk key, edit), for ApplyEdits
+	std::vector<LightEngine::Change> lightChanges;
+};
+
+
+/*
+reads the solidity of the loaded chunks 32 blocks along z at a time(Chunk::SolidRow), for Collision::SlideThroughVoxels.
+a row that doesn't start on a chunk's border is stitched from the chunk and its +z neighbour,
+so the last two chunks looked up are remembered. blocks of chunks that are not loaded are not solid.
+*/
+class SolidRows {
+public:
+	static_assert(Chunk::SZ == 32, "a chunk's row along z must be one word");
+
+	SolidRows(World& world) : world(world) {}
+
+	//bit i is set if the block at (x, y, z + i) is solid
+	uint32_t operator()(int x, int y, int z);
+
+private:
+	Chunk* chunkAt(const glm::ivec3& chunkIdx);
+
+	World& world;
+	glm::ivec3 cachedIdx[2]{ glm::ivec3(std::numeric_limits<int>::min()), glm::ivec3(std::numeric_limits<int>::min()) };
+	Chunk* cached[2]{ nullptr, nullptr };
+	int replace = 0; //the entry the next miss overwrites
 };
 #endif
\ No newline at end of file